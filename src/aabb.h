@@ -0,0 +1,53 @@
+#pragma once
+#include <limits>
+#include <algorithm>
+#include "vec3.h"
+#include "ray.h"
+
+/// @brief 轴对齐包围盒（默认构造为空盒）
+struct AABB {
+	Vec3 min = Vec3(std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity());
+	Vec3 max = Vec3(-std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity());
+
+	AABB() = default;
+	AABB(const Vec3& lo, const Vec3& hi) : min(lo), max(hi) {}
+
+	/// @brief 是否为空盒
+	bool empty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+
+	/// @brief 扩展以包含点 p
+	void expand(const Vec3& p) {
+		min = Vec3(std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z));
+		max = Vec3(std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z));
+	}
+
+	/// @brief 扩展以包含另一包围盒
+	void expand(const AABB& b) {
+		if (b.empty()) return;
+		expand(b.min);
+		expand(b.max);
+	}
+
+	/// @brief 第 i 个角点（i 的三位分别选择 x/y/z 的 min 或 max）
+	Vec3 corner(int i) const {
+		return Vec3((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z);
+	}
+
+	/// @brief 射线与包围盒在 [t_min, t_max] 内是否相交（slab 测试）
+	bool hit(const Ray& r, double t_min, double t_max) const {
+		const double o[3] = { r.origin.x, r.origin.y, r.origin.z };
+		const double d[3] = { r.direction.x, r.direction.y, r.direction.z };
+		const double lo[3] = { min.x, min.y, min.z };
+		const double hi[3] = { max.x, max.y, max.z };
+		for (int a = 0; a < 3; ++a) {
+			double inv = 1.0 / d[a];
+			double t0 = (lo[a] - o[a]) * inv;
+			double t1 = (hi[a] - o[a]) * inv;
+			if (inv < 0.0) std::swap(t0, t1);
+			t_min = t0 > t_min ? t0 : t_min;
+			t_max = t1 < t_max ? t1 : t_max;
+			if (t_max < t_min) return false;
+		}
+		return true;
+	}
+};
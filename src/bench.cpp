@@ -0,0 +1,345 @@
+#include "bench.h"
+#include "toon_shader.h"
+#include "bvh_mesh.h"
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstring>
+#include <cmath>
+#include <limits>
+
+namespace {
+	using Clock = std::chrono::steady_clock;
+
+	/// @brief 自 start 起经过的纳秒数
+	static double nanosSince(Clock::time_point start) {
+		return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+	}
+
+	/// @brief 均匀分布的随机单位向量
+	static Vec3 randomUnit(std::mt19937_64& rng) {
+		std::normal_distribution<double> n(0.0, 1.0);
+		for (;;) {
+			Vec3 v(n(rng), n(rng), n(rng));
+			if (v.length_squared() > 1e-12) return v.normalized();
+		}
+	}
+
+	/// @brief 原先的 Moller-Trumbore 测试（EPS 为行列式阈值），作为基准保留
+	static bool mollerTrumbore(const Vec3& v0, const Vec3& v1, const Vec3& v2, const Ray& r,
+		double t_min, double t_max, double& t) {
+		const double EPS = 1e-8;
+		Vec3 e1 = v1 - v0;
+		Vec3 e2 = v2 - v0;
+		Vec3 pvec = Vec3::cross(r.direction, e2);
+		double det = Vec3::dot(e1, pvec);
+		if (std::fabs(det) < EPS) return false;
+		double invDet = 1.0 / det;
+
+		Vec3 tvec = r.origin - v0;
+		double u = Vec3::dot(tvec, pvec) * invDet;
+		if (u < 0.0 || u > 1.0) return false;
+
+		Vec3 qvec = Vec3::cross(tvec, e1);
+		double v = Vec3::dot(r.direction, qvec) * invDet;
+		if (v < 0.0 || u + v > 1.0) return false;
+
+		t = Vec3::dot(e2, qvec) * invDet;
+		return t >= t_min && t <= t_max;
+	}
+
+	/// @brief 起伏球面网格：rings x segments 个四边形，半径随经纬度正弦起伏；接缝与两极共用顶点，网格封闭
+	static MeshData bumpySphere(int rings, int segments) {
+		const double kPi = 3.14159265358979323846;
+		MeshData mesh;
+		mesh.positions.push_back(Vec3(0.0, 1.0, 0.0));
+		for (int i = 1; i < rings; ++i) {
+			const double theta = kPi * i / rings;
+			for (int j = 0; j < segments; ++j) {
+				const double phi = 2.0 * kPi * j / segments;
+				const double r = 1.0 + 0.03 * std::sin(5.0 * theta) * std::sin(7.0 * phi);
+				mesh.positions.push_back(Vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)) * r);
+			}
+		}
+		mesh.positions.push_back(Vec3(0.0, -1.0, 0.0));
+		auto vertex = [rings, segments](int i, int j) {
+			if (i == 0) return std::uint32_t(0);
+			if (i == rings) return std::uint32_t((rings - 1) * segments + 1);
+			return std::uint32_t(1 + (i - 1) * segments + j % segments);
+		};
+		for (int i = 0; i < rings; ++i) {
+			for (int j = 0; j < segments; ++j) {
+				const std::uint32_t quad[4] = { vertex(i, j), vertex(i + 1, j), vertex(i + 1, j + 1), vertex(i, j + 1) };
+				// 两极的四边形退化为一个三角形
+				if (i != rings - 1) {
+					mesh.indices.insert(mesh.indices.end(), { quad[0], quad[1], quad[2] });
+					mesh.faceMaterials.push_back(0);
+				}
+				if (i != 0) {
+					mesh.indices.insert(mesh.indices.end(), { quad[0], quad[2], quad[3] });
+					mesh.faceMaterials.push_back(0);
+				}
+			}
+		}
+		return mesh;
+	}
+}
+
+bool Bench::toonKernel(int samples) {
+	samples = std::max(1, samples);
+	std::mt19937_64 rng(580);
+	Material material;
+	material.albedo = Vec3(0.9, 0.25, 0.25);
+	material.shininess = 64.0;
+
+	// 随机击中：法线与视线方向随机，视线在法线一侧的半球内
+	std::vector<HitRecord> hits(samples);
+	std::vector<Vec3> views(samples);
+	std::vector<char> shadows(samples);
+	std::uniform_int_distribution<int> coin(0, 3);
+	for (int i = 0; i < samples; ++i) {
+		hits[i].normal = randomUnit(rng);
+		hits[i].material = &material;
+		Vec3 v = randomUnit(rng);
+		views[i] = Vec3::dot(v, hits[i].normal) < 0.0 ? -v : v;
+		shadows[i] = coin(rng) == 0;
+	}
+
+	Light light;
+	light.direction = Vec3(-0.7, -1.0, -0.4).normalized();
+	// 与 main.cpp 相同的参数，再依次关闭/改变各开关
+	ToonParams base;
+	base.specularThreshold1 = 0.55;
+	base.specularThreshold2 = 0.25;
+	base.specColorB = Vec3(0.8, 0.8, 0.8);
+	base.rampColors = { Vec3(0.0, 0.1, 0.1), Vec3(0.2, 0.4, 0.7), Vec3(0.8, 0.7, 0.8) };
+	base.rampPositions = { 0.47, 0.5, 0.53 };
+	base.rimColor = Vec3(0.0, 0.0, 1.0);
+	base.rimIntensity = 0.6;
+	base.rimPower = 1.0;
+	base.outputBrightness = 0.5;
+	std::vector<ToonParams> configs(4, base);
+	configs[1].enableRim = false;
+	configs[2].rimThreshold = 0.15;
+	configs[3].enableRim = false;
+	configs[3].rampColors = { Vec3(0.6, 0.6, 0.6) };
+	configs[3].rampPositions.clear();
+	configs[3].specularThreshold1 = configs[3].specularThreshold2 = 1.0;
+
+	// 批量输入按渲染器的分块大小分段提交，与 shadeTile 的调用方式一致
+	const int kBatch = 16 * 16;
+	std::vector<ToonShadeInput> inputs(samples);
+	for (int i = 0; i < samples; ++i) {
+		inputs[i].normal = hits[i].normal;
+		inputs[i].viewDir = views[i];
+		inputs[i].material = &material;
+		inputs[i].inShadow = shadows[i] != 0;
+	}
+
+	std::cout << "Toon kernel benchmark: " << samples << " random hits per variant, batches of " << kBatch << "\n";
+	bool same = true;
+	std::vector<Vec3> perPixel(samples), batched(samples);
+	std::vector<ToonShadeInfo> pixelInfo(samples), batchInfo(samples);
+	for (const ToonParams& params : configs) {
+		// 两种方式都只构建一次内核，差别只在逐像素间接调用与整批调用
+		const ToonShader::Kernel kernel(params, light);
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < samples; ++i) perPixel[i] = kernel.shade(hits[i], views[i], shadows[i] != 0, &pixelInfo[i]);
+		const double pixelNs = nanosSince(start) / samples;
+
+		start = Clock::now();
+		for (int b = 0; b < samples; b += kBatch) {
+			const int n = std::min(kBatch, samples - b);
+			kernel.shade(inputs.data() + b, size_t(n), batched.data() + b, batchInfo.data() + b);
+		}
+		const double batchNs = nanosSince(start) / samples;
+
+		bool variantSame = std::memcmp(perPixel.data(), batched.data(), perPixel.size() * sizeof(Vec3)) == 0;
+		for (int i = 0; variantSame && i < samples; ++i) {
+			variantSame = pixelInfo[i].silhouette == batchInfo[i].silhouette && pixelInfo[i].rampSegment == batchInfo[i].rampSegment
+				&& pixelInfo[i].specularLevel == batchInfo[i].specularLevel && pixelInfo[i].shadowed == batchInfo[i].shadowed;
+		}
+		same = same && variantSame;
+		std::cout << "  " << kernel.name() << ": per pixel " << pixelNs << " ns/px, batched " << batchNs
+			<< " ns/px (" << pixelNs / batchNs << "x)" << (variantSame ? "" : " RESULTS DIFFER") << "\n";
+	}
+	return same;
+}
+
+bool Bench::bvhLayouts(const std::string& objPath, int rays) {
+	rays = std::max(1, rays);
+	MeshData mesh;
+	if (objPath.empty()) {
+		mesh = bumpySphere(256, 512);
+	}
+	else {
+		MaterialTable materials;
+		if (!MeshLoader::loadOBJMesh(objPath, materials, materials.add(Material(), "default"), mesh)) return false;
+	}
+	std::cout << "BVH layout benchmark: " << mesh.triangleCount() << " triangles ("
+		<< (objPath.empty() ? "generated sphere" : objPath) << "), " << rays << " rays\n";
+
+	BvhOptions wideOptions;
+	BvhOptions binaryOptions;
+	binaryOptions.layout = BvhLayout::Binary;
+	const BvhMesh wide(mesh, wideOptions);
+	const BvhMesh binary(mesh, binaryOptions);
+	AABB box;
+	if (!wide.boundingBox(box)) {
+		std::cerr << "BVH benchmark: empty mesh\n";
+		return false;
+	}
+
+	// 光线从 2.5 倍包围球半径处射向网格中部，约一半击中
+	std::mt19937_64 rng(581);
+	std::uniform_real_distribution<double> offset(-1.0, 1.0);
+	const Vec3 center = (box.min + box.max) * 0.5;
+	const double radius = (box.max - box.min).length() * 0.5;
+	std::vector<Ray> samples;
+	samples.reserve(rays);
+	for (int i = 0; i < rays; ++i) {
+		Vec3 origin = center + randomUnit(rng) * (2.5 * radius);
+		Vec3 target = center + Vec3(offset(rng), offset(rng), offset(rng)) * (0.6 * radius);
+		samples.push_back(Ray(origin, (target - origin).normalized()));
+	}
+
+	const double INF = std::numeric_limits<double>::infinity();
+	struct Result { bool hit; double t; bool occluded; };
+	auto run = [&](const BvhMesh& bvh, std::vector<Result>& out, double& closestNs, double& occludedNs) {
+		out.resize(samples.size());
+		Clock::time_point start = Clock::now();
+		for (size_t i = 0; i < samples.size(); ++i) {
+			HitRecord rec;
+			out[i].hit = bvh.hit(samples[i], 1e-4, INF, rec);
+			out[i].t = out[i].hit ? rec.t : INF;
+		}
+		closestNs = nanosSince(start) / double(samples.size());
+		start = Clock::now();
+		for (size_t i = 0; i < samples.size(); ++i) out[i].occluded = bvh.occluded(samples[i], 1e-4, INF);
+		occludedNs = nanosSince(start) / double(samples.size());
+	};
+
+	std::vector<Result> wideResults, binaryResults;
+	double binaryClosest, binaryOccluded, wideClosest, wideOccluded;
+	run(binary, binaryResults, binaryClosest, binaryOccluded);
+	run(wide, wideResults, wideClosest, wideOccluded);
+
+	long long mismatches = 0, hits = 0;
+	for (size_t i = 0; i < samples.size(); ++i) {
+		const Result& a = binaryResults[i];
+		const Result& b = wideResults[i];
+		hits += a.hit ? 1 : 0;
+		if (a.hit != b.hit || a.t != b.t || a.occluded != b.occluded) ++mismatches;
+	}
+
+	// 抽样与逐三角形求交比较，确认两种格式都没有漏掉三角形
+	const std::vector<Triangle>& tris = wide.triangles();
+	const size_t checked = std::min<size_t>(samples.size(), std::max<size_t>(16, 50000000 / std::max<size_t>(1, tris.size())));
+	long long bruteMismatches = 0;
+	for (size_t i = 0; i < checked; ++i) {
+		double closest = INF;
+		for (const Triangle& tri : tris) {
+			HitRecord rec;
+			if (tri.hit(samples[i], 1e-4, closest, rec)) closest = rec.t;
+		}
+		if ((closest < INF) != binaryResults[i].hit || (binaryResults[i].hit && closest != binaryResults[i].t)) ++bruteMismatches;
+	}
+
+	auto report = [](const char* name, const BvhMesh& bvh, double closestNs, double occludedNs) {
+		const BvhStats& s = bvh.stats();
+		std::cout << "  " << name << ": " << s.nodes << " nodes, " << double(s.nodeBytes) / double(std::max<size_t>(1, s.triangles))
+			<< " node bytes/tri, closest hit " << closestNs << " ns/ray (" << 1000.0 / closestNs << " Mrays/s), occluded "
+			<< occludedNs << " ns/ray (" << 1000.0 / occludedNs << " Mrays/s)\n";
+	};
+	report("binary", binary, binaryClosest, binaryOccluded);
+	report("wide4 quantized", wide, wideClosest, wideOccluded);
+	std::cout << "  speedup: closest hit " << binaryClosest / wideClosest << "x, occluded " << binaryOccluded / wideOccluded
+		<< "x; " << hits << " hits, " << mismatches << " layout mismatches, " << bruteMismatches << " of " << checked
+		<< " brute-force mismatches\n";
+	return mismatches == 0 && bruteMismatches == 0;
+}
+
+bool Bench::triangleTests(int rays) {
+	rays = std::max(1, rays);
+	// 封闭网格：光线从外部射向顶点与边中点，恰好落在相邻三角形的公共边上
+	const MeshData mesh = bumpySphere(24, 48);
+	std::vector<Triangle> tris;
+	for (size_t f = 0; f < mesh.triangleCount(); ++f) {
+		tris.emplace_back(mesh.positions[mesh.indices[3 * f]], mesh.positions[mesh.indices[3 * f + 1]],
+			mesh.positions[mesh.indices[3 * f + 2]], mesh.faceMaterials[f]);
+	}
+	std::mt19937_64 rng(582);
+	std::uniform_int_distribution<size_t> pickFace(0, mesh.triangleCount() - 1);
+	std::uniform_int_distribution<int> pickCorner(0, 2);
+	std::vector<Ray> samples;
+	samples.reserve(rays);
+	for (int i = 0; i < rays; ++i) {
+		const size_t f = pickFace(rng);
+		const int c = pickCorner(rng);
+		const Vec3& a = mesh.positions[mesh.indices[3 * f + c]];
+		const Vec3& b = mesh.positions[mesh.indices[3 * f + (c + 1) % 3]];
+		// 一半射向顶点，一半射向边中点
+		const Vec3 target = i % 2 == 0 ? a : (a + b) * 0.5;
+		// 起点在面法线外侧的窄锥内，光线横穿表面而不是擦过轮廓
+		const Vec3& d = mesh.positions[mesh.indices[3 * f + (c + 2) % 3]];
+		Vec3 normal = Vec3::cross(b - a, d - a).normalized();
+		if (Vec3::dot(normal, target) < 0.0) normal = -normal;
+		const Vec3 origin = target + (normal + randomUnit(rng) * 0.3).normalized() * 3.0;
+		samples.push_back(Ray(origin, (target - origin).normalized()));
+	}
+	std::cout << "Triangle test benchmark: " << rays << " rays at vertices and edge midpoints of a closed mesh, "
+		<< tris.size() << " triangles each\n";
+
+	const double INF = std::numeric_limits<double>::infinity();
+	const double tests = double(rays) * double(tris.size());
+	std::vector<double> reference(samples.size()), perTest(samples.size()), perRay(samples.size());
+
+	Clock::time_point start = Clock::now();
+	for (size_t i = 0; i < samples.size(); ++i) {
+		double closest = INF;
+		for (const Triangle& tri : tris) {
+			double t;
+			if (mollerTrumbore(tri.vertex(0), tri.vertex(1), tri.vertex(2), samples[i], 1e-4, closest, t)) closest = t;
+		}
+		reference[i] = closest;
+	}
+	const double referenceNs = nanosSince(start) / tests;
+
+	start = Clock::now();
+	for (size_t i = 0; i < samples.size(); ++i) {
+		double closest = INF;
+		for (const Triangle& tri : tris) {
+			HitRecord rec;
+			if (tri.hit(samples[i], 1e-4, closest, rec)) closest = rec.t;
+		}
+		perTest[i] = closest;
+	}
+	const double perTestNs = nanosSince(start) / tests;
+
+	start = Clock::now();
+	for (size_t i = 0; i < samples.size(); ++i) {
+		const TriangleRay setup(samples[i]);
+		double closest = INF;
+		for (const Triangle& tri : tris) {
+			double t;
+			if (tri.intersect(setup, 1e-4, closest, t)) closest = t;
+		}
+		perRay[i] = closest;
+	}
+	const double perRayNs = nanosSince(start) / tests;
+
+	// 光线从网格外射向网格上的点，最近击中不可能晚于两种测试中较近的那个；晚了说明从边或顶点漏过了前表面
+	long long referenceLeaks = 0, watertightLeaks = 0, callMismatches = 0;
+	for (size_t i = 0; i < samples.size(); ++i) {
+		const double nearest = std::min(reference[i], perRay[i]);
+		referenceLeaks += reference[i] > nearest * (1.0 + 1e-9) ? 1 : 0;
+		watertightLeaks += perRay[i] > nearest * (1.0 + 1e-9) || perRay[i] == INF ? 1 : 0;
+		callMismatches += perTest[i] != perRay[i] ? 1 : 0;
+	}
+	std::cout << "  Moller-Trumbore: " << referenceNs << " ns/test, " << referenceLeaks << " rays leaked through the nearest surface\n";
+	std::cout << "  watertight, setup per test: " << perTestNs << " ns/test\n";
+	std::cout << "  watertight, setup per ray: " << perRayNs << " ns/test (" << referenceNs / perRayNs << "x vs Moller-Trumbore), "
+		<< watertightLeaks << " rays leaked, " << callMismatches << " mismatches with setup per test\n";
+	return watertightLeaks == 0 && callMismatches == 0;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <string>
+
+// Micro-benchmarks behind main's --bench-* options. Each one times an optimized path against the
+// path it replaced on synthetic or loaded input, checks that both give the same results and
+// prints the time per item. Single-threaded, so the numbers compare per-core cost.
+namespace Bench {
+	/// @brief 着色内核：整批调用的 Kernel::shade 与逐像素调用的 Kernel::shade（内核都只构建一次）
+	/// @param samples 随机击中点数
+	/// @return 两条路径的结果逐位一致时返回 true
+	bool toonKernel(int samples = 1000000);
+
+	/// @brief BVH 节点格式：量化4叉节点与未压缩二叉节点的最近击中/遮挡查询吞吐
+	/// @param objPath OBJ 网格路径；为空时使用程序生成的起伏球面（约 26 万三角形）
+	/// @param rays 随机光线数（从包围球外射向网格中部）
+	/// @return 两种格式的击中结果（是否击中与 t）逐条一致，且抽样光线与逐三角形求交一致时返回 true
+	bool bvhLayouts(const std::string& objPath = "", int rays = 200000);
+
+	/// @brief 光线/三角形求交：水密测试（逐光线预计算、逐次预计算）与原先的 Moller-Trumbore 测试
+	/// @param rays 射向封闭网格顶点与边中点的光线数（每条与全部三角形逐一求交）
+	/// @return 水密测试没有光线从网格的边或顶点漏过，且两种水密调用方式结果一致时返回 true
+	bool triangleTests(int rays = 4000);
+}
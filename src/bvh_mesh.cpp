@@ -0,0 +1,644 @@
+#include "bvh_mesh.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TOON_BVH_SSE2 1
+#endif
+
+namespace {
+	/// @brief 叶子三角形数上限（WideNode::leafCount 为8位；SAH 选择成叶也不超过此值）
+	const std::uint32_t kMaxLeafSize = 16;
+	/// @brief 超过此深度后改用中位数划分，限制遍历栈深度
+	const int kMedianSplitDepth = 40;
+	/// @brief WideNode::leafCount 的特殊值：该子节点为延迟子树（child 为子树编号）
+	const std::uint8_t kDeferredChild = 0xFF;
+	/// @brief 预先构建层数上限（限制遍历栈深度）
+	const int kMaxLazyDepth = 16;
+	/// @brief 遍历栈的栈上容量（4叉树每层最多净增3项，二叉树1项；正常深度远低于此值）
+	const int kStackSize = 256;
+	/// @brief 最近击中三角形下标的“未击中”值
+	const std::uint32_t kNoTriangle = 0xFFFFFFFFu;
+	/// @brief slab 区间放宽系数：吸收包围盒与三角形求交各自的舍入误差（约 3 ulp）
+	const double kRobustScale = 1.0 + 6.0 * std::numeric_limits<double>::epsilon();
+
+	static double surfaceArea(const AABB& b) {
+		if (b.empty()) return 0.0;
+		Vec3 d = b.max - b.min;
+		return 2.0 * (d.x * d.y + d.y * d.z + d.z * d.x);
+	}
+
+	/// @brief 双精度包围盒 slab 测试，命中时返回进入距离
+	static bool slab(const AABB& b, const double* o, const double* inv, double t_min, double t_max, double& tNear) {
+		const double lo[3] = { b.min.x, b.min.y, b.min.z };
+		const double hi[3] = { b.max.x, b.max.y, b.max.z };
+		for (int a = 0; a < 3; ++a) {
+			double t0 = (lo[a] - o[a]) * inv[a];
+			double t1 = (hi[a] - o[a]) * inv[a];
+			if (inv[a] < 0.0) std::swap(t0, t1);
+			t_min = t0 > t_min ? t0 : t_min;   // NaN（起点在平面上且方向平行）时保持原值
+			t_max = t1 < t_max ? t1 : t_max;
+		}
+		tNear = t_min;
+		return t_min <= t_max * kRobustScale;
+	}
+
+	/// @brief 遍历栈：先用栈上数组，满了再整体搬到堆上并按倍数扩容。
+	/// 退化网格（大量重合或共面三角形）可能让树深超出 kStackSize 所能容纳的范围，
+	/// 延迟子树的深度在构建前也无从得知，因此不能只靠固定容量
+	template <typename T>
+	class TraversalStack {
+	public:
+		TraversalStack() = default;
+		TraversalStack(const TraversalStack&) = delete;
+		TraversalStack& operator=(const TraversalStack&) = delete;
+
+		bool empty() const { return sp == 0; }
+		T pop() { return data[--sp]; }
+		void push(const T& value) {
+			if (sp == capacity) grow();
+			data[sp++] = value;
+		}
+
+	private:
+		void grow() {
+			const bool onStack = data == local;
+			heap.resize(size_t(capacity) * 2);
+			if (onStack) std::copy(local, local + sp, heap.begin());
+			data = heap.data();
+			capacity *= 2;
+		}
+
+		T local[kStackSize];
+		std::vector<T> heap;
+		T* data = local;
+		int capacity = kStackSize;
+		int sp = 0;
+	};
+
+	/// @brief 遍历栈元素：count>0 为叶子（index 为首个三角形），否则为节点下标
+	struct StackEntry {
+		std::uint32_t index;
+		std::uint32_t count;
+		double tNear;
+	};
+}
+
+/// @brief 4叉遍历栈元素：nodes 为 index 所在的节点数组（主树或某个延迟子树）
+struct BvhMesh::WideEntry {
+	const WideNode* nodes;
+	std::uint32_t index;
+	std::uint32_t count;    // 0 内部节点，kDeferredChild 延迟子树（index 为子树编号），否则叶子
+	double tNear;
+};
+
+/// @brief 构建树节点
+struct BvhMesh::BuildNode {
+	AABB bounds;
+	int left = -1;               // 内部节点的子节点（-1 表示叶子）
+	int right = -1;
+	std::uint32_t first = 0;     // 叶子的三角形范围（refs 下标）
+	std::uint32_t count = 0;
+	bool deferred = false;       // 延迟子树（叶子形式，暂不划分）
+	bool leaf() const { return left < 0; }
+};
+
+/// @brief 构建期数据
+struct BvhMesh::BuildContext {
+	std::vector<AABB> triBounds;
+	std::vector<Vec3> centroids;
+	std::vector<std::uint32_t> refs;
+	std::vector<BuildNode> nodes;
+	std::uint32_t leafSize = 4;
+	int bins = 12;
+	bool longestAxisOnly = false;  // 只在质心包围盒最长轴上做 SAH（延迟构建的预构建层）
+};
+
+BvhMesh::BvhMesh(const MeshData& mesh, const BvhOptions& options) : nodeLayout(options.layout) {
+	auto start = std::chrono::steady_clock::now();
+	const size_t n = mesh.triangleCount();
+
+	BuildContext ctx;
+	leafSize = std::uint32_t(std::max(1, std::min(int(kMaxLeafSize), options.leafSize)));
+	sahBins = std::max(2, std::min(64, options.sahBins));
+	ctx.leafSize = leafSize;
+	ctx.bins = sahBins;
+	const bool lazy = options.lazyBuild && nodeLayout == BvhLayout::Wide4Quantized;
+	ctx.longestAxisOnly = lazy;
+	ctx.triBounds.resize(n);
+	ctx.centroids.resize(n);
+	ctx.refs.resize(n);
+	std::vector<Triangle> source;
+	source.reserve(n);
+	for (size_t f = 0; f < n; ++f) {
+		const Vec3& a = mesh.positions[mesh.indices[3 * f + 0]];
+		const Vec3& b = mesh.positions[mesh.indices[3 * f + 1]];
+		const Vec3& c = mesh.positions[mesh.indices[3 * f + 2]];
+		source.emplace_back(a, b, c, mesh.faceMaterials[f]);
+		source.back().boundingBox(ctx.triBounds[f]);
+		ctx.centroids[f] = (a + b + c) * (1.0 / 3.0);
+		ctx.refs[f] = std::uint32_t(f);
+	}
+
+	buildStats.triangles = n;
+	if (n > 0) {
+		ctx.nodes.reserve(2 * n / ctx.leafSize + 1);
+		buildNode(ctx, 0, std::uint32_t(n), 0,
+			lazy ? std::max(1, std::min(kMaxLazyDepth, options.lazyDepth)) : std::numeric_limits<int>::max());
+		bounds = ctx.nodes[0].bounds;
+
+		// 三角形按叶子顺序重排，叶子只需记录连续范围
+		tris.reserve(n);
+		for (std::uint32_t ref : ctx.refs) tris.push_back(source[ref]);
+
+		if (nodeLayout == BvhLayout::Binary) {
+			binaryNodes.reserve(ctx.nodes.size());
+			binaryNodes.emplace_back();
+			buildStats.depth = flattenBinary(ctx.nodes, 0, 0);
+			buildStats.nodes = binaryNodes.size();
+			buildStats.nodeBytes = binaryNodes.size() * sizeof(BinaryNode);
+		}
+		else {
+			wideNodes.reserve(ctx.nodes.size() / 2 + 1);
+			flattenWide(ctx.nodes, 0, 1, wideNodes, 0, buildStats.depth, &lazySubtrees);
+			buildStats.nodes = wideNodes.size();
+			buildStats.nodeBytes = wideNodes.size() * sizeof(WideNode);
+			buildStats.lazySubtrees = lazySubtrees.size();
+		}
+		for (const BuildNode& node : ctx.nodes) buildStats.leaves += node.leaf() && !node.deferred ? 1 : 0;
+	}
+	buildStats.buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int BvhMesh::buildNode(BuildContext& ctx, std::uint32_t begin, std::uint32_t end, int depth, int maxDepth) {
+	const int index = int(ctx.nodes.size());
+	ctx.nodes.emplace_back();
+
+	AABB bounds, centroidBounds;
+	for (std::uint32_t i = begin; i < end; ++i) {
+		bounds.expand(ctx.triBounds[ctx.refs[i]]);
+		centroidBounds.expand(ctx.centroids[ctx.refs[i]]);
+	}
+	ctx.nodes[index].bounds = bounds;
+
+	const std::uint32_t count = end - begin;
+	auto makeLeaf = [&]() {
+		ctx.nodes[index].first = begin;
+		ctx.nodes[index].count = count;
+		return index;
+	};
+	if (count <= ctx.leafSize) return makeLeaf();
+	if (depth >= maxDepth) {
+		ctx.nodes[index].deferred = true;
+		return makeLeaf();
+	}
+
+	// 分箱 SAH：三个轴各分 bins 个箱，代价 = 1 + (A_l N_l + A_r N_r) / A
+	int bestAxis = -1, bestSplit = 0;
+	double bestCost = std::numeric_limits<double>::infinity();
+	const double parentArea = surfaceArea(bounds);
+	std::vector<AABB> binBounds(ctx.bins), rightBounds(ctx.bins);
+	std::vector<std::uint32_t> binCount(ctx.bins);
+	if (depth < kMedianSplitDepth && parentArea > 0.0) {
+		Vec3 extent = centroidBounds.max - centroidBounds.min;
+		const int longest = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+		for (int axis = 0; axis < 3; ++axis) {
+			if (ctx.longestAxisOnly && axis != longest) continue;
+			double lo = centroidBounds.min[axis], hi = centroidBounds.max[axis];
+			if (!(hi > lo)) continue;
+			double scale = ctx.bins / (hi - lo);
+			std::fill(binBounds.begin(), binBounds.end(), AABB());
+			std::fill(binCount.begin(), binCount.end(), 0u);
+			for (std::uint32_t i = begin; i < end; ++i) {
+				std::uint32_t ref = ctx.refs[i];
+				int b = std::min(ctx.bins - 1, int((ctx.centroids[ref][axis] - lo) * scale));
+				binBounds[b].expand(ctx.triBounds[ref]);
+				++binCount[b];
+			}
+			AABB acc;
+			for (int b = ctx.bins - 1; b > 0; --b) {
+				acc.expand(binBounds[b]);
+				rightBounds[b] = acc;
+			}
+			acc = AABB();
+			std::uint32_t leftCount = 0;
+			for (int b = 0; b + 1 < ctx.bins; ++b) {
+				acc.expand(binBounds[b]);
+				leftCount += binCount[b];
+				std::uint32_t rightCount = count - leftCount;
+				if (leftCount == 0 || rightCount == 0) continue;
+				double cost = 1.0 + (surfaceArea(acc) * leftCount + surfaceArea(rightBounds[b + 1]) * rightCount) / parentArea;
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = b + 1;
+				}
+			}
+		}
+		if (bestAxis >= 0 && bestCost >= double(count) && count <= kMaxLeafSize) return makeLeaf();
+	}
+
+	std::uint32_t mid;
+	if (bestAxis >= 0) {
+		double lo = centroidBounds.min[bestAxis], hi = centroidBounds.max[bestAxis];
+		double scale = ctx.bins / (hi - lo);
+		const BuildContext& c = ctx;
+		auto* split = std::partition(ctx.refs.data() + begin, ctx.refs.data() + end, [&](std::uint32_t ref) {
+			return std::min(c.bins - 1, int((c.centroids[ref][bestAxis] - lo) * scale)) < bestSplit;
+		});
+		mid = std::uint32_t(split - ctx.refs.data());
+	}
+	else {
+		// 质心重合或深度过大：沿最长轴按中位数对半分
+		Vec3 extent = centroidBounds.max - centroidBounds.min;
+		int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+		mid = begin + count / 2;
+		std::nth_element(ctx.refs.data() + begin, ctx.refs.data() + mid, ctx.refs.data() + end,
+			[&](std::uint32_t a, std::uint32_t b) { return ctx.centroids[a][axis] < ctx.centroids[b][axis]; });
+	}
+
+	int left = buildNode(ctx, begin, mid, depth + 1, maxDepth);
+	int right = buildNode(ctx, mid, end, depth + 1, maxDepth);
+	ctx.nodes[index].left = left;
+	ctx.nodes[index].right = right;
+	return index;
+}
+
+int BvhMesh::flattenBinary(const std::vector<BuildNode>& build, int buildIndex, std::uint32_t slot) {
+	const BuildNode& src = build[buildIndex];
+	binaryNodes[slot].bounds = src.bounds;
+	if (src.leaf()) {
+		binaryNodes[slot].index = src.first;
+		binaryNodes[slot].count = src.count;
+		return 1;
+	}
+	// 两个子节点相邻存放
+	std::uint32_t children = std::uint32_t(binaryNodes.size());
+	binaryNodes.emplace_back();
+	binaryNodes.emplace_back();
+	binaryNodes[slot].index = children;
+	binaryNodes[slot].count = 0;
+	int dl = flattenBinary(build, src.left, children);
+	int dr = flattenBinary(build, src.right, children + 1);
+	return 1 + std::max(dl, dr);
+}
+
+std::uint32_t BvhMesh::flattenWide(const std::vector<BuildNode>& build, int buildIndex, int depth,
+	std::vector<WideNode>& out, std::uint32_t triOffset, int& maxDepth,
+	std::vector<std::unique_ptr<LazySubtree>>* lazyOut) {
+	maxDepth = std::max(maxDepth, depth);
+
+	// 收集至多4个子节点：反复展开表面积最大的内部子节点
+	int children[4];
+	int childCount = 0;
+	if (build[buildIndex].leaf()) {
+		children[childCount++] = buildIndex;
+	}
+	else {
+		children[childCount++] = build[buildIndex].left;
+		children[childCount++] = build[buildIndex].right;
+		while (childCount < 4) {
+			int best = -1;
+			double bestArea = -1.0;
+			for (int c = 0; c < childCount; ++c) {
+				const BuildNode& node = build[children[c]];
+				if (!node.leaf() && surfaceArea(node.bounds) > bestArea) {
+					bestArea = surfaceArea(node.bounds);
+					best = c;
+				}
+			}
+			if (best < 0) break;
+			int opened = children[best];
+			children[best] = build[opened].left;
+			children[childCount++] = build[opened].right;
+		}
+	}
+
+	const std::uint32_t slot = std::uint32_t(out.size());
+	out.emplace_back();
+	WideNode node;
+	std::memset(&node, 0, sizeof(node));
+	node.childCount = std::uint8_t(childCount);
+
+	// 每个轴：原点取不大于父盒最小值的 float，步长取 2 的幂使 255 格覆盖父盒；
+	// 子盒下界向下、上界向上取整，解码结果严格包含原子盒
+	const AABB& parent = build[buildIndex].bounds;
+	for (int axis = 0; axis < 3; ++axis) {
+		double parentLo = parent.min[axis], parentHi = parent.max[axis];
+		float origin = float(parentLo);
+		if (double(origin) > parentLo) origin = std::nextafter(origin, -std::numeric_limits<float>::infinity());
+		int exponent;
+		std::frexp(std::max(parentHi - double(origin), std::numeric_limits<double>::min()) / 255.0, &exponent);
+		for (;; ++exponent) {
+			exponent = std::max(-128, std::min(127, exponent));
+			const double step = std::ldexp(1.0, exponent);
+			bool fits = true;
+			for (int c = 0; c < childCount && fits; ++c) {
+				const AABB& box = build[children[c]].bounds;
+				double lo = box.min[axis], hi = box.max[axis];
+				double qlo = std::max(0.0, std::floor((lo - double(origin)) / step));
+				while (qlo > 0.0 && double(origin) + qlo * step > lo) qlo -= 1.0;
+				double qhi = std::max(0.0, std::ceil((hi - double(origin)) / step));
+				while (double(origin) + qhi * step < hi) qhi += 1.0;
+				if (qhi > 255.0) { fits = false; break; }
+				node.lo[axis][c] = std::uint8_t(qlo);
+				node.hi[axis][c] = std::uint8_t(qhi);
+			}
+			if (fits || exponent == 127) break;
+		}
+		node.origin[axis] = origin;
+		node.exponent[axis] = std::int8_t(exponent);
+	}
+
+	for (int c = 0; c < childCount; ++c) {
+		const BuildNode& child = build[children[c]];
+		if (child.deferred && lazyOut) {
+			std::unique_ptr<LazySubtree> subtree(new LazySubtree());
+			subtree->first = child.first + triOffset;
+			subtree->count = child.count;
+			node.child[c] = std::uint32_t(lazyOut->size());
+			node.leafCount[c] = kDeferredChild;
+			lazyOut->push_back(std::move(subtree));
+		}
+		else if (child.leaf()) {
+			node.child[c] = child.first + triOffset;
+			node.leafCount[c] = std::uint8_t(child.count);
+			maxDepth = std::max(maxDepth, depth + 1);
+		}
+		else {
+			node.child[c] = flattenWide(build, children[c], depth + 1, out, triOffset, maxDepth, lazyOut);
+		}
+	}
+	out[slot] = node;
+	return slot;
+}
+
+const BvhMesh::WideNode* BvhMesh::expand(std::uint32_t index) const {
+	LazySubtree& subtree = *lazySubtrees[index];
+	const WideNode* root = subtree.root.load(std::memory_order_acquire);
+	if (root) return root;
+
+	std::lock_guard<std::mutex> guard(subtree.lock);
+	root = subtree.root.load(std::memory_order_relaxed);
+	if (root) return root;
+
+	// 只有持锁线程会访问此范围的三角形（其他光线在 root 发布前不会进入该子树）
+	const std::uint32_t first = subtree.first, count = subtree.count;
+	BuildContext ctx;
+	ctx.leafSize = leafSize;
+	ctx.bins = sahBins;
+	ctx.triBounds.resize(count);
+	ctx.centroids.resize(count);
+	ctx.refs.resize(count);
+	for (std::uint32_t i = 0; i < count; ++i) {
+		const Triangle& tri = tris[first + i];
+		tri.boundingBox(ctx.triBounds[i]);
+		ctx.centroids[i] = (tri.vertex(0) + tri.vertex(1) + tri.vertex(2)) * (1.0 / 3.0);
+		ctx.refs[i] = i;
+	}
+	ctx.nodes.reserve(2 * count / leafSize + 1);
+	buildNode(ctx, 0, count, 0, std::numeric_limits<int>::max());
+
+	std::vector<Triangle> ordered;
+	ordered.reserve(count);
+	for (std::uint32_t ref : ctx.refs) ordered.push_back(tris[first + ref]);
+	std::copy(ordered.begin(), ordered.end(), tris.begin() + first);
+
+	int depth = 0;
+	subtree.nodes.reserve(ctx.nodes.size() / 2 + 1);
+	flattenWide(ctx.nodes, 0, 1, subtree.nodes, first, depth, nullptr);
+	root = subtree.nodes.data();
+	expandedCount.fetch_add(1, std::memory_order_relaxed);
+	subtree.root.store(root, std::memory_order_release);
+	return root;
+}
+
+void BvhMesh::expandAll() const {
+	for (std::uint32_t i = 0; i < std::uint32_t(lazySubtrees.size()); ++i) expand(i);
+}
+
+int BvhMesh::intersectChildren(const WideNode& node, const double* o, const double* inv,
+	double t_min, double t_max, double* tNear) {
+	// t = (origin + q * step - o) * inv = base + q * scale，每轴只算一次 base/scale；
+	// 两项相消时的舍入误差按其量级补到区间两端，保证仍是保守测试
+	double base[3], scale[3], slack = 0.0;
+	for (int a = 0; a < 3; ++a) {
+		base[a] = (double(node.origin[a]) - o[a]) * inv[a];
+		scale[a] = std::ldexp(inv[a], node.exponent[a]);
+		double magnitude = std::fabs(base[a]) + 255.0 * std::fabs(scale[a]);
+		if (magnitude < std::numeric_limits<double>::infinity()) slack = std::max(slack, magnitude);
+	}
+	slack *= 4.0 * std::numeric_limits<double>::epsilon();
+
+#ifdef TOON_BVH_SSE2
+	// 4个子节点分两组（每组2个双精度通道）同时测试
+	__m128d tn01 = _mm_set1_pd(t_min), tn23 = tn01;
+	__m128d tf01 = _mm_set1_pd(t_max), tf23 = tf01;
+	const __m128i zero = _mm_setzero_si128();
+	for (int a = 0; a < 3; ++a) {
+		const std::uint8_t* qNear = inv[a] < 0.0 ? node.hi[a] : node.lo[a];
+		const std::uint8_t* qFar = inv[a] < 0.0 ? node.lo[a] : node.hi[a];
+		std::int32_t packedNear, packedFar;
+		std::memcpy(&packedNear, qNear, 4);
+		std::memcpy(&packedFar, qFar, 4);
+		__m128i n32 = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packedNear), zero), zero);
+		__m128i f32 = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packedFar), zero), zero);
+		const __m128d b = _mm_set1_pd(base[a]), k = _mm_set1_pd(scale[a]);
+		// max/min 在任一操作数为 NaN 时返回第二个操作数，即保持当前区间
+		tn01 = _mm_max_pd(_mm_add_pd(b, _mm_mul_pd(_mm_cvtepi32_pd(n32), k)), tn01);
+		tn23 = _mm_max_pd(_mm_add_pd(b, _mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(n32, 0xEE)), k)), tn23);
+		tf01 = _mm_min_pd(_mm_add_pd(b, _mm_mul_pd(_mm_cvtepi32_pd(f32), k)), tf01);
+		tf23 = _mm_min_pd(_mm_add_pd(b, _mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(f32, 0xEE)), k)), tf23);
+	}
+	const __m128d s = _mm_set1_pd(slack), robust = _mm_set1_pd(kRobustScale);
+	tn01 = _mm_sub_pd(tn01, s);
+	tn23 = _mm_sub_pd(tn23, s);
+	int mask = _mm_movemask_pd(_mm_cmple_pd(tn01, _mm_add_pd(_mm_mul_pd(tf01, robust), s)))
+		| (_mm_movemask_pd(_mm_cmple_pd(tn23, _mm_add_pd(_mm_mul_pd(tf23, robust), s))) << 2);
+	mask &= (1 << node.childCount) - 1;
+	_mm_storeu_pd(tNear, tn01);
+	_mm_storeu_pd(tNear + 2, tn23);
+#else
+	int mask = 0;
+	for (int c = 0; c < node.childCount; ++c) {
+		double tn = t_min, tf = t_max;
+		for (int a = 0; a < 3; ++a) {
+			double t0 = base[a] + node.lo[a][c] * scale[a];
+			double t1 = base[a] + node.hi[a][c] * scale[a];
+			if (inv[a] < 0.0) std::swap(t0, t1);
+			tn = t0 > tn ? t0 : tn;
+			tf = t1 < tf ? t1 : tf;
+		}
+		if (tn - slack <= tf * kRobustScale + slack) {
+			mask |= 1 << c;
+			tNear[c] = tn - slack;
+		}
+	}
+#endif
+	return mask;
+}
+
+bool BvhMesh::hit(const Ray& r, double t_min, double t_max, HitRecord& out_rec) const {
+	if (tris.empty()) return false;
+	return hitPrepared(r, TriangleRay(r), t_min, t_max, out_rec);
+}
+
+bool BvhMesh::occluded(const Ray& r, double t_min, double t_max) const {
+	if (tris.empty()) return false;
+	return occludedPrepared(r, TriangleRay(r), t_min, t_max);
+}
+
+bool BvhMesh::hitPrepared(const Ray& r, const TriangleRay& tray, double t_min, double t_max, HitRecord& out_rec) const {
+	if (tris.empty()) return false;
+	return nodeLayout == BvhLayout::Binary ? hitBinary(r, tray, t_min, t_max, out_rec) : hitWide(r, tray, t_min, t_max, out_rec);
+}
+
+bool BvhMesh::occludedPrepared(const Ray& r, const TriangleRay& tray, double t_min, double t_max) const {
+	if (tris.empty()) return false;
+	return nodeLayout == BvhLayout::Binary ? occludedBinary(r, tray, t_min, t_max) : occludedWide(r, tray, t_min, t_max);
+}
+
+bool BvhMesh::hitWide(const Ray& r, const TriangleRay& tray, double t_min, double t_max, HitRecord& out_rec) const {
+	const double o[3] = { r.origin.x, r.origin.y, r.origin.z };
+	const double inv[3] = { 1.0 / r.direction.x, 1.0 / r.direction.y, 1.0 / r.direction.z };
+	TraversalStack<WideEntry> stack;
+	stack.push({ wideNodes.data(), 0, 0, t_min });
+	std::uint32_t closest = kNoTriangle;
+
+	while (!stack.empty()) {
+		WideEntry e = stack.pop();
+		if (e.tNear > t_max * kRobustScale) continue;
+		if (e.count == kDeferredChild) {
+			e.nodes = expand(e.index);
+			e.index = 0;
+		}
+		else if (e.count > 0) {
+			for (std::uint32_t i = e.index; i < e.index + e.count; ++i) {
+				double t;
+				if (tris[i].intersect(tray, t_min, t_max, t)) {
+					closest = i;
+					t_max = t;
+				}
+			}
+			continue;
+		}
+
+		const WideNode& node = e.nodes[e.index];
+		double tNear[4];
+		int mask = intersectChildren(node, o, inv, t_min, t_max, tNear);
+		// 按进入距离由远到近入栈，近的先出栈
+		WideEntry hits[4];
+		int k = 0;
+		for (int c = 0; c < node.childCount; ++c) {
+			if (!(mask & (1 << c))) continue;
+			WideEntry entry = { e.nodes, node.child[c], node.leafCount[c], tNear[c] };
+			int j = k++;
+			while (j > 0 && hits[j - 1].tNear < entry.tNear) { hits[j] = hits[j - 1]; --j; }
+			hits[j] = entry;
+		}
+		for (int j = 0; j < k; ++j) stack.push(hits[j]);
+	}
+	if (closest == kNoTriangle) return false;
+	tris[closest].fillHit(r, t_max, out_rec);
+	return true;
+}
+
+bool BvhMesh::occludedWide(const Ray& r, const TriangleRay& tray, double t_min, double t_max) const {
+	const double o[3] = { r.origin.x, r.origin.y, r.origin.z };
+	const double inv[3] = { 1.0 / r.direction.x, 1.0 / r.direction.y, 1.0 / r.direction.z };
+	double tHit;
+	TraversalStack<WideEntry> stack;
+	stack.push({ wideNodes.data(), 0, 0, t_min });
+
+	while (!stack.empty()) {
+		WideEntry e = stack.pop();
+		if (e.count == kDeferredChild) {
+			e.nodes = expand(e.index);
+			e.index = 0;
+		}
+		else if (e.count > 0) {
+			for (std::uint32_t i = e.index; i < e.index + e.count; ++i) {
+				if (tris[i].intersect(tray, t_min, t_max, tHit)) return true;
+			}
+			continue;
+		}
+		const WideNode& node = e.nodes[e.index];
+		double tNear[4];
+		int mask = intersectChildren(node, o, inv, t_min, t_max, tNear);
+		for (int c = 0; c < node.childCount; ++c) {
+			if (mask & (1 << c)) stack.push({ e.nodes, node.child[c], node.leafCount[c], tNear[c] });
+		}
+	}
+	return false;
+}
+
+bool BvhMesh::hitBinary(const Ray& r, const TriangleRay& tray, double t_min, double t_max, HitRecord& out_rec) const {
+	const double o[3] = { r.origin.x, r.origin.y, r.origin.z };
+	const double inv[3] = { 1.0 / r.direction.x, 1.0 / r.direction.y, 1.0 / r.direction.z };
+	double tRoot;
+	if (!slab(binaryNodes[0].bounds, o, inv, t_min, t_max, tRoot)) return false;
+	TraversalStack<StackEntry> stack;
+	stack.push({ 0, 0, tRoot });
+	std::uint32_t closest = kNoTriangle;
+
+	while (!stack.empty()) {
+		const StackEntry e = stack.pop();
+		if (e.tNear > t_max * kRobustScale) continue;
+		const BinaryNode& node = binaryNodes[e.index];
+		if (node.count > 0) {
+			for (std::uint32_t i = node.index; i < node.index + node.count; ++i) {
+				double t;
+				if (tris[i].intersect(tray, t_min, t_max, t)) {
+					closest = i;
+					t_max = t;
+				}
+			}
+			continue;
+		}
+		double t0, t1;
+		bool h0 = slab(binaryNodes[node.index].bounds, o, inv, t_min, t_max, t0);
+		bool h1 = slab(binaryNodes[node.index + 1].bounds, o, inv, t_min, t_max, t1);
+		if (h0 && h1) {
+			// 远的先入栈
+			if (t0 <= t1) {
+				stack.push({ node.index + 1, 0, t1 });
+				stack.push({ node.index, 0, t0 });
+			}
+			else {
+				stack.push({ node.index, 0, t0 });
+				stack.push({ node.index + 1, 0, t1 });
+			}
+		}
+		else if (h0) stack.push({ node.index, 0, t0 });
+		else if (h1) stack.push({ node.index + 1, 0, t1 });
+	}
+	if (closest == kNoTriangle) return false;
+	tris[closest].fillHit(r, t_max, out_rec);
+	return true;
+}
+
+bool BvhMesh::occludedBinary(const Ray& r, const TriangleRay& tray, double t_min, double t_max) const {
+	const double o[3] = { r.origin.x, r.origin.y, r.origin.z };
+	const double inv[3] = { 1.0 / r.direction.x, 1.0 / r.direction.y, 1.0 / r.direction.z };
+	double tHit;
+	TraversalStack<std::uint32_t> stack;
+	double tNear;
+	if (!slab(binaryNodes[0].bounds, o, inv, t_min, t_max, tNear)) return false;
+	stack.push(0);
+
+	while (!stack.empty()) {
+		const BinaryNode& node = binaryNodes[stack.pop()];
+		if (node.count > 0) {
+			for (std::uint32_t i = node.index; i < node.index + node.count; ++i) {
+				if (tris[i].intersect(tray, t_min, t_max, tHit)) return true;
+			}
+			continue;
+		}
+		if (slab(binaryNodes[node.index].bounds, o, inv, t_min, t_max, tNear)) stack.push(node.index);
+		if (slab(binaryNodes[node.index + 1].bounds, o, inv, t_min, t_max, tNear)) stack.push(node.index + 1);
+	}
+	return false;
+}
@@ -0,0 +1,133 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include "hittable.h"
+#include "triangle.h"
+#include "mesh_loader.h"
+
+/// @brief BVH 构建统计
+struct BvhStats {
+	size_t triangles = 0;     // 三角形数
+	size_t nodes = 0;         // 节点数（按所选格式）
+	size_t leaves = 0;        // 叶子数
+	size_t nodeBytes = 0;     // 节点总字节数
+	int depth = 0;            // 树深度（按所选格式）
+	double buildSeconds = 0.0; // 构建耗时（秒）；延迟构建时只含预先构建部分
+	size_t lazySubtrees = 0;  // 延迟子树数（未启用延迟构建时为 0）
+};
+
+// Triangle mesh behind a bounding volume hierarchy. The tree is built with binned SAH and
+// stored either as plain binary nodes with double-precision boxes, or collapsed into 4-wide
+// nodes whose child boxes are quantized to 8 bits on a power-of-two grid anchored at a float
+// origin (one 64-byte cache line per node). Quantized boxes are rounded outwards and the slab
+// test widens its interval by a few ulps, so traversal never culls a triangle the exhaustive
+// test would hit.
+//
+// With BvhOptions::lazyBuild the constructor stops splitting after the top levels and leaves
+// deferred subtrees. The first ray that reaches one builds it under that subtree's mutex and
+// publishes its node array through an atomic pointer (release/acquire), so render threads can
+// expand different subtrees concurrently and readers never see a partially built subtree.
+/// @brief BVH 三角网格
+class BvhMesh : public Hittable {
+public:
+	/// @brief 构造函数：建立三角形并构建 BVH
+	/// @param mesh 索引网格
+	/// @param options 构建选项
+	BvhMesh(const MeshData& mesh, const BvhOptions& options);
+
+	/// @brief 最近击中：按进入距离由近到远遍历
+	bool hit(const Ray& r, double t_min, double t_max, HitRecord& out_rec) const override;
+	/// @brief 遮挡查询：任一三角形被击中即返回
+	bool occluded(const Ray& r, double t_min, double t_max) const override;
+	/// @brief 最近击中：复用调用方构建的 TriangleRay
+	bool hitPrepared(const Ray& r, const TriangleRay& tray, double t_min, double t_max, HitRecord& out_rec) const override;
+	/// @brief 遮挡查询：复用调用方构建的 TriangleRay
+	bool occludedPrepared(const Ray& r, const TriangleRay& tray, double t_min, double t_max) const override;
+	/// @brief 包围盒即根节点包围盒
+	bool boundingBox(AABB& out) const override {
+		out = bounds;
+		return !tris.empty();
+	}
+
+	/// @brief 三角形（按叶节点顺序重排；延迟子树展开时其范围内的顺序会变化，集合不变）
+	const std::vector<Triangle>& triangles() const { return tris; }
+	/// @brief 已展开的延迟子树数
+	size_t expandedSubtrees() const { return expandedCount.load(std::memory_order_relaxed); }
+	/// @brief 立即构建全部延迟子树
+	void expandAll() const;
+	/// @brief 构建统计
+	const BvhStats& stats() const { return buildStats; }
+	/// @brief 节点格式
+	BvhLayout layout() const { return nodeLayout; }
+
+private:
+	/// @brief 二叉节点（未压缩）：count>0 为叶子（index 为首个三角形），否则子节点为 index 与 index+1
+	struct BinaryNode {
+		AABB bounds;
+		std::uint32_t index = 0;
+		std::uint32_t count = 0;
+	};
+
+	/// @brief 量化4叉节点：子盒 = origin + q * 2^exponent（各轴独立）
+	struct alignas(64) WideNode {
+		float origin[3];            // 量化网格原点（不大于父盒最小角）
+		std::int8_t exponent[3];    // 各轴网格步长的二次幂指数
+		std::uint8_t childCount;    // 有效子节点数（1..4）
+		std::uint8_t lo[3][4];      // 子盒最小角 [轴][子]，向下取整
+		std::uint8_t hi[3][4];      // 子盒最大角 [轴][子]，向上取整
+		std::uint32_t child[4];     // 内部子节点：节点下标；叶子：首个三角形
+		std::uint8_t leafCount[4];  // 叶子三角形数，0 表示内部节点
+		std::uint8_t pad[4];
+	};
+	static_assert(sizeof(WideNode) == 64, "WideNode must fill one cache line");
+
+	/// @brief 延迟子树：三角形范围 [first, first + count)，首次访问时构建 nodes 并发布 root
+	struct LazySubtree {
+		std::uint32_t first = 0;
+		std::uint32_t count = 0;
+		std::vector<WideNode> nodes;
+		std::atomic<const WideNode*> root{ nullptr };
+		std::mutex lock;
+	};
+
+	// mutable：延迟子树在 const 的求交调用中展开
+	mutable std::vector<Triangle> tris;
+	AABB bounds;
+	BvhLayout nodeLayout;
+	std::vector<BinaryNode> binaryNodes;
+	std::vector<WideNode> wideNodes;
+	std::vector<std::unique_ptr<LazySubtree>> lazySubtrees;
+	mutable std::atomic<size_t> expandedCount{ 0 };
+	int sahBins = 12;
+	std::uint32_t leafSize = 4;
+	BvhStats buildStats;
+
+	struct BuildNode;
+	struct BuildContext;
+	struct WideEntry;
+
+	/// @brief 分箱 SAH 递归构建 [begin, end) 范围的子树，返回构建节点下标
+	/// maxDepth 以下不再划分，范围标记为延迟子树
+	static int buildNode(BuildContext& ctx, std::uint32_t begin, std::uint32_t end, int depth, int maxDepth);
+	/// @brief 构建树展开为二叉节点数组，返回子树深度
+	int flattenBinary(const std::vector<BuildNode>& build, int buildIndex, std::uint32_t slot);
+	/// @brief 构建树折叠为量化4叉节点追加到 out，返回节点下标；叶子三角形下标加 triOffset，
+	/// 延迟节点登记到 lazyOut
+	static std::uint32_t flattenWide(const std::vector<BuildNode>& build, int buildIndex, int depth,
+		std::vector<WideNode>& out, std::uint32_t triOffset, int& maxDepth,
+		std::vector<std::unique_ptr<LazySubtree>>* lazyOut);
+	/// @brief 返回延迟子树的根节点，必要时先构建（线程安全）
+	const WideNode* expand(std::uint32_t subtree) const;
+
+	bool hitBinary(const Ray& r, const TriangleRay& tray, double t_min, double t_max, HitRecord& out_rec) const;
+	bool hitWide(const Ray& r, const TriangleRay& tray, double t_min, double t_max, HitRecord& out_rec) const;
+	bool occludedBinary(const Ray& r, const TriangleRay& tray, double t_min, double t_max) const;
+	bool occludedWide(const Ray& r, const TriangleRay& tray, double t_min, double t_max) const;
+
+	/// @brief 解码量化节点的子盒并做 slab 测试，返回击中子节点的位掩码与进入距离
+	static int intersectChildren(const WideNode& node, const double* o, const double* inv,
+		double t_min, double t_max, double* tNear);
+};
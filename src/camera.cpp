@@ -1,6 +1,7 @@
 #include "camera.h"
 #include <cmath>
 #include <iostream>
+#include <limits>
 
 /// @brief 将角度转换为弧度
 /// @param d 角度值
@@ -46,6 +47,7 @@ Camera::Camera() {
 	horizontal = u_axis * viewport_width;
 	vertical = v_axis * viewport_height;
 	lower_left_corner = origin - horizontal / 2.0 - vertical / 2.0 + w_axis;  // Fixed: viewport should be in front of camera
+	updateProjection();
 }
 
 
@@ -65,6 +67,7 @@ Camera::Camera(const Vec3& lookFrom, const Vec3& lookAt, const Vec3& up, double
 	horizontal = u_axis * viewport_width;
 	vertical = v_axis * viewport_height;
 	lower_left_corner = origin - horizontal / 2.0 - vertical / 2.0 + w_axis * focal_length;  // Viewport at focal_length distance
+	updateProjection();
 	
 	// Debug output
 	std::cout << "\n[Camera Debug] ========== Camera Setup ==========\n";
@@ -86,3 +89,40 @@ Ray Camera::get_ray(double u, double v) const {
 }
 
 
+
+double Camera::projectedRadius(const Vec3& center, double radius) const {
+	// 沿视线方向的距离（视口位于 w_axis 方向单位距离处）
+	double depth = Vec3::dot(center - origin, w_axis);
+	if (depth <= -radius) return 0.0;
+	if (depth <= radius) return std::numeric_limits<double>::infinity();
+	double viewportHeight = vertical.length();
+	if (viewportHeight <= 0.0) return std::numeric_limits<double>::infinity();
+	return radius / depth / viewportHeight;
+}
+
+void Camera::updateProjection() {
+	// 列向量 a = 视口左下角方向, b = horizontal, c = vertical；逆矩阵的行 = 伴随矩阵 / 行列式
+	Vec3 a = lower_left_corner - origin;
+	Vec3 b = horizontal;
+	Vec3 c = vertical;
+	Vec3 bc = Vec3::cross(b, c);
+	double det = Vec3::dot(a, bc);
+	if (std::fabs(det) < 1e-300) {
+		inv_row0 = inv_row1 = inv_row2 = Vec3(0, 0, 0);
+		return;
+	}
+	double invDet = 1.0 / det;
+	inv_row0 = bc * invDet;
+	inv_row1 = Vec3::cross(c, a) * invDet;
+	inv_row2 = Vec3::cross(a, b) * invDet;
+}
+
+bool Camera::project(const Vec3& p, double& u, double& v, double& s) const {
+	// p - origin = s * a + (s*u) * b + (s*v) * c
+	Vec3 d = p - origin;
+	s = Vec3::dot(inv_row0, d);
+	if (s <= 0.0) return false;
+	u = Vec3::dot(inv_row1, d) / s;
+	v = Vec3::dot(inv_row2, d) / s;
+	return true;
+}
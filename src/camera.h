@@ -21,6 +21,20 @@ public:
 	/// @param v 视口垂直坐标 Y，范围[0,1]
 	Ray get_ray(double u, double v) const; // u,v in [0,1]
 
+	/// @brief 估算包围球投影到屏幕后的半径（以视口高度为单位）
+	/// @param center 球心
+	/// @param radius 半径
+	/// @return 投影半径占视口高度的比例；球与相机平面相交时返回无穷大，完全在相机后方时返回0
+	double projectedRadius(const Vec3& center, double radius) const;
+
+	/// @brief 将世界坐标点投影到视口（get_ray 的逆映射）
+	/// @param p 世界坐标点
+	/// @param u 输出视口水平坐标（与 get_ray 的 u 一致）
+	/// @param v 输出视口垂直坐标（与 get_ray 的 v 一致）
+	/// @param s 输出投影深度：p = origin + s * (视口点 - origin)，沿视线线性；s <= 0 表示在相机后方
+	/// @return s > 0 时返回 true
+	bool project(const Vec3& p, double& u, double& v, double& s) const;
+
 private:
 	/// @brief 相机位置
 	Vec3 origin;
@@ -37,6 +51,12 @@ private:
 	Vec3 v_axis;
 	/// @brief 相机指向目标方向向量
 	Vec3 w_axis;
+
+	/// @brief 投影矩阵：[lower_left_corner - origin, horizontal, vertical] 的逆矩阵（按行存储）
+	Vec3 inv_row0, inv_row1, inv_row2;
+
+	/// @brief 根据视口参数计算投影矩阵
+	void updateProjection();
 };
 
 
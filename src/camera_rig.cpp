@@ -0,0 +1,53 @@
+#include "camera_rig.h"
+#include <cmath>
+
+Camera CameraRig::lookAt(const Vec3& from, const Vec3& at, const Vec3& upHint, double vfovDegrees, double aspect) {
+	Vec3 look = (at - from).normalized();
+	Vec3 right = Vec3::cross(look, upHint).normalized();
+	Vec3 up = Vec3::cross(right, look).normalized();
+	return Camera(from, at, up, vfovDegrees, aspect);
+}
+
+std::vector<CameraView> CameraRig::turnaround(const Vec3& from, const Vec3& at, double vfovDegrees, double aspect, int count) {
+	const double kPi = 3.14159265358979323846;
+	std::vector<CameraView> views;
+	Vec3 offset = from - at;
+	for (int i = 0; i < count; ++i) {
+		// 绕过 at 的 Y 轴旋转
+		double angle = 2.0 * kPi * double(i) / double(count);
+		double c = std::cos(angle), s = std::sin(angle);
+		Vec3 rotated(offset.x * c + offset.z * s, offset.y, -offset.x * s + offset.z * c);
+		int degrees = int(std::lround(360.0 * double(i) / double(count)));
+		views.push_back({ lookAt(at + rotated, at, Vec3(0, 1, 0), vfovDegrees, aspect), "view" + std::to_string(degrees) });
+	}
+	return views;
+}
+
+std::vector<CameraView> CameraRig::stereoPair(const Vec3& from, const Vec3& at, double vfovDegrees, double aspect, double separation) {
+	Vec3 look = (at - from).normalized();
+	Vec3 right = Vec3::cross(look, Vec3(0, 1, 0)).normalized();
+	Vec3 half = right * (0.5 * separation);
+	return {
+		{ lookAt(from - half, at - half, Vec3(0, 1, 0), vfovDegrees, aspect), "left" },
+		{ lookAt(from + half, at + half, Vec3(0, 1, 0), vfovDegrees, aspect), "right" }
+	};
+}
+
+std::vector<CameraView> CameraRig::cubemap(const Vec3& position) {
+	// 上下两面的参考上方向改用 Z 轴，避免与视线平行
+	return {
+		{ lookAt(position, position + Vec3(1, 0, 0), Vec3(0, 1, 0), 90.0, 1.0), "px" },
+		{ lookAt(position, position + Vec3(-1, 0, 0), Vec3(0, 1, 0), 90.0, 1.0), "nx" },
+		{ lookAt(position, position + Vec3(0, 1, 0), Vec3(0, 0, -1), 90.0, 1.0), "py" },
+		{ lookAt(position, position + Vec3(0, -1, 0), Vec3(0, 0, 1), 90.0, 1.0), "ny" },
+		{ lookAt(position, position + Vec3(0, 0, 1), Vec3(0, 1, 0), 90.0, 1.0), "pz" },
+		{ lookAt(position, position + Vec3(0, 0, -1), Vec3(0, 1, 0), 90.0, 1.0), "nz" }
+	};
+}
+
+std::string CameraRig::viewPath(const std::string& path, const std::string& name) {
+	size_t slash = path.find_last_of("/\\");
+	size_t dot = path.find_last_of('.');
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return path + "_" + name;
+	return path.substr(0, dot) + "_" + name + path.substr(dot);
+}
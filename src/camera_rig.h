@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "camera.h"
+
+/// @brief 多视图中的一个视图
+struct CameraView {
+	Camera camera;
+	std::string name;   // 视图名（用于输出文件名后缀）
+};
+
+// Camera sets for Renderer::renderViews. All cameras are built like main.cpp builds its
+// camera: right = look x upHint, up = right x look.
+namespace CameraRig {
+	/// @brief 由位置、目标和参考上方向构造相机
+	Camera lookAt(const Vec3& from, const Vec3& at, const Vec3& upHint, double vfovDegrees, double aspect);
+
+	/// @brief 转身图：绕 at 的竖直轴等角度环绕 count 个视图，第一个视图位于 from
+	std::vector<CameraView> turnaround(const Vec3& from, const Vec3& at, double vfovDegrees, double aspect, int count);
+
+	/// @brief 立体像对：左右眼沿相机右方向各偏移 separation/2，视轴平行（零视差在无穷远）
+	std::vector<CameraView> stereoPair(const Vec3& from, const Vec3& at, double vfovDegrees, double aspect, double separation);
+
+	/// @brief 立方体贴图：从 position 出发的 6 个 90° 视图（+X, -X, +Y, -Y, +Z, -Z），需方形图像
+	std::vector<CameraView> cubemap(const Vec3& position);
+
+	/// @brief 在扩展名前插入视图名：out.png + "left" -> out_left.png
+	std::string viewPath(const std::string& path, const std::string& name);
+}
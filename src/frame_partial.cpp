@@ -0,0 +1,102 @@
+#include "frame_partial.h"
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <cstdint>
+
+namespace {
+	/// @brief 文件头标识（含版本号）
+	const char kMagic[8] = { 'T', 'O', 'O', 'N', 'P', 'R', 'T', '1' };
+
+	template <typename T>
+	static void put(std::ofstream& out, const T& v) {
+		out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+	}
+
+	template <typename T>
+	static bool get(std::ifstream& in, T& v) {
+		return bool(in.read(reinterpret_cast<char*>(&v), sizeof(T)));
+	}
+}
+
+bool FramePartial::write(const std::string& path, const GBuffer& part, int frameWidth, int frameHeight) {
+	PixelRect r = part.area();
+	if (r.empty()) r = PixelRect();
+	if (r.x0 < 0 || r.y0 < 0 || r.x1 > frameWidth || r.y1 > frameHeight) {
+		std::cerr << "Partial [" << r.x0 << "," << r.y0 << " - " << r.x1 << "," << r.y1 << ") lies outside the "
+			<< frameWidth << "x" << frameHeight << " frame\n";
+		return false;
+	}
+	std::ofstream out(path, std::ios::binary);
+	if (!out.is_open()) {
+		std::cerr << "Failed to open partial output: " << path << "\n";
+		return false;
+	}
+	out.write(kMagic, sizeof(kMagic));
+	std::int32_t header[6] = { frameWidth, frameHeight, r.x0, r.y0, r.x1, r.y1 };
+	for (std::int32_t v : header) put(out, v);
+
+	// 逐像素原样写出（双精度不经文本转换，合并后与单进程结果逐位一致）
+	for (int y = r.y0; y < r.y1; ++y) {
+		for (int x = r.x0; x < r.x1; ++x) {
+			int i = part.index(x, y);
+			put(out, part.color[i].x); put(out, part.color[i].y); put(out, part.color[i].z);
+			put(out, part.depth[i]);
+			put(out, part.normal[i].x); put(out, part.normal[i].y); put(out, part.normal[i].z);
+			put(out, part.objectId[i]);
+			put(out, part.materialId[i]);
+			put(out, part.outline[i]);
+		}
+	}
+	return bool(out);
+}
+
+bool FramePartial::read(const std::string& path, GBuffer& frame, PixelRect& outRegion) {
+	std::ifstream in(path, std::ios::binary);
+	if (!in.is_open()) {
+		std::cerr << "Failed to open partial: " << path << "\n";
+		return false;
+	}
+	char magic[sizeof(kMagic)];
+	if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+		std::cerr << "Not a partial frame file: " << path << "\n";
+		return false;
+	}
+	std::int32_t header[6];
+	for (std::int32_t& v : header) {
+		if (!get(in, v)) {
+			std::cerr << "Truncated partial header: " << path << "\n";
+			return false;
+		}
+	}
+	int w = header[0], h = header[1];
+	PixelRect r(header[2], header[3], header[4], header[5]);
+	if (w <= 0 || h <= 0 || r.x0 < 0 || r.y0 < 0 || r.x1 > w || r.y1 > h || r.x1 < r.x0 || r.y1 < r.y0) {
+		std::cerr << "Invalid partial dimensions in " << path << "\n";
+		return false;
+	}
+	if (frame.width == 0 && frame.height == 0) frame.resize(w, h);
+	if (frame.width != w || frame.height != h) {
+		std::cerr << "Partial " << path << " is " << w << "x" << h << ", expected "
+			<< frame.width << "x" << frame.height << "\n";
+		return false;
+	}
+
+	for (int y = r.y0; y < r.y1; ++y) {
+		for (int x = r.x0; x < r.x1; ++x) {
+			int i = frame.index(x, y);
+			bool ok = get(in, frame.color[i].x) && get(in, frame.color[i].y) && get(in, frame.color[i].z)
+				&& get(in, frame.depth[i])
+				&& get(in, frame.normal[i].x) && get(in, frame.normal[i].y) && get(in, frame.normal[i].z)
+				&& get(in, frame.objectId[i])
+				&& get(in, frame.materialId[i])
+				&& get(in, frame.outline[i]);
+			if (!ok) {
+				std::cerr << "Truncated partial: " << path << "\n";
+				return false;
+			}
+		}
+	}
+	outRegion = r;
+	return true;
+}
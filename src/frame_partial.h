@@ -0,0 +1,24 @@
+#pragma once
+#include <string>
+#include "gbuffer.h"
+
+// Partial frames for distributed rendering: a worker renders one rectangle of the frame and saves
+// the raw (not yet post-processed) G-buffer channels of that rectangle. The merge step reads all
+// partials back into one full-size GBuffer and runs the post-process passes on the whole frame,
+// so outlines and SSAO across partial boundaries match a single-process render exactly.
+namespace FramePartial {
+	/// @brief 将分块缓冲的原始通道写入分块文件（二进制）
+	/// @param path 输出路径
+	/// @param part 分块缓冲（只覆盖本分块，area() 即分块在整帧中的矩形）
+	/// @param frameWidth 整帧宽度
+	/// @param frameHeight 整帧高度
+	/// @return 是否写入成功
+	bool write(const std::string& path, const GBuffer& part, int frameWidth, int frameHeight);
+
+	/// @brief 读取分块文件并写入整帧缓冲
+	/// @param path 分块文件路径
+	/// @param frame 整帧缓冲；为空时按文件中的整帧尺寸分配，否则尺寸必须一致
+	/// @param outRegion 分块覆盖的像素矩形
+	/// @return 是否读取成功（文件损坏或尺寸不一致时返回 false）
+	bool read(const std::string& path, GBuffer& frame, PixelRect& outRegion);
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include "vec3.h"
+
+/// @brief 像素矩形 [x0, x1) x [y0, y1)
+struct PixelRect {
+	int x0 = 0;
+	int y0 = 0;
+	int x1 = 0;
+	int y1 = 0;
+
+	PixelRect() = default;
+	PixelRect(int ax0, int ay0, int ax1, int ay1) : x0(ax0), y0(ay0), x1(ax1), y1(ay1) {}
+
+	int width() const { return x1 - x0; }
+	int height() const { return y1 - y0; }
+	bool empty() const { return x1 <= x0 || y1 <= y0; }
+	bool contains(int x, int y) const { return x >= x0 && x < x1 && y >= y0 && y < y1; }
+
+	/// @brief 与另一矩形的交集
+	PixelRect intersect(const PixelRect& o) const {
+		return PixelRect(std::max(x0, o.x0), std::max(y0, o.y0), std::min(x1, o.x1), std::min(y1, o.y1));
+	}
+};
+
+/// @brief 帧缓冲：渲染器输出、后处理输入
+struct GBuffer {
+	/// @brief 背景像素的ID
+	static constexpr std::uint32_t kNoId = 0xFFFFFFFFu;
+
+	int width = 0;
+	int height = 0;
+	/// @brief 缓冲左上角在整帧中的坐标（只覆盖部分帧时非 0，index 仍使用整帧坐标）
+	int originX = 0;
+	int originY = 0;
+	/// @brief 颜色
+	std::vector<Vec3> color;
+	/// @brief 深度（主光线 t 值，背景为 INF）
+	std::vector<double> depth;
+	/// @brief 击中点法线（面向相机，背景为 0）
+	std::vector<Vec3> normal;
+	/// @brief 击中对象在场景列表中的下标（背景为 kNoId）
+	std::vector<std::uint32_t> objectId;
+	/// @brief 击中点材质ID（背景为 kNoId）
+	std::vector<std::uint32_t> materialId;
+	/// @brief 描边掩码：1 表示该像素是描边（着色器轮廓或后处理边缘），供描边加粗使用
+	std::vector<std::uint8_t> outline;
+
+	GBuffer() = default;
+	GBuffer(int w, int h) { resize(w, h); }
+	/// @brief 只覆盖整帧中 area 范围的缓冲
+	explicit GBuffer(const PixelRect& area) { resize(area); }
+
+	/// @brief 重新分配并清空为背景
+	void resize(int w, int h) { resize(PixelRect(0, 0, w, h)); }
+
+	/// @brief 按整帧中的矩形重新分配并清空为背景
+	void resize(const PixelRect& area) {
+		originX = area.x0;
+		originY = area.y0;
+		width = std::max(0, area.width());
+		height = std::max(0, area.height());
+		size_t n = size_t(width) * size_t(height);
+		color.assign(n, Vec3(0, 0, 0));
+		depth.assign(n, std::numeric_limits<double>::infinity());
+		normal.assign(n, Vec3(0, 0, 0));
+		objectId.assign(n, kNoId);
+		materialId.assign(n, kNoId);
+		outline.assign(n, 0);
+	}
+
+	/// @brief 缓冲覆盖的整帧像素矩形
+	PixelRect area() const { return PixelRect(originX, originY, originX + width, originY + height); }
+
+	/// @brief 整帧坐标 (x, y) 在缓冲中的下标
+	int index(int x, int y) const { return (y - originY) * width + (x - originX); }
+};
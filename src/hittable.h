@@ -1,18 +1,26 @@
 #pragma once
 #include <memory>
 #include "ray.h"
-
-struct Material;
+#include "ray_stream.h"
+#include "aabb.h"
+#include "material.h"
 
 /// @brief 击中记录结构体
 struct HitRecord {
+	/// @brief albedoRGB 的特殊值：不覆盖材质反照率
+	static constexpr std::uint32_t kNoAlbedo = 0xFFFFFFFFu;
+
 	/// @brief 击中时间
 	double t = 0.0;
 	/// @brief 击中点
 	Vec3 point;
 	/// @brief 击中点的法线
 	Vec3 normal;
-	/// @brief 击中点的材质
+	/// @brief 击中点的材质ID（由图元填写）
+	MaterialId materialId = 0;
+	/// @brief 逐图元反照率（打包的 0xRRGGBB，kNoAlbedo 表示使用材质反照率；由图元填写）
+	std::uint32_t albedoRGB = kNoAlbedo;
+	/// @brief 击中点的材质（由渲染器根据 materialId 查材质表填写）
 	const Material* material = nullptr;
 	/// @brief 击中点是否为正面
 	bool front_face = true;
@@ -39,6 +47,58 @@ public:
 	/// @param out_rec 击中记录
 	/// @return 是否击中对象
 	virtual bool hit(const Ray& r, double t_min, double t_max, HitRecord& out_rec) const = 0;
+
+	/// @brief 任意击中（遮挡）查询：找到第一个交点即返回，不填写击中记录、不求最近交点
+	/// @param r 射线
+	/// @param t_min 最小击中时间
+	/// @param t_max 最大击中时间
+	/// @return (t_min, t_max) 内是否存在任意交点
+	virtual bool occluded(const Ray& r, double t_min, double t_max) const {
+		HitRecord rec;
+		return hit(r, t_min, t_max, rec);
+	}
+
+	/// @brief 最近击中（调用方已为光线构建 TriangleRay）：同一光线依次测试多个对象时只构建一次；
+	/// 默认忽略 tray，三角形图元直接复用
+	/// @param tray 与 r 对应的三角形求交预计算
+	virtual bool hitPrepared(const Ray& r, const TriangleRay& tray, double t_min, double t_max, HitRecord& out_rec) const {
+		(void)tray;
+		return hit(r, t_min, t_max, out_rec);
+	}
+
+	/// @brief 遮挡查询（调用方已为光线构建 TriangleRay），见 hitPrepared
+	virtual bool occludedPrepared(const Ray& r, const TriangleRay& tray, double t_min, double t_max) const {
+		(void)tray;
+		return occluded(r, t_min, t_max);
+	}
+
+	/// @brief 世界空间包围盒
+	/// @param out 输出包围盒
+	/// @return 对象有界时返回 true；默认无界
+	virtual bool boundingBox(AABB& out) const {
+		(void)out;
+		return false;
+	}
+
+	/// @brief 批量最近击中（波前模式）：对光线流 [begin, end) 逐条求交，
+	/// 交点比 tMax[i] 更近时更新 tMax[i]，并将 hitIndex[i] 设为 id；不填写击中记录
+	/// @param rays 光线流
+	/// @param t_min 最小击中时间
+	/// @param tMax 每条光线当前最近交点（输入输出）
+	/// @param hitIndex 每条光线当前最近对象（输出）
+	/// @param id 本对象的编号
+	virtual void hitStream(const RayStream& rays, size_t begin, size_t end, double t_min,
+		double* tMax, std::uint32_t* hitIndex, std::uint32_t id) const {
+		HitRecord rec;
+		const bool shared = rays.hasTriangleRays();
+		for (size_t i = begin; i < end; ++i) {
+			const Ray r = rays.ray(i);
+			if (shared ? hitPrepared(r, rays.triangleRays[i], t_min, tMax[i], rec) : hit(r, t_min, tMax[i], rec)) {
+				tMax[i] = rec.t;
+				hitIndex[i] = id;
+			}
+		}
+	}
 };
 
 
@@ -0,0 +1,527 @@
+#include "image_writer.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TOON_IMAGE_SSE2 1
+#endif
+
+namespace {
+	static_assert(sizeof(Vec3) == 3 * sizeof(double), "Vec3 must be three packed doubles");
+
+	/// @brief 按行带切分：每带至少 minRows 行，带数不超过线程数的2倍
+	static std::vector<int> bandStarts(int height, int minRows) {
+		int bands = std::max(1, std::min(Parallel::threadCount() * 2, height / std::max(1, minRows)));
+		std::vector<int> starts;
+		for (int b = 0; b <= bands; ++b) starts.push_back(int((long long)height * b / bands));
+		return starts;
+	}
+
+	static void putBE32(std::vector<std::uint8_t>& out, std::uint32_t v) {
+		out.push_back(std::uint8_t(v >> 24));
+		out.push_back(std::uint8_t(v >> 16));
+		out.push_back(std::uint8_t(v >> 8));
+		out.push_back(std::uint8_t(v));
+	}
+
+	static bool writeFile(const std::string& path, const std::vector<std::vector<std::uint8_t>>& pieces) {
+		std::ofstream out(path, std::ios::binary);
+		if (!out.is_open()) {
+			std::cerr << "Failed to open output image: " << path << "\n";
+			return false;
+		}
+		for (const auto& p : pieces) out.write(reinterpret_cast<const char*>(p.data()), std::streamsize(p.size()));
+		return bool(out);
+	}
+
+	// ---------------------------------------------------------------- QOI
+
+	struct QoiPixel {
+		std::uint8_t r, g, b, a;
+		bool operator==(const QoiPixel& o) const { return r == o.r && g == o.g && b == o.b && a == o.a; }
+	};
+
+	static inline int qoiHash(const QoiPixel& p) { return (p.r * 3 + p.g * 5 + p.b * 7 + p.a * 11) % 64; }
+
+	static inline QoiPixel qoiPixelAt(const std::uint8_t* rgb, size_t i) {
+		return QoiPixel{ rgb[3 * i], rgb[3 * i + 1], rgb[3 * i + 2], 255 };
+	}
+
+	/// @brief 解码器在各行带起点处的索引表（每个哈希槽最近一次出现的像素），一遍顺序扫描得到
+	/// @param starts 各行带起点（像素下标，递增）
+	/// @return 每个起点 64 项
+	static std::vector<QoiPixel> qoiIndexSnapshots(const std::uint8_t* rgb, const std::vector<size_t>& starts) {
+		std::vector<QoiPixel> snapshots(starts.size() * 64, QoiPixel{ 0, 0, 0, 0 });
+		QoiPixel index[64];
+		std::memset(index, 0, sizeof(index));
+		size_t i = 0;
+		for (size_t b = 0; b < starts.size(); ++b) {
+			for (; i < starts[b]; ++i) {
+				QoiPixel p = qoiPixelAt(rgb, i);
+				index[qoiHash(p)] = p;
+			}
+			std::copy(index, index + 64, snapshots.begin() + b * 64);
+		}
+		return snapshots;
+	}
+
+	/// @brief 编码像素 [begin, end)；编码器状态（索引表与前一像素）与顺序解码器在 begin 处的状态一致
+	/// @param startIndex begin 处的索引表（64 项，见 qoiIndexSnapshots）
+	static void encodeQoiBand(const std::uint8_t* rgb, size_t begin, size_t end, const QoiPixel* startIndex,
+		std::vector<std::uint8_t>& out) {
+		auto pixelAt = [rgb](size_t i) { return qoiPixelAt(rgb, i); };
+
+		QoiPixel index[64];
+		std::copy(startIndex, startIndex + 64, index);
+		QoiPixel prev = begin > 0 ? pixelAt(begin - 1) : QoiPixel{ 0, 0, 0, 255 };
+
+		out.reserve(out.size() + (end - begin));
+		int run = 0;
+		for (size_t i = begin; i < end; ++i) {
+			QoiPixel px = pixelAt(i);
+			if (px == prev) {
+				if (++run == 62) { out.push_back(std::uint8_t(0xC0 | (run - 1))); run = 0; }
+				continue;
+			}
+			if (run > 0) { out.push_back(std::uint8_t(0xC0 | (run - 1))); run = 0; }
+
+			int h = qoiHash(px);
+			if (index[h] == px) {
+				out.push_back(std::uint8_t(h));
+			}
+			else {
+				index[h] = px;
+				int dr = int(std::int8_t(px.r - prev.r));
+				int dg = int(std::int8_t(px.g - prev.g));
+				int db = int(std::int8_t(px.b - prev.b));
+				int drdg = dr - dg, dbdg = db - dg;
+				if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+					out.push_back(std::uint8_t(0x40 | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2)));
+				}
+				else if (dg >= -32 && dg <= 31 && drdg >= -8 && drdg <= 7 && dbdg >= -8 && dbdg <= 7) {
+					out.push_back(std::uint8_t(0x80 | (dg + 32)));
+					out.push_back(std::uint8_t(((drdg + 8) << 4) | (dbdg + 8)));
+				}
+				else {
+					out.push_back(0xFE);
+					out.push_back(px.r);
+					out.push_back(px.g);
+					out.push_back(px.b);
+				}
+			}
+			prev = px;
+		}
+		if (run > 0) out.push_back(std::uint8_t(0xC0 | (run - 1)));
+	}
+
+	// ---------------------------------------------------------------- PNG / deflate
+
+	static std::uint32_t crcTable[256];
+	static bool crcReady = false;
+
+	static void initCrc() {
+		if (crcReady) return;
+		for (std::uint32_t n = 0; n < 256; ++n) {
+			std::uint32_t c = n;
+			for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			crcTable[n] = c;
+		}
+		crcReady = true;
+	}
+
+	static std::uint32_t crc32(std::uint32_t crc, const std::uint8_t* data, size_t n) {
+		crc = ~crc;
+		for (size_t i = 0; i < n; ++i) crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	static std::uint32_t adler32(const std::uint8_t* data, size_t n) {
+		const std::uint32_t kBase = 65521;
+		std::uint32_t a = 1, b = 0;
+		while (n > 0) {
+			size_t chunk = std::min<size_t>(n, 5552);  // 5552 字节内不会溢出
+			n -= chunk;
+			while (chunk--) { a += *data++; b += a; }
+			a %= kBase;
+			b %= kBase;
+		}
+		return (b << 16) | a;
+	}
+
+	/// @brief 合并两段的 Adler-32（同 zlib adler32_combine）
+	static std::uint32_t adler32Combine(std::uint32_t a1, std::uint32_t a2, size_t len2) {
+		const std::uint32_t kBase = 65521;
+		std::uint32_t rem = std::uint32_t(len2 % kBase);
+		std::uint32_t sum1 = a1 & 0xFFFF;
+		std::uint32_t sum2 = (rem * sum1) % kBase;
+		sum1 += (a2 & 0xFFFF) + kBase - 1;
+		sum2 += ((a1 >> 16) & 0xFFFF) + ((a2 >> 16) & 0xFFFF) + kBase - rem;
+		if (sum1 >= kBase) sum1 -= kBase;
+		if (sum1 >= kBase) sum1 -= kBase;
+		if (sum2 >= (kBase << 1)) sum2 -= (kBase << 1);
+		if (sum2 >= kBase) sum2 -= kBase;
+		return sum1 | (sum2 << 16);
+	}
+
+	/// @brief 低位优先的位写入器（deflate 比特序）
+	struct BitWriter {
+		std::vector<std::uint8_t>& out;
+		std::uint64_t bits = 0;
+		int count = 0;
+
+		explicit BitWriter(std::vector<std::uint8_t>& o) : out(o) {}
+
+		void put(std::uint32_t value, int n) {
+			bits |= std::uint64_t(value) << count;
+			count += n;
+			while (count >= 8) { out.push_back(std::uint8_t(bits)); bits >>= 8; count -= 8; }
+		}
+		/// @brief Huffman 码按高位优先写入
+		void putCode(std::uint32_t code, int n) {
+			std::uint32_t rev = 0;
+			for (int i = 0; i < n; ++i) rev |= ((code >> i) & 1u) << (n - 1 - i);
+			put(rev, n);
+		}
+		void alignToByte() { if (count > 0) put(0, 8 - count); }
+	};
+
+	const int kLengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const int kLengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const int kDistBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const int kDistExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	/// @brief 固定 Huffman 表的字面量/长度符号
+	static void putLitLen(BitWriter& bw, int sym) {
+		if (sym < 144) bw.putCode(0x30 + sym, 8);
+		else if (sym < 256) bw.putCode(0x190 + (sym - 144), 9);
+		else if (sym < 280) bw.putCode(sym - 256, 7);
+		else bw.putCode(0xC0 + (sym - 280), 8);
+	}
+
+	static void putMatch(BitWriter& bw, int length, int distance) {
+		int li = 28;
+		while (kLengthBase[li] > length) --li;
+		putLitLen(bw, 257 + li);
+		if (kLengthExtra[li]) bw.put(std::uint32_t(length - kLengthBase[li]), kLengthExtra[li]);
+		int di = 29;
+		while (kDistBase[di] > distance) --di;
+		bw.putCode(std::uint32_t(di), 5);
+		if (kDistExtra[di]) bw.put(std::uint32_t(distance - kDistBase[di]), kDistExtra[di]);
+	}
+
+	// Compresses one independent segment. Level 0 emits stored blocks; otherwise LZ77 with hash
+	// chains (search depth grows with the level, lazy matching from level 4) coded with the fixed
+	// Huffman tables. A non-final segment ends with an empty stored block so it is byte aligned
+	// and segments can be concatenated into one zlib stream.
+	/// @brief 压缩一段数据为 deflate 块
+	static void deflateSegment(const std::uint8_t* data, size_t n, int level, bool final, std::vector<std::uint8_t>& out) {
+		BitWriter bw(out);
+		if (level <= 0) {
+			size_t pos = 0;
+			do {
+				size_t len = std::min<size_t>(65535, n - pos);
+				bool last = final && pos + len == n;
+				bw.put(last ? 1 : 0, 1);
+				bw.put(0, 2);
+				bw.alignToByte();
+				bw.put(std::uint32_t(len), 16);
+				bw.put(std::uint32_t(~len & 0xFFFF), 16);
+				out.insert(out.end(), data + pos, data + pos + len);
+				pos += len;
+			} while (pos < n);
+			if (!final) {
+				bw.put(0, 3);
+				bw.alignToByte();
+				bw.put(0, 16);
+				bw.put(0xFFFF, 16);
+			}
+			return;
+		}
+
+		const int kWindow = 32768;
+		const int kHashBits = 15;
+		const int kMaxMatch = 258;
+		const int maxChain = level >= 9 ? 256 : (level >= 6 ? 32 : (level >= 4 ? 16 : 4));
+		const bool lazy = level >= 4;
+		std::vector<std::int32_t> head(size_t(1) << kHashBits, -1);
+		std::vector<std::int32_t> prevLink(n, -1);
+		auto hash3 = [data](size_t i) {
+			std::uint32_t v = std::uint32_t(data[i]) | (std::uint32_t(data[i + 1]) << 8) | (std::uint32_t(data[i + 2]) << 16);
+			return (v * 2654435761u) >> (32 - kHashBits);
+		};
+		auto insert = [&](size_t i) {
+			if (i + 2 >= n) return;
+			std::uint32_t h = hash3(i);
+			prevLink[i] = head[h];
+			head[h] = std::int32_t(i);
+		};
+		auto longestMatch = [&](size_t i, int& bestDist) {
+			int best = 0;
+			if (i + 2 >= n) return best;
+			const int limit = int(std::min<size_t>(kMaxMatch, n - i));
+			std::int32_t cand = head[hash3(i)];
+			for (int chain = 0; cand >= 0 && chain < maxChain; ++chain, cand = prevLink[cand]) {
+				int dist = int(i - size_t(cand));
+				if (dist > kWindow) break;
+				if (data[cand + best] != data[i + best]) continue;
+				int len = 0;
+				while (len < limit && data[cand + len] == data[i + len]) ++len;
+				if (len > best) {
+					best = len;
+					bestDist = dist;
+					if (len == limit) break;
+				}
+			}
+			return best;
+		};
+
+		bw.put(final ? 1 : 0, 1);
+		bw.put(1, 2);  // 固定 Huffman
+		size_t i = 0;
+		while (i < n) {
+			int dist = 0;
+			int len = longestMatch(i, dist);
+			if (len >= 3 && lazy && i + 1 < n) {
+				// 惰性匹配：下一位置的匹配更长时先输出当前字面量
+				insert(i);
+				int nextDist = 0;
+				int nextLen = longestMatch(i + 1, nextDist);
+				if (nextLen > len) {
+					putLitLen(bw, data[i]);
+					++i;
+					continue;
+				}
+				putMatch(bw, len, dist);
+				for (size_t k = i + 1; k < i + size_t(len); ++k) insert(k);
+				i += size_t(len);
+				continue;
+			}
+			if (len >= 3) {
+				putMatch(bw, len, dist);
+				for (size_t k = i; k < i + size_t(len); ++k) insert(k);
+				i += size_t(len);
+			}
+			else {
+				putLitLen(bw, data[i]);
+				insert(i);
+				++i;
+			}
+		}
+		putLitLen(bw, 256);
+		if (final) {
+			bw.alignToByte();
+		}
+		else {
+			bw.put(0, 3);
+			bw.alignToByte();
+			bw.put(0, 16);
+			bw.put(0xFFFF, 16);
+		}
+	}
+
+	static inline std::uint8_t paeth(int a, int b, int c) {
+		int p = a + b - c, pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+		return std::uint8_t((pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c));
+	}
+
+	/// @brief 用滤波方式 F 处理一行，返回残差绝对值和
+	template <int F>
+	static long long filterRow(const std::uint8_t* row, const std::uint8_t* up, size_t stride, std::uint8_t* dst) {
+		long long score = 0;
+		for (size_t i = 0; i < stride; ++i) {
+			int a = i >= 3 ? row[i - 3] : 0;
+			int b = up[i];
+			int c = i >= 3 ? up[i - 3] : 0;
+			int pred = F == 1 ? a : F == 2 ? b : F == 3 ? (a + b) / 2 : F == 4 ? paeth(a, b, c) : 0;
+			std::uint8_t v = std::uint8_t(row[i] - pred);
+			dst[i] = v;
+			score += v < 128 ? v : 256 - v;
+		}
+		return score;
+	}
+
+	/// @brief PNG 行滤波：逐行选择残差绝对值和最小的滤波方式
+	static void filterRows(const std::uint8_t* rgb, int width, int y0, int y1, std::uint8_t* out) {
+		const size_t stride = size_t(width) * 3;
+		std::vector<std::uint8_t> candidate[5];
+		for (auto& c : candidate) c.resize(stride);
+		const std::vector<std::uint8_t> zeroRow(stride, 0);
+		for (int y = y0; y < y1; ++y) {
+			const std::uint8_t* row = rgb + size_t(y) * stride;
+			const std::uint8_t* up = y > 0 ? rgb + size_t(y - 1) * stride : zeroRow.data();
+			long long score[5] = {
+				filterRow<0>(row, up, stride, candidate[0].data()),
+				filterRow<1>(row, up, stride, candidate[1].data()),
+				filterRow<2>(row, up, stride, candidate[2].data()),
+				filterRow<3>(row, up, stride, candidate[3].data()),
+				filterRow<4>(row, up, stride, candidate[4].data())
+			};
+			int best = int(std::min_element(score, score + 5) - score);
+			std::uint8_t* line = out + size_t(y - y0) * (stride + 1);
+			line[0] = std::uint8_t(best);
+			std::memcpy(line + 1, candidate[best].data(), stride);
+		}
+	}
+
+	/// @brief 组装 PNG 数据块（长度、类型、数据、CRC）
+	static void appendChunk(std::vector<std::uint8_t>& out, const char* type, const std::uint8_t* data, size_t n) {
+		putBE32(out, std::uint32_t(n));
+		size_t typePos = out.size();
+		out.insert(out.end(), type, type + 4);
+		if (n > 0) out.insert(out.end(), data, data + n);
+		putBE32(out, crc32(0, out.data() + typePos, n + 4));
+	}
+}
+
+ImageFormat ImageWriter::formatFromPath(const std::string& path) {
+	auto endsWith = [&path](const char* ext) {
+		size_t n = std::strlen(ext);
+		if (path.size() < n) return false;
+		for (size_t i = 0; i < n; ++i) {
+			if (std::tolower((unsigned char)path[path.size() - n + i]) != ext[i]) return false;
+		}
+		return true;
+	};
+	if (endsWith(".qoi")) return ImageFormat::QOI;
+	if (endsWith(".png")) return ImageFormat::PNG;
+	return ImageFormat::PPM;
+}
+
+void ImageWriter::toRGB8(const Vec3* colors, size_t count, std::uint8_t* dst) {
+	const double* src = &colors[0].x;
+	const size_t n = count * 3;
+	size_t i = 0;
+#ifdef TOON_IMAGE_SSE2
+	const __m128d zero = _mm_setzero_pd();
+	const __m128d one = _mm_set1_pd(1.0);
+	const __m128d scale = _mm_set1_pd(255.999);
+	auto convert = [&](const double* p) {
+		// minpd/maxpd 在有 NaN 时返回第二个操作数：NaN 先被钳到 1，与标量 std::min/std::max 一致
+		__m128d v = _mm_mul_pd(_mm_max_pd(_mm_min_pd(_mm_loadu_pd(p), one), zero), scale);
+		return _mm_cvttpd_epi32(v);  // 截断取整：与 static_cast<int> 一致
+	};
+	for (; i + 8 <= n; i += 8) {
+		__m128i lo = _mm_unpacklo_epi64(convert(src + i), convert(src + i + 2));
+		__m128i hi = _mm_unpacklo_epi64(convert(src + i + 4), convert(src + i + 6));
+		__m128i v = _mm_packus_epi16(_mm_packs_epi32(lo, hi), _mm_setzero_si128());
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), v);
+	}
+#endif
+	for (; i < n; ++i) {
+		double c = std::max(0.0, std::min(1.0, src[i]));
+		dst[i] = std::uint8_t(static_cast<int>(255.999 * c));
+	}
+}
+
+bool ImageWriter::writePPM(const std::string& path, const std::vector<Vec3>& colors, int width, int height) {
+	std::ofstream out(path, std::ios::binary);
+	if (!out.is_open()) {
+		std::cerr << "Failed to open output PPM: " << path << "\n";
+		return false;
+	}
+	out << "P3\n" << width << " " << height << "\n255\n";
+	for (int i = 0; i < width * height; ++i) {
+		Vec3 c = Vec3::clamp01(colors[i]);
+		int ir = static_cast<int>(255.999 * c.x);
+		int ig = static_cast<int>(255.999 * c.y);
+		int ib = static_cast<int>(255.999 * c.z);
+		out << ir << " " << ig << " " << ib << "\n";
+	}
+	return bool(out);
+}
+
+bool ImageWriter::writeQOI(const std::string& path, const std::vector<Vec3>& colors, int width, int height) {
+	const size_t pixels = size_t(width) * height;
+	if (width <= 0 || height <= 0 || colors.size() != pixels) return false;
+	std::vector<std::uint8_t> rgb(pixels * 3);
+	std::vector<int> starts = bandStarts(height, 16);
+	const int bands = int(starts.size()) - 1;
+
+	// 各行带独立量化并编码
+	std::vector<std::vector<std::uint8_t>> pieces(size_t(bands) + 2);
+	Parallel::forEach(0, bands, [&](int b) {
+		size_t p0 = size_t(starts[b]) * width, p1 = size_t(starts[b + 1]) * width;
+		toRGB8(colors.data() + p0, p1 - p0, rgb.data() + 3 * p0);
+	});
+	std::vector<size_t> bandPixels(bands);
+	for (int b = 0; b < bands; ++b) bandPixels[b] = size_t(starts[b]) * width;
+	const std::vector<QoiPixel> snapshots = qoiIndexSnapshots(rgb.data(), bandPixels);
+	Parallel::forEach(0, bands, [&](int b) {
+		encodeQoiBand(rgb.data(), bandPixels[b], size_t(starts[b + 1]) * width, &snapshots[size_t(b) * 64],
+			pieces[size_t(b) + 1]);
+	});
+
+	std::vector<std::uint8_t>& header = pieces.front();
+	header = { 'q', 'o', 'i', 'f' };
+	putBE32(header, std::uint32_t(width));
+	putBE32(header, std::uint32_t(height));
+	header.push_back(3);  // RGB
+	header.push_back(0);  // sRGB
+	pieces.back() = { 0, 0, 0, 0, 0, 0, 0, 1 };
+	return writeFile(path, pieces);
+}
+
+bool ImageWriter::writePNG(const std::string& path, const std::vector<Vec3>& colors, int width, int height, int level) {
+	const size_t pixels = size_t(width) * height;
+	if (width <= 0 || height <= 0 || colors.size() != pixels) return false;
+	initCrc();
+	level = std::max(0, std::min(9, level));
+
+	std::vector<std::uint8_t> rgb(pixels * 3);
+	std::vector<int> starts = bandStarts(height, 32);
+	const int bands = int(starts.size()) - 1;
+	const size_t rowBytes = size_t(width) * 3 + 1;
+
+	Parallel::forEach(0, bands, [&](int b) {
+		size_t p0 = size_t(starts[b]) * width, p1 = size_t(starts[b + 1]) * width;
+		toRGB8(colors.data() + p0, p1 - p0, rgb.data() + 3 * p0);
+	});
+
+	// 每个行带：滤波 -> 独立 deflate 段 -> 一个 IDAT 块（最后一带在合并 Adler-32 后再封装）
+	std::vector<std::vector<std::uint8_t>> segments(bands);
+	std::vector<std::uint32_t> adlers(bands);
+	std::vector<size_t> rawSizes(bands);
+	std::vector<std::vector<std::uint8_t>> pieces(size_t(bands) + 2);
+	Parallel::forEach(0, bands, [&](int b) {
+		std::vector<std::uint8_t> filtered(size_t(starts[b + 1] - starts[b]) * rowBytes);
+		filterRows(rgb.data(), width, starts[b], starts[b + 1], filtered.data());
+		adlers[b] = adler32(filtered.data(), filtered.size());
+		rawSizes[b] = filtered.size();
+
+		std::vector<std::uint8_t>& seg = segments[b];
+		if (b == 0) {
+			// zlib 头：CMF=0x78（32K 窗口），FLG 表示压缩级别
+			seg.push_back(0x78);
+			seg.push_back(level == 0 ? 0x01 : (level >= 9 ? 0xDA : 0x9C));
+		}
+		deflateSegment(filtered.data(), filtered.size(), level, b == bands - 1, seg);
+		if (b != bands - 1) appendChunk(pieces[size_t(b) + 1], "IDAT", seg.data(), seg.size());
+	});
+
+	std::uint32_t adler = adlers[0];
+	for (int b = 1; b < bands; ++b) adler = adler32Combine(adler, adlers[b], rawSizes[b]);
+	std::vector<std::uint8_t>& last = segments[bands - 1];
+	putBE32(last, adler);
+	appendChunk(pieces[size_t(bands)], "IDAT", last.data(), last.size());
+
+	std::vector<std::uint8_t>& header = pieces.front();
+	header = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	std::vector<std::uint8_t> ihdr;
+	putBE32(ihdr, std::uint32_t(width));
+	putBE32(ihdr, std::uint32_t(height));
+	ihdr.insert(ihdr.end(), { 8, 2, 0, 0, 0 });  // 8位 RGB，deflate，自适应滤波，非隔行
+	appendChunk(header, "IHDR", ihdr.data(), ihdr.size());
+	appendChunk(pieces.back(), "IEND", nullptr, 0);
+	return writeFile(path, pieces);
+}
+
+bool ImageWriter::write(const std::string& path, const std::vector<Vec3>& colors, int width, int height, int pngLevel) {
+	switch (formatFromPath(path)) {
+	case ImageFormat::QOI: return writeQOI(path, colors, width, height);
+	case ImageFormat::PNG: return writePNG(path, colors, width, height, pngLevel);
+	default: return writePPM(path, colors, width, height);
+	}
+}
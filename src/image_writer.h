@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "vec3.h"
+
+/// @brief 图像输出格式
+enum class ImageFormat {
+	PPM,  // 文本 P3（原有格式）
+	QOI,  // Quite OK Image：编码最快
+	PNG   // PNG：stored 或 deflate
+};
+
+// Image file writers without external dependencies. QOI and PNG frames are split into row bands
+// that are encoded on separate threads and concatenated: QOI bands start from the encoder state
+// at their first pixel (hash index snapshots taken in one sequential pass), PNG bands are
+// independent deflate segments (byte aligned with an empty stored block) written as one IDAT
+// chunk each.
+namespace ImageWriter {
+	/// @brief 按扩展名判断格式（.qoi / .png，其余为 PPM）
+	ImageFormat formatFromPath(const std::string& path);
+
+	/// @brief 颜色量化为 RGB24，规则与 PPM 输出一致：int(255.999 * clamp01(c))，NaN 与 clamp01 一样钳到 1（255）
+	/// @param colors 颜色数组
+	/// @param count 像素数
+	/// @param dst 输出，至少 3 * count 字节
+	void toRGB8(const Vec3* colors, size_t count, std::uint8_t* dst);
+
+	/// @brief 写文本 PPM（P3）
+	bool writePPM(const std::string& path, const std::vector<Vec3>& colors, int width, int height);
+
+	/// @brief 写 QOI
+	bool writeQOI(const std::string& path, const std::vector<Vec3>& colors, int width, int height);
+
+	/// @brief 写 PNG
+	/// @param level 0 为 stored（不压缩），1-9 为 deflate 压缩级别（越大匹配搜索越深）
+	bool writePNG(const std::string& path, const std::vector<Vec3>& colors, int width, int height, int level = 6);
+
+	/// @brief 按扩展名选择格式写出
+	bool write(const std::string& path, const std::vector<Vec3>& colors, int width, int height, int pngLevel = 6);
+}
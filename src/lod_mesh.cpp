@@ -0,0 +1,30 @@
+#include "lod_mesh.h"
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <utility>
+
+LodMesh::LodMesh(const std::vector<MeshData>& meshLevels, const BvhOptions& bvhOptions) {
+	const double INF = std::numeric_limits<double>::infinity();
+	Vec3 lo(INF, INF, INF), hi(-INF, -INF, -INF);
+	for (const MeshData& mesh : meshLevels) {
+		for (const Vec3& p : mesh.positions) {
+			lo = Vec3(std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z));
+			hi = Vec3(std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z));
+		}
+	}
+	center = lo.x <= hi.x ? (lo + hi) * 0.5 : Vec3(0, 0, 0);
+	for (const MeshData& mesh : meshLevels) {
+		for (const Vec3& p : mesh.positions) radius = std::max(radius, (p - center).length());
+	}
+
+	// 层级三角形须在构造后保持不变（光栅化直接读取），因此不使用延迟构建
+	BvhOptions options = bvhOptions;
+	options.lazyBuild = false;
+	options.report = false;
+	levels.reserve(meshLevels.size());
+	for (const MeshData& mesh : meshLevels) levels.push_back(std::make_unique<BvhMesh>(mesh, options));
+}
+
+LodLevel::LodLevel(std::shared_ptr<const LodMesh> mesh, int level)
+	: lod(std::move(mesh)), lvl(std::max(0, std::min(level, lod->levelCount() - 1))) {}
@@ -0,0 +1,129 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include "hittable.h"
+#include "triangle.h"
+#include "mesh_loader.h"
+#include "bvh_mesh.h"
+
+// Every level sits behind its own BvhMesh (built eagerly, so the triangle order never changes
+// and the rasterizer can read the levels directly); a ray against LOD0 of a heavy mesh costs a
+// tree traversal, not a loop over all of its triangles.
+/// @brief 多级细节网格：持有一条简化LOD链，构建后只读；渲染器每帧按屏幕投影大小选择层级（见 LodLevel）
+class LodMesh : public Hittable {
+public:
+	/// @brief 构造函数
+	/// @param levels LOD链，[0] 最精细
+	/// @param bvhOptions 各层级的 BVH 构建选项（忽略 lazyBuild 与 report）
+	explicit LodMesh(const std::vector<MeshData>& levels, const BvhOptions& bvhOptions = BvhOptions());
+
+	/// @brief 与最精细层级求交
+	bool hit(const Ray& r, double t_min, double t_max, HitRecord& out_rec) const override {
+		return hitLevel(0, r, t_min, t_max, out_rec);
+	}
+
+	/// @brief 遮挡查询（最精细层级）
+	bool occluded(const Ray& r, double t_min, double t_max) const override {
+		return occludedLevel(0, r, t_min, t_max);
+	}
+	bool hitPrepared(const Ray& r, const TriangleRay& tray, double t_min, double t_max, HitRecord& out_rec) const override {
+		return hitLevel(0, r, tray, t_min, t_max, out_rec);
+	}
+	bool occludedPrepared(const Ray& r, const TriangleRay& tray, double t_min, double t_max) const override {
+		return occludedLevel(0, r, tray, t_min, t_max);
+	}
+	/// @brief 包围盒取包围球的外接盒（覆盖所有层级）
+	bool boundingBox(AABB& out) const override {
+		Vec3 r(radius, radius, radius);
+		out = AABB(center - r, center + r);
+		return !levels.empty();
+	}
+	/// @brief 批量求交（最精细层级）
+	void hitStream(const RayStream& rays, size_t begin, size_t end, double t_min,
+		double* tMax, std::uint32_t* hitIndex, std::uint32_t id) const override {
+		hitStreamLevel(0, rays, begin, end, t_min, tMax, hitIndex, id);
+	}
+
+	/// @brief 遍历指定层级的 BVH 求最近交点
+	bool hitLevel(int level, const Ray& r, double t_min, double t_max, HitRecord& out_rec) const {
+		return !levels.empty() && levels[level]->hit(r, t_min, t_max, out_rec);
+	}
+	/// @brief 遮挡查询：指定层级任一三角形被击中即返回
+	bool occludedLevel(int level, const Ray& r, double t_min, double t_max) const {
+		return !levels.empty() && levels[level]->occluded(r, t_min, t_max);
+	}
+	/// @brief hitLevel，复用调用方构建的 TriangleRay
+	bool hitLevel(int level, const Ray& r, const TriangleRay& tray, double t_min, double t_max, HitRecord& out_rec) const {
+		return !levels.empty() && levels[level]->hitPrepared(r, tray, t_min, t_max, out_rec);
+	}
+	/// @brief occludedLevel，复用调用方构建的 TriangleRay
+	bool occludedLevel(int level, const Ray& r, const TriangleRay& tray, double t_min, double t_max) const {
+		return !levels.empty() && levels[level]->occludedPrepared(r, tray, t_min, t_max);
+	}
+	/// @brief 批量求交：逐条光线遍历该层级的 BVH
+	void hitStreamLevel(int level, const RayStream& rays, size_t begin, size_t end, double t_min,
+		double* tMax, std::uint32_t* hitIndex, std::uint32_t id) const {
+		if (!levels.empty()) levels[level]->hitStream(rays, begin, end, t_min, tMax, hitIndex, id);
+	}
+
+	/// @brief LOD层数
+	int levelCount() const { return int(levels.size()); }
+	/// @brief 指定层级的三角形数
+	size_t triangleCount(int level) const { return levels[level]->triangles().size(); }
+
+	/// @brief 指定层级的三角形（BVH 叶子顺序）
+	const std::vector<Triangle>& triangles(int level) const { return levels[level]->triangles(); }
+
+	/// @brief 包围球球心（覆盖所有层级）
+	const Vec3& boundsCenter() const { return center; }
+	/// @brief 包围球半径（覆盖所有层级）
+	double boundsRadius() const { return radius; }
+
+private:
+	/// @brief 各层级的 BVH
+	std::vector<std::unique_ptr<BvhMesh>> levels;
+	/// @brief 包围球
+	Vec3 center;
+	double radius = 0.0;
+};
+
+// One level of a shared LodMesh. After picking levels for a frame the renderer traces a copy of
+// the object list in which every LodMesh is replaced by one of these, so the mesh itself is never
+// modified and two renders of the same scene can use different levels at the same time.
+/// @brief 固定层级的 LodMesh 视图
+class LodLevel : public Hittable {
+public:
+	/// @brief 构造函数
+	/// @param mesh LOD网格
+	/// @param level 层级（越界时截断）
+	LodLevel(std::shared_ptr<const LodMesh> mesh, int level);
+
+	bool hit(const Ray& r, double t_min, double t_max, HitRecord& out_rec) const override {
+		return lod->hitLevel(lvl, r, t_min, t_max, out_rec);
+	}
+	bool occluded(const Ray& r, double t_min, double t_max) const override {
+		return lod->occludedLevel(lvl, r, t_min, t_max);
+	}
+	bool hitPrepared(const Ray& r, const TriangleRay& tray, double t_min, double t_max, HitRecord& out_rec) const override {
+		return lod->hitLevel(lvl, r, tray, t_min, t_max, out_rec);
+	}
+	bool occludedPrepared(const Ray& r, const TriangleRay& tray, double t_min, double t_max) const override {
+		return lod->occludedLevel(lvl, r, tray, t_min, t_max);
+	}
+	bool boundingBox(AABB& out) const override { return lod->boundingBox(out); }
+	void hitStream(const RayStream& rays, size_t begin, size_t end, double t_min,
+		double* tMax, std::uint32_t* hitIndex, std::uint32_t id) const override {
+		lod->hitStreamLevel(lvl, rays, begin, end, t_min, tMax, hitIndex, id);
+	}
+
+	/// @brief 所属网格
+	const LodMesh& mesh() const { return *lod; }
+	/// @brief 层级
+	int level() const { return lvl; }
+	/// @brief 该层级的三角形
+	const std::vector<Triangle>& triangles() const { return lod->triangles(lvl); }
+
+private:
+	std::shared_ptr<const LodMesh> lod;
+	int lvl = 0;
+};
@@ -15,6 +15,8 @@
 #include "mesh_loader.h"
 #include "renderer.h"
 #include "toon_shader.h"
+#include "camera_rig.h"
+#include "bench.h"
 
 /// @brief 检查文件是否存在
 /// @param path 文件路径
@@ -38,16 +40,55 @@ static Vec3 parseVec3(const std::string& str) {
 	return Vec3(0, 0, 0);
 }
 
+/// @brief 解析逗号分隔的整数列表
+/// @param str 格式为 "a,b,..." 的字符串
+/// @param out 解析结果
+/// @param count 期望的整数个数
+/// @return 格式正确且个数一致时返回true
+static bool parseInts(const std::string& str, int* out, int count) {
+	std::istringstream iss(str);
+	for (int k = 0; k < count; ++k) {
+		if (!(iss >> out[k])) return false;
+		char comma;
+		if (k + 1 < count && !(iss >> comma && comma == ',')) return false;
+	}
+	char extra;
+	return !(iss >> extra);
+}
+
 /// @brief 打印程序使用说明
 static void printUsage(const char* progName) {
 	std::cout << "Usage: " << progName << " [OPTIONS]\n";
 	std::cout << "Options:\n";
 	std::cout << "  --obj, -o PATH           OBJ file path (default: Cone.obj)\n";
+	std::cout << "  --ply PATH               Binary/ASCII PLY point cloud rendered as spheres (uses --scale/--translate)\n";
+	std::cout << "  --point-radius R         Sphere radius for PLY points without a radius property, in PLY units scaled by --scale (default: 0.01)\n";
 	std::cout << "  --lookFrom, -from X,Y,Z  Camera position (default: 4,4,4)\n";
 	std::cout << "  --lookAt, -at X,Y,Z      Camera target (default: 0,0,0)\n";
 	std::cout << "  --vfov, -fov DEGREES     Vertical field of view (default: 45.0)\n";
 	std::cout << "  --scale, -s VALUE        Object scale (default: 0.7)\n";
 	std::cout << "  --translate, -t X,Y,Z    Object translation (default: 1,0.3,1)\n";
+	std::cout << "  --output PATH            Output image; .qoi and .png select those formats (default: toon_output.ppm)\n";
+	std::cout << "  --png-level N            PNG compression level 0-9, 0 = stored (default: 6)\n";
+	std::cout << "  --turnaround N           Render N views orbiting the target in one job (OUT_view<deg>.ext)\n";
+	std::cout << "  --stereo SEPARATION      Render a parallel stereo pair (OUT_left.ext, OUT_right.ext)\n";
+	std::cout << "  --cubemap                Render 6 square cubemap faces from --lookFrom (OUT_px.ext ...)\n";
+	std::cout << "  --y4m PATH               Stream the frame as YUV4MPEG2 to PATH (\"-\" = stdout, logs go to stderr);\n";
+	std::cout << "                           with --turnaround/--stereo/--cubemap every view is one frame of the stream\n";
+	std::cout << "  --rgb PATH               Stream the frame(s) as raw RGB24 to PATH (\"-\" = stdout)\n";
+	std::cout << "  --fps N                  Frame rate written to the Y4M header (default: 24)\n";
+	std::cout << "  --progressive SECONDS    Progressive preview (1/8, 1/4, 1/2, full) within a time budget, per-pixel ray tracing\n";
+	std::cout << "  --verify-raster          Compare raster and ray-traced visibility (object IDs, depths); exit 1 on mismatch\n";
+	std::cout << "  --bench-toon             Benchmark the batched toon shading kernel against per-pixel kernel calls\n";
+	std::cout << "  --bench-bvh [OBJ]        Benchmark quantized 4-wide against binary BVH traversal (default: generated mesh)\n";
+	std::cout << "  --bench-triangle         Benchmark the watertight ray/triangle test against Moller-Trumbore\n";
+	std::cout << "Distributed rendering (partials hold raw color/depth/normal/ID buffers):\n";
+	std::cout << "  --rows Y0,Y1             Render only rows [Y0, Y1) into a partial\n";
+	std::cout << "  --band K/N               Render row band K of N (0-based) into a partial\n";
+	std::cout << "  --tiles TX0,TY0,TX1,TY1  Render only tiles [TX0, TX1) x [TY0, TY1) into a partial\n";
+	std::cout << "  --tile-size N            Tile size in pixels for --tiles (default: 256)\n";
+	std::cout << "  --partial PATH           Partial output path (default: toon_part.bin)\n";
+	std::cout << "  --merge PART...          Merge partials, run outlines over the whole frame, write the image\n";
 	std::cout << "  --help, -h               Show this help message\n";
 }
 
@@ -56,6 +97,10 @@ int main(int argc, char* argv[]) {
 
 	/// @brief 默认OBJ文件路径
 	std::string objPath = "Cone.obj";
+	/// @brief PLY 点云路径（空表示不加载）
+	std::string plyPath;
+	/// @brief 点云默认球半径（场景单位）
+	double pointRadius = 0.01;
 	/// @brief 相机位置
 	Vec3 lookFrom(4, 4, 4);
 	/// @brief 相机看向目标位置
@@ -67,6 +112,39 @@ int main(int argc, char* argv[]) {
 	/// @brief 对象平移向量
 	Vec3 translate(1, 0.3, 1);
 
+	/// @brief 输出图像路径（扩展名决定格式：.ppm / .qoi / .png）
+	std::string outputPath = "toon_output.ppm";
+	/// @brief PNG 压缩级别
+	int pngLevel = 6;
+	/// @brief 多视图模式：0 关闭，1 转身图，2 立体像对，3 立方体贴图
+	int multiView = 0;
+	/// @brief 转身图视图数
+	int turnaroundViews = 8;
+	/// @brief 立体像对的眼间距（场景单位）
+	double stereoSeparation = 0.065;
+	/// @brief 视频流输出路径（空表示写 PPM 文件）
+	std::string streamPath;
+	/// @brief 视频流格式
+	VideoFormat streamFormat = VideoFormat::Y4M;
+	/// @brief 视频流帧率
+	int streamFps = 24;
+	/// @brief 渐进式预览的时间预算（秒），<=0 表示关闭
+	double progressiveBudget = 0.0;
+	/// @brief 只做光栅/光线可见性一致性检查
+	bool verifyRaster = false;
+
+	// Distributed rendering 分布式渲染
+	/// @brief 分块渲染模式：0 整帧，1 行范围，2 行带 K/N，3 分块范围
+	int partialMode = 0;
+	/// @brief 分块参数（含义随 partialMode 变化）
+	int partialArgs[4] = { 0, 0, 0, 0 };
+	/// @brief 分块边长（像素）
+	int tileSize = 256;
+	/// @brief 分块输出路径
+	std::string partialPath = "toon_part.bin";
+	/// @brief 需要合并的分块文件
+	std::vector<std::string> mergePaths;
+
 	// Parse command line arguments
 	for (int i = 1; i < argc; i++) {
 		std::string arg = argv[i];
@@ -82,6 +160,22 @@ int main(int argc, char* argv[]) {
 				return 1;
 			}
 		}
+		else if (arg == "--ply") {
+			if (i + 1 < argc) {
+				plyPath = argv[++i];
+			} else {
+				std::cerr << "Error: --ply requires a path argument\n";
+				return 1;
+			}
+		}
+		else if (arg == "--point-radius") {
+			if (i + 1 < argc) {
+				pointRadius = std::stod(argv[++i]);
+			} else {
+				std::cerr << "Error: --point-radius requires a number argument\n";
+				return 1;
+			}
+		}
 		else if (arg == "--lookFrom" || arg == "-from") {
 			if (i + 1 < argc) {
 				lookFrom = parseVec3(argv[++i]);
@@ -122,19 +216,141 @@ int main(int argc, char* argv[]) {
 				return 1;
 			}
 		}
+		else if (arg == "--output") {
+			if (i + 1 < argc) {
+				outputPath = argv[++i];
+			} else {
+				std::cerr << "Error: --output requires a path argument\n";
+				return 1;
+			}
+		}
+		else if (arg == "--png-level") {
+			if (i + 1 < argc) {
+				pngLevel = std::max(0, std::min(9, std::stoi(argv[++i])));
+			} else {
+				std::cerr << "Error: --png-level requires a number argument\n";
+				return 1;
+			}
+		}
+		else if (arg == "--turnaround") {
+			if (i + 1 < argc) {
+				multiView = 1;
+				turnaroundViews = std::max(1, std::stoi(argv[++i]));
+			} else {
+				std::cerr << "Error: --turnaround requires a view count\n";
+				return 1;
+			}
+		}
+		else if (arg == "--stereo") {
+			if (i + 1 < argc) {
+				multiView = 2;
+				stereoSeparation = std::stod(argv[++i]);
+			} else {
+				std::cerr << "Error: --stereo requires an eye separation\n";
+				return 1;
+			}
+		}
+		else if (arg == "--cubemap") {
+			multiView = 3;
+		}
+		else if (arg == "--y4m" || arg == "--rgb") {
+			if (i + 1 < argc) {
+				streamPath = argv[++i];
+				streamFormat = arg == "--y4m" ? VideoFormat::Y4M : VideoFormat::RawRGB;
+			} else {
+				std::cerr << "Error: " << arg << " requires a path argument\n";
+				return 1;
+			}
+		}
+		else if (arg == "--fps") {
+			if (i + 1 < argc) {
+				streamFps = std::max(1, std::stoi(argv[++i]));
+			} else {
+				std::cerr << "Error: --fps requires a number argument\n";
+				return 1;
+			}
+		}
+		else if (arg == "--progressive") {
+			if (i + 1 < argc) {
+				progressiveBudget = std::stod(argv[++i]);
+			} else {
+				std::cerr << "Error: --progressive requires a number of seconds\n";
+				return 1;
+			}
+		}
+		else if (arg == "--bench-toon") {
+			return Bench::toonKernel() ? 0 : 1;
+		}
+		else if (arg == "--bench-bvh") {
+			// 可选的 OBJ 路径；缺省时使用生成的网格
+			std::string meshPath = i + 1 < argc && argv[i + 1][0] != '-' ? argv[++i] : "";
+			return Bench::bvhLayouts(meshPath) ? 0 : 1;
+		}
+		else if (arg == "--bench-triangle") {
+			return Bench::triangleTests() ? 0 : 1;
+		}
+		else if (arg == "--verify-raster") {
+			verifyRaster = true;
+		}
+		else if (arg == "--rows" || arg == "--band" || arg == "--tiles") {
+			if (i + 1 >= argc) {
+				std::cerr << "Error: " << arg << " requires an argument\n";
+				return 1;
+			}
+			std::string value = argv[++i];
+			bool ok = false;
+			if (arg == "--rows") { partialMode = 1; ok = parseInts(value, partialArgs, 2); }
+			else if (arg == "--band") {
+				partialMode = 2;
+				size_t slash = value.find('/');
+				if (slash != std::string::npos) value[slash] = ',';
+				ok = parseInts(value, partialArgs, 2) && partialArgs[1] > 0 && partialArgs[0] >= 0 && partialArgs[0] < partialArgs[1];
+			}
+			else { partialMode = 3; ok = parseInts(value, partialArgs, 4); }
+			if (!ok) {
+				std::cerr << "Error: invalid " << arg << " argument '" << value << "'\n";
+				return 1;
+			}
+		}
+		else if (arg == "--tile-size") {
+			if (i + 1 < argc) {
+				tileSize = std::max(1, std::stoi(argv[++i]));
+			} else {
+				std::cerr << "Error: --tile-size requires a number argument\n";
+				return 1;
+			}
+		}
+		else if (arg == "--partial") {
+			if (i + 1 < argc) {
+				partialPath = argv[++i];
+			} else {
+				std::cerr << "Error: --partial requires a path argument\n";
+				return 1;
+			}
+		}
+		else if (arg == "--merge") {
+			// 其后直到下一个选项的参数都是分块文件
+			while (i + 1 < argc && argv[i + 1][0] != '-') mergePaths.push_back(argv[++i]);
+			if (mergePaths.empty()) {
+				std::cerr << "Error: --merge requires at least one partial file\n";
+				return 1;
+			}
+		}
 		else {
 			std::cerr << "Unknown option: " << arg << "\n";
 			std::cerr << "Use --help for usage information\n";
 			return 1;
 		}
 	}
+	// 视频流写到标准输出时，日志改走标准错误，避免混入视频数据
+	if (streamPath == "-") std::cout.rdbuf(std::cerr.rdbuf());
+
 	// Image settings
+	// 立方体贴图的各面必须是方形
 	/// @brief 屏幕宽度
-	const int width = 640;
+	const int width = multiView == 3 ? 360 : 640;
 	/// @brief 屏幕高度
 	const int height = 360;
-	/// @brief 输出PPM文件路径
-	const std::string outputPath = "toon_output.ppm";
 
 	// Camera (using command line parameters)
 	/// @brief 相机指向的方向向量
@@ -154,21 +370,35 @@ int main(int argc, char* argv[]) {
 	light.direction = Vec3(-0.7, -1.0, -0.4).normalized();
 	light.color = Vec3(1.0, 1.0, 1.0);
 
-	// Materials 材质
+	// Materials 材质（场景材质表，图元只保存材质ID）
+	MaterialTable materials;
 	Material red; red.albedo = Vec3(0.9, 0.25, 0.25); red.shininess = 64.0;
 	Material green; green.albedo = Vec3(0.25, 0.9, 0.25); green.shininess = 16.0;
 	Material gray; gray.albedo = Vec3(0., 0.6, 0.6); gray.shininess = 32.0;
+	MaterialId redId = materials.add(red, "red");
+	materials.add(green, "green");
+	materials.add(gray, "gray");
 
 	// Scene objects
 	/// @brief 场景中的可击中对象列表
 	std::vector<std::shared_ptr<Hittable>> objects;
 
 	// // Sphere
-	objects.push_back(std::make_shared<Sphere>(Vec3(0.0, 0.6, 0.0), 2, red));
+	objects.push_back(std::make_shared<Sphere>(Vec3(0.0, 0.6, 0.0), 2, redId));
+
+	// Point cloud 点云：每个点一个球，逐点颜色作为反照率
+	if (!plyPath.empty()) {
+		SphereSetOptions pointOptions;
+		pointOptions.pointRadius = pointRadius;
+		if (!MeshLoader::loadPLYSpheres(plyPath, scale, translate, materials.find("gray"), objects, pointOptions)) {
+			std::cerr << "Failed to load point cloud: " << plyPath << "\n";
+			return 1;
+		}
+	}
 
 	// Load OBJ file (using command line parameters)  加载OBJ模型
 	// if (file_exists(objPath)) {
-	// 	MeshLoader::loadOBJ(objPath, scale, translate, green, objects);
+	// 	MeshLoader::loadOBJ(objPath, scale, translate, materials, materials.find("green"), objects);
 	// 	std::cout << "Loaded OBJ: " << objPath << " (scale=" << scale << ", translate=" 
 	// 	          << translate.x << "," << translate.y << "," << translate.z << ")\n";
 	// }
@@ -219,14 +449,90 @@ int main(int argc, char* argv[]) {
 	toon.outputBrightness = 0.5; // 降低diffuse亮度
 
 	Renderer renderer(width, height, cam, light);
+	RenderOptions renderOptions = renderer.getOptions();
+	renderOptions.pngCompression = pngLevel;
+	renderer.setOptions(renderOptions);
 	bool enableDepthEdges = true;
 	double depthEdgeThreshold = 0.7; // Increased threshold for Sobel operator to make edges thinner
 
-	if (renderer.renderPPM(objects, toon, outputPath, enableDepthEdges, depthEdgeThreshold)) {
+	if (verifyRaster) {
+		return renderer.verifyRaster(objects, materials, toon) ? 0 : 1;
+	}
+
+	// 多视图相机组（--turnaround / --stereo / --cubemap）
+	std::vector<CameraView> views;
+	if (multiView == 1) views = CameraRig::turnaround(lookFrom, lookAt, vfov, aspect, turnaroundViews);
+	else if (multiView == 2) views = CameraRig::stereoPair(lookFrom, lookAt, vfov, aspect, stereoSeparation);
+	else if (multiView == 3) views = CameraRig::cubemap(lookFrom);
+
+	if (!streamPath.empty()) {
+		// 每个视图是流中的一帧（如 --turnaround 得到环绕动画）；帧缓冲与转换缓冲在整个序列中复用
+		if (views.empty()) views.push_back(CameraView{ cam, "" });
+		VideoSink sink;
+		if (!sink.open(streamPath, streamFormat, width, height, streamFps)) {
+			std::cerr << "Streaming to " << streamPath << " failed.\n";
+			return 1;
+		}
+		for (const CameraView& view : views) {
+			renderer.setCamera(view.camera);
+			if (!renderer.renderToSink(objects, materials, toon, sink, enableDepthEdges, depthEdgeThreshold)) {
+				std::cerr << "Streaming to " << streamPath << " failed after " << sink.framesWritten() << " frames.\n";
+				return 1;
+			}
+		}
+		sink.close();
+		std::cerr << "Streamed " << views.size() << (views.size() == 1 ? " frame" : " frames") << " to " << streamPath << "\n";
+		return 0;
+	}
+
+	if (!mergePaths.empty()) {
+		// 合并分块：后处理在整帧上进行，接缝与单进程渲染一致
+		if (renderer.mergePartials(mergePaths, outputPath, enableDepthEdges, depthEdgeThreshold)) {
+			std::cout << "Wrote: " << outputPath << "\n";
+			return 0;
+		}
+		std::cerr << "Merge failed.\n";
+		return 1;
+	}
+	if (partialMode != 0) {
+		PixelRect part;
+		if (partialMode == 1) part = PixelRect(0, partialArgs[0], width, partialArgs[1]);
+		else if (partialMode == 2) part = PixelRect(0, height * partialArgs[0] / partialArgs[1], width, height * (partialArgs[0] + 1) / partialArgs[1]);
+		else part = PixelRect(partialArgs[0] * tileSize, partialArgs[1] * tileSize, partialArgs[2] * tileSize, partialArgs[3] * tileSize);
+		if (renderer.renderPartial(objects, materials, toon, part, partialPath)) {
+			std::cout << "Wrote partial: " << partialPath << "\n";
+			return 0;
+		}
+		std::cerr << "Partial render failed.\n";
+		return 1;
+	}
+
+	if (!views.empty()) {
+		std::vector<Camera> cameras;
+		std::vector<std::string> paths;
+		for (const CameraView& view : views) {
+			cameras.push_back(view.camera);
+			paths.push_back(CameraRig::viewPath(outputPath, view.name));
+		}
+		return renderer.renderViews(objects, materials, toon, cameras, paths, enableDepthEdges, depthEdgeThreshold) ? 0 : 1;
+	}
+
+	if (progressiveBudget > 0.0) {
+		int step = renderer.renderProgressive(objects, materials, toon, outputPath, enableDepthEdges, depthEdgeThreshold, progressiveBudget);
+		if (step == 0) {
+			std::cerr << "Progressive render failed.\n";
+			return 1;
+		}
+		std::cout << "Wrote: " << outputPath << " (1/" << step << " resolution)\n";
+		return 0;
+	}
+
+	if (renderer.renderPPM(objects, materials, toon, outputPath, enableDepthEdges, depthEdgeThreshold)) {
 		std::cout << "Wrote: " << outputPath << "\n";
 	}
 	else {
 		std::cerr << "Render failed.\n";
+		return 1;
 	}
 	return 0;
 }
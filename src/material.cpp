@@ -1,3 +1,76 @@
 #include "material.h"
+#include <fstream>
+#include <sstream>
+#include <iostream>
 
+MaterialId MaterialTable::add(const Material& m, const std::string& name) {
+	if (!name.empty()) {
+		auto it = byName.find(name);
+		if (it != byName.end()) {
+			std::cerr << "Material '" << name << "' is already defined, keeping the existing one\n";
+			return it->second;
+		}
+	}
+	MaterialId id = static_cast<MaterialId>(materials.size());
+	materials.push_back(m);
+	if (!name.empty()) byName[name] = id;
+	return id;
+}
 
+MaterialId MaterialTable::find(const std::string& name) const {
+	auto it = byName.find(name);
+	return it == byName.end() ? kInvalid : it->second;
+}
+
+const Material& MaterialTable::get(MaterialId id) const {
+	static const Material fallback;
+	if (id >= materials.size()) return fallback;
+	return materials[id];
+}
+
+bool MaterialTable::loadMTL(const std::string& path) {
+	std::ifstream in(path);
+	if (!in.is_open()) {
+		std::cerr << "Failed to open MTL: " << path << "\n";
+		return false;
+	}
+
+	// 当前正在解析的材质（遇到下一个 newmtl 或文件结束时提交）
+	std::string currentName;
+	Material current;
+	bool hasCurrent = false;
+
+	std::string line;
+	while (std::getline(in, line)) {
+		if (!line.empty() && line.back() == '\r') line.pop_back();
+		if (line.empty() || line[0] == '#') continue;
+		std::istringstream iss(line);
+		std::string tag;
+		iss >> tag;
+
+		if (tag == "newmtl") {
+			if (hasCurrent) add(current, currentName);
+			currentName.clear();
+			std::getline(iss >> std::ws, currentName);
+			current = Material();
+			hasCurrent = true;
+		}
+		else if (!hasCurrent) {
+			continue;
+		}
+		else if (tag == "Kd") {
+			double r, g, b;
+			if (iss >> r >> g >> b) current.albedo = Vec3(r, g, b);
+		}
+		else if (tag == "Ks") {
+			double r, g, b;
+			if (iss >> r >> g >> b) current.specularColor = Vec3(r, g, b);
+		}
+		else if (tag == "Ns") {
+			double ns;
+			if (iss >> ns) current.shininess = ns;
+		}
+	}
+	if (hasCurrent) add(current, currentName);
+	return true;
+}
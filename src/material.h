@@ -1,6 +1,13 @@
 #pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
 #include "vec3.h"
 
+/// @brief 材质ID类型（场景材质表中的下标）
+using MaterialId = std::uint32_t;
+
 /// @brief 材质结构体
 struct Material {
 	/// @brief 漫反射颜色
@@ -13,4 +20,35 @@ struct Material {
 	double shininess = 32.0;
 };
 
+/// @brief 场景级材质表：图元只保存 MaterialId，着色前由渲染器查表
+class MaterialTable {
+public:
+	/// @brief 无效材质ID（查找失败时返回）
+	static constexpr MaterialId kInvalid = 0xFFFFFFFFu;
+
+	/// @brief 添加材质；同名材质已存在时保留原材质、输出警告并返回原ID（MTL 不会覆盖场景内置材质）
+	/// @param m 材质
+	/// @param name 材质名（可为空，空名不参与按名查找）
+	/// @return 材质ID
+	MaterialId add(const Material& m, const std::string& name = "");
+
+	/// @brief 按名字查找材质
+	/// @return 材质ID，未找到返回 kInvalid
+	MaterialId find(const std::string& name) const;
+
+	/// @brief 按ID取材质，越界时返回默认材质
+	const Material& get(MaterialId id) const;
+	const Material& operator[](MaterialId id) const { return get(id); }
 
+	/// @brief 材质数量
+	size_t size() const { return materials.size(); }
+
+	/// @brief 解析MTL文件（newmtl / Kd / Ks / Ns），追加到材质表
+	/// @param path MTL文件路径
+	/// @return 是否成功打开文件
+	bool loadMTL(const std::string& path);
+
+private:
+	std::vector<Material> materials;
+	std::unordered_map<std::string, MaterialId> byName;
+};
@@ -1,4 +1,7 @@
 #include "mesh_loader.h"
+#include "lod_mesh.h"
+#include "bvh_mesh.h"
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -27,16 +30,21 @@ namespace {
 		}
 		return true;
 	}
+
+	/// @brief 取OBJ文件所在目录（含末尾分隔符），用于解析相对路径的 mtllib
+	static std::string directoryOf(const std::string& path) {
+		size_t slash = path.find_last_of("/\\");
+		return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+	}
 }
 
 
-bool MeshLoader::loadOBJ(
+bool MeshLoader::loadOBJMesh(
 	const std::string& path,
-	double uniformScale,
-	const Vec3& translate,
-	const Material& material,
-	std::vector<std::shared_ptr<Hittable>>& outObjects) {
-	
+	MaterialTable& materials,
+	MaterialId defaultMaterial,
+	MeshData& outMesh) {
+
 	/// 打开OBJ文件
 	std::ifstream in(path);
 	// 检查文件是否成功打开
@@ -45,12 +53,19 @@ bool MeshLoader::loadOBJ(
 		return false;
 	}
 
+	outMesh = MeshData();
+
 	/// @brief 存储顶点位置的列表
-	std::vector<Vec3> positions;
+	std::vector<Vec3>& positions = outMesh.positions;
+
+	/// @brief 当前 usemtl 组的材质ID
+	MaterialId currentMaterial = defaultMaterial;
 
 	/// @brief 当前行内容
 	std::string line;
 	while (std::getline(in, line)) {
+		// 去掉Windows换行符残留的 '\r'
+		if (!line.empty() && line.back() == '\r') line.pop_back();
 		// 跳过空行
 		if (line.empty()) continue;
 
@@ -66,6 +81,23 @@ bool MeshLoader::loadOBJ(
 			Vec3 p(x, y, z);
 			positions.push_back(p);
 		}
+		// 材质库：解析MTL并追加到场景材质表
+		else if (tag == "mtllib") {
+			std::string lib;
+			std::getline(iss >> std::ws, lib);
+			if (!lib.empty()) materials.loadMTL(directoryOf(path) + lib);
+		}
+		// 切换后续面的材质
+		else if (tag == "usemtl") {
+			std::string name;
+			std::getline(iss >> std::ws, name);
+			MaterialId id = materials.find(name);
+			if (id == MaterialTable::kInvalid) {
+				std::cerr << "Unknown material '" << name << "' in " << path << ", using default\n";
+				id = defaultMaterial;
+			}
+			currentMaterial = id;
+		}
 		// 如果标签为F，解析面定义
 		else if (tag == "f") {
 			/// @brief 存储面的顶点索引
@@ -90,17 +122,114 @@ bool MeshLoader::loadOBJ(
 				if (i0 < 0 || i1 < 0 || i2 < 0) continue;
 				// 如果索引超出范围则跳过
 				if (i0 >= (int)positions.size() || i1 >= (int)positions.size() || i2 >= (int)positions.size()) continue;
-				// 应用缩放和平移变换后创建三角形并添加到输出对象列表
-				Vec3 a = positions[i0] * uniformScale + translate;
-				Vec3 b = positions[i1] * uniformScale + translate;
-				Vec3 c = positions[i2] * uniformScale + translate;
+				// 记录三角形索引及其材质
+				outMesh.indices.push_back(std::uint32_t(i0));
+				outMesh.indices.push_back(std::uint32_t(i1));
+				outMesh.indices.push_back(std::uint32_t(i2));
+				outMesh.faceMaterials.push_back(currentMaterial);
+			}
+		}
+	}
+	return true;
+}
+
+void MeshLoader::transformMesh(MeshData& mesh, double uniformScale, const Vec3& translate) {
+	for (Vec3& p : mesh.positions) p = p * uniformScale + translate;
+}
+
+void MeshLoader::appendTriangles(const MeshData& mesh, std::vector<std::shared_ptr<Hittable>>& outObjects) {
+	outObjects.reserve(outObjects.size() + mesh.triangleCount());
+	for (size_t f = 0; f < mesh.triangleCount(); ++f) {
+		const Vec3& a = mesh.positions[mesh.indices[3 * f + 0]];
+		const Vec3& b = mesh.positions[mesh.indices[3 * f + 1]];
+		const Vec3& c = mesh.positions[mesh.indices[3 * f + 2]];
+		outObjects.push_back(std::make_shared<Triangle>(a, b, c, mesh.faceMaterials[f]));
+	}
+}
+
+namespace {
+	/// @brief loadOBJ / loadOBJLod 共用：解析、变换、可选优化
+	static bool loadAndPrepare(const std::string& path, double uniformScale, const Vec3& translate,
+		MaterialTable& materials, MaterialId defaultMaterial, const MeshOptimizeOptions* optimize, MeshData& mesh) {
+		if (!MeshLoader::loadOBJMesh(path, materials, defaultMaterial, mesh)) return false;
+
+		// 应用缩放和平移变换（优化容差以场景单位计）
+		MeshLoader::transformMesh(mesh, uniformScale, translate);
 
-				// 创建三角形并添加到输出对象列表
-				outObjects.push_back(std::make_shared<Triangle>(a, b, c, material));
+		if (optimize) {
+			MeshOptimizeStats stats = MeshLoader::optimizeMesh(mesh, *optimize);
+			if (optimize->report) {
+				std::cout << "Mesh optimize (" << path << "): vertices " << stats.verticesIn << " -> " << stats.verticesOut
+					<< ", triangles " << stats.trianglesIn << " -> " << stats.trianglesOut
+					<< " (degenerate " << stats.degenerateRemoved << ", duplicate " << stats.duplicatesRemoved << ")\n";
 			}
 		}
+		return true;
 	}
+}
+
+bool MeshLoader::loadOBJ(
+	const std::string& path,
+	double uniformScale,
+	const Vec3& translate,
+	MaterialTable& materials,
+	MaterialId defaultMaterial,
+	std::vector<std::shared_ptr<Hittable>>& outObjects,
+	const MeshOptimizeOptions* optimize) {
+
+	MeshData mesh;
+	if (!loadAndPrepare(path, uniformScale, translate, materials, defaultMaterial, optimize, mesh)) return false;
+
+	// 创建三角形并添加到输出对象列表
+	appendTriangles(mesh, outObjects);
+	return true;
+}
+
+bool MeshLoader::loadOBJLod(
+	const std::string& path,
+	double uniformScale,
+	const Vec3& translate,
+	MaterialTable& materials,
+	MaterialId defaultMaterial,
+	std::vector<std::shared_ptr<Hittable>>& outObjects,
+	const MeshLodOptions& lodOptions,
+	const MeshOptimizeOptions* optimize) {
+
+	MeshData mesh;
+	if (!loadAndPrepare(path, uniformScale, translate, materials, defaultMaterial, optimize, mesh)) return false;
+
+	std::vector<MeshData> chain = buildLodChain(mesh, lodOptions);
+	std::cout << "LOD chain (" << path << "):";
+	for (const MeshData& level : chain) std::cout << " " << level.triangleCount();
+	std::cout << " triangles\n";
+
+	outObjects.push_back(std::make_shared<LodMesh>(chain));
 	return true;
 }
 
+bool MeshLoader::loadOBJBvh(
+	const std::string& path,
+	double uniformScale,
+	const Vec3& translate,
+	MaterialTable& materials,
+	MaterialId defaultMaterial,
+	std::vector<std::shared_ptr<Hittable>>& outObjects,
+	const BvhOptions& bvhOptions,
+	const MeshOptimizeOptions* optimize) {
+
+	MeshData mesh;
+	if (!loadAndPrepare(path, uniformScale, translate, materials, defaultMaterial, optimize, mesh)) return false;
 
+	auto bvh = std::make_shared<BvhMesh>(mesh, bvhOptions);
+	if (bvhOptions.report) {
+		const BvhStats& st = bvh->stats();
+		std::cout << "BVH (" << path << "): " << st.triangles << " triangles, " << st.nodes << " nodes, "
+			<< st.leaves << " leaves, depth " << st.depth << ", "
+			<< double(st.nodeBytes) / double(std::max<size_t>(1, st.triangles)) << " node bytes/triangle, built in "
+			<< st.buildSeconds << " s";
+		if (st.lazySubtrees > 0) std::cout << " (" << st.lazySubtrees << " subtrees deferred)";
+		std::cout << "\n";
+	}
+	outObjects.push_back(bvh);
+	return true;
+}
@@ -2,27 +2,203 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <cstdint>
 #include "hittable.h"
 #include "triangle.h"
 #include "material.h"
 
+/// @brief 索引三角网格（OBJ解析结果，创建三角形图元之前的中间表示）
+struct MeshData {
+	/// @brief 顶点位置
+	std::vector<Vec3> positions;
+	/// @brief 三角形顶点索引，每3个一组
+	std::vector<std::uint32_t> indices;
+	/// @brief 每个三角形的材质ID
+	std::vector<MaterialId> faceMaterials;
+
+	/// @brief 三角形数量
+	size_t triangleCount() const { return faceMaterials.size(); }
+};
+
+/// @brief 点云（PLY 解析结果，SoA 存储；每个点渲染为一个球）
+struct PointCloudData {
+	/// @brief 点坐标
+	std::vector<float> x, y, z;
+	/// @brief 每点半径（为空表示文件未提供，使用统一半径）
+	std::vector<float> radius;
+	/// @brief 每点颜色，每3字节一组 RGB（为空表示使用材质反照率）
+	std::vector<std::uint8_t> rgb;
+
+	/// @brief 点数
+	size_t size() const { return x.size(); }
+};
+
+/// @brief 点云球集选项
+struct SphereSetOptions {
+	double pointRadius = 0.01;      // 文件无 radius 属性时的统一半径（PLY 文件单位，loadPLYSpheres 与逐点半径一同按 uniformScale 缩放）
+	int leafSize = 8;               // 叶节点球数上限
+	bool report = true;             // 输出内存与构建时间
+};
+
+/// @brief 加载后网格优化选项
+struct MeshOptimizeOptions {
+	bool weldVertices = true;       // 合并容差内的重复顶点
+	double weldTolerance = 1e-6;    // 焊接容差（场景单位，缩放平移之后；<= 0 只合并坐标完全相同的顶点）
+	bool removeDegenerate = true;   // 删除零面积三角形
+	double degenerateEpsilon = 1e-12; // 相对面积阈值：|e1 x e2| <= eps * 最长边^2 视为退化
+	bool removeDuplicates = true;   // 删除重复面（顶点集合相同，与绕序无关）
+	bool spatialSort = true;        // 按重心的 Morton 码重排三角形，提高缓存局部性
+	bool report = true;             // 输出优化统计
+};
+
+/// @brief 网格优化统计
+struct MeshOptimizeStats {
+	size_t verticesIn = 0;
+	size_t verticesOut = 0;
+	size_t trianglesIn = 0;
+	size_t trianglesOut = 0;
+	size_t degenerateRemoved = 0;
+	size_t duplicatesRemoved = 0;
+};
+
+/// @brief LOD链生成选项
+struct MeshLodOptions {
+	int maxLevels = 5;              // 最多层数（含原始网格 LOD0）
+	double reductionRatio = 0.25;   // 每级相对上一级保留的三角形比例
+	size_t minTriangles = 32;       // 低于此三角形数不再生成更粗的层级
+};
+
+/// @brief BVH 节点存储格式
+enum class BvhLayout {
+	Binary,          // 二叉节点，双精度包围盒（未压缩，56 字节/节点）
+	Wide4Quantized   // 4 叉节点，子包围盒相对父盒量化为 8 位，每节点一条 64 字节缓存行
+};
+
+/// @brief BVH 构建选项
+struct BvhOptions {
+	BvhLayout layout = BvhLayout::Wide4Quantized; // 节点格式
+	int leafSize = 4;               // 叶节点目标三角形数（SAH 仍可能提前成叶）
+	int sahBins = 12;               // SAH 分箱数
+	// Lazy build (4-wide layout only): only the top lazyDepth binary split levels are built
+	// upfront; each subtree below is built the first time a ray reaches it.
+	bool lazyBuild = false;         // 延迟构建：子树在首次被光线访问时才构建
+	int lazyDepth = 6;              // 预先构建的二叉划分层数（最多 2^lazyDepth 个延迟子树）
+	bool report = true;             // 输出节点内存与构建时间
+};
+
 namespace MeshLoader {
-	// Loads a .OBJ file with only 'v' and 'f' (triangles/convex polygons). Ignores UVs/normals.
-	// Applies uniform scale and translation after loading.
+	// Parses a .OBJ file into an indexed mesh (positions in file space, faces fan-triangulated).
+	// 'mtllib' files are parsed into 'materials' (resolved relative to the OBJ directory),
+	// and 'usemtl' switches the material ID of the following faces.
+	/// @brief 解析OBJ文件为索引网格
+	/// @param path OBJ文件路径
+	/// @param materials 场景材质表（mtllib 中的材质会追加到这里）
+	/// @param defaultMaterial 未指定 usemtl 或材质名未找到时使用的材质ID
+	/// @param outMesh 输出网格
+	/// @return 是否成功加载OBJ文件
+	bool loadOBJMesh(
+		const std::string& path,
+		MaterialTable& materials,
+		MaterialId defaultMaterial,
+		MeshData& outMesh);
+
+	/// @brief 对网格顶点应用统一缩放和平移
+	void transformMesh(MeshData& mesh, double uniformScale, const Vec3& translate);
+
+	// Optional post-load optimization: weld vertices, drop degenerate and duplicate faces,
+	// then reorder triangles along a Morton curve. Unused vertices are compacted away.
+	/// @brief 优化网格
+	/// @param mesh 待优化网格（原地修改）
+	/// @param options 优化选项
+	/// @return 优化统计
+	MeshOptimizeStats optimizeMesh(MeshData& mesh, const MeshOptimizeOptions& options);
+
+	// Quadric-error edge collapse (Garland-Heckbert). Open and material boundaries are
+	// constrained so silhouettes and material regions keep their shape.
+	/// @brief 简化网格到不超过 targetTriangles 个三角形
+	MeshData simplifyMesh(const MeshData& mesh, size_t targetTriangles);
+
+	/// @brief 生成LOD链：[0] 为原始网格，之后每级依次简化
+	std::vector<MeshData> buildLodChain(const MeshData& mesh, const MeshLodOptions& options);
+
+	/// @brief 为网格的每个三角形创建 Triangle 图元并追加到 outObjects
+	void appendTriangles(const MeshData& mesh, std::vector<std::shared_ptr<Hittable>>& outObjects);
+
+	// Loads a .OBJ file with 'v' and 'f' (triangles/convex polygons). Ignores UVs/normals.
+	// Applies uniform scale and translation after loading, then the optional optimization pass.
 	// Appends triangles to 'outObjects'.
 	/// @brief 加载OBJ文件并将其转换为可击中对象
 	/// @param path OBJ文件路径
 	/// @param uniformScale 统一缩放比例
 	/// @param translate 平移向量
-	/// @param material 材质
+	/// @param materials 场景材质表（mtllib 中的材质会追加到这里）
+	/// @param defaultMaterial 未指定 usemtl 或材质名未找到时使用的材质ID
 	/// @param outObjects 输出可击中对象列表
+	/// @param optimize 网格优化选项（nullptr 表示保持原样）
 	/// @return 是否成功加载OBJ文件
 	bool loadOBJ(
 		const std::string& path,
 		double uniformScale,
 		const Vec3& translate,
-		const Material& material,
-		std::vector<std::shared_ptr<Hittable>>& outObjects);
-}
+		MaterialTable& materials,
+		MaterialId defaultMaterial,
+		std::vector<std::shared_ptr<Hittable>>& outObjects,
+		const MeshOptimizeOptions* optimize = nullptr);
 
+	// Like loadOBJ, but appends a single LodMesh holding a chain of simplified levels.
+	// The renderer selects the level per frame from the mesh's projected screen size.
+	/// @brief 加载OBJ文件并生成LOD网格
+	/// @param lodOptions LOD链生成选项
+	/// @return 是否成功加载OBJ文件
+	bool loadOBJLod(
+		const std::string& path,
+		double uniformScale,
+		const Vec3& translate,
+		MaterialTable& materials,
+		MaterialId defaultMaterial,
+		std::vector<std::shared_ptr<Hittable>>& outObjects,
+		const MeshLodOptions& lodOptions,
+		const MeshOptimizeOptions* optimize = nullptr);
 
+	// Like loadOBJ, but appends a single BvhMesh: the triangles are kept inside one object
+	// behind a bounding volume hierarchy instead of being tested one by one by the renderer.
+	/// @brief 加载OBJ文件并构建 BVH 网格
+	/// @param bvhOptions BVH 构建选项
+	/// @return 是否成功加载OBJ文件
+	bool loadOBJBvh(
+		const std::string& path,
+		double uniformScale,
+		const Vec3& translate,
+		MaterialTable& materials,
+		MaterialId defaultMaterial,
+		std::vector<std::shared_ptr<Hittable>>& outObjects,
+		const BvhOptions& bvhOptions,
+		const MeshOptimizeOptions* optimize = nullptr);
+
+	// Reads the vertex element of a .PLY file (ascii, binary_little_endian or binary_big_endian).
+	// x/y/z are required; an optional 'radius' property and red/green/blue (or r/g/b,
+	// diffuse_red/...) colours are picked up when present, any other properties and elements are
+	// skipped. Colour stored as float is taken to be in [0, 1].
+	/// @brief 解析PLY点云
+	/// @param path PLY文件路径
+	/// @param outPoints 输出点云
+	/// @return 是否成功加载
+	bool loadPLYPoints(const std::string& path, PointCloudData& outPoints);
+
+	/// @brief 对点坐标应用统一缩放和平移（半径同时缩放）
+	void transformPoints(PointCloudData& points, double uniformScale, const Vec3& translate);
+
+	// Loads a .PLY point cloud and appends a single SphereSet: one sphere per point, stored as
+	// SoA arrays behind the set's own BVH, with per-point colour (when present) as the albedo.
+	/// @brief 加载PLY点云并生成球集
+	/// @param material 球集材质ID（有逐点颜色时只替换反照率）
+	/// @param options 球集选项（pointRadius 与坐标、逐点半径一样乘以 |uniformScale|）
+	/// @return 是否成功加载
+	bool loadPLYSpheres(
+		const std::string& path,
+		double uniformScale,
+		const Vec3& translate,
+		MaterialId material,
+		std::vector<std::shared_ptr<Hittable>>& outObjects,
+		const SphereSetOptions& options);
+}
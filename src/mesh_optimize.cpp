@@ -0,0 +1,215 @@
+#include "mesh_loader.h"
+#include "morton.h"
+#include <algorithm>
+#include <unordered_map>
+#include <array>
+#include <limits>
+#include <cmath>
+#include <cstring>
+
+namespace {
+	/// @brief 焊接网格单元坐标的哈希键
+	static inline std::uint64_t cellKey(std::int64_t x, std::int64_t y, std::int64_t z) {
+		const std::uint64_t mask = (1ull << 21) - 1;
+		return ((std::uint64_t(x) & mask) << 42) | ((std::uint64_t(y) & mask) << 21) | (std::uint64_t(z) & mask);
+	}
+
+	/// @brief 网格单元坐标：floor(v / cell) 钳到 int64 范围（过小的容差或过大的坐标不会溢出）
+	static inline std::int64_t cellCoord(double v, double cell) {
+		const double c = std::floor(v / cell);
+		// 2^62：留出相邻单元 ±1 的余量
+		const double limit = 4611686018427387904.0;
+		if (!(c > -limit)) return -(std::int64_t(1) << 62);
+		if (!(c < limit)) return std::int64_t(1) << 62;
+		return std::int64_t(c);
+	}
+
+	/// @brief 精确焊接的哈希键：坐标的位模式（-0 归一为 +0）
+	struct PositionBits {
+		std::uint64_t v[3];
+		bool operator==(const PositionBits& o) const { return v[0] == o.v[0] && v[1] == o.v[1] && v[2] == o.v[2]; }
+	};
+	struct PositionBitsHash {
+		size_t operator()(const PositionBits& k) const {
+			std::uint64_t h = k.v[0] * 0x9E3779B97F4A7C15ull;
+			h = (h ^ (h >> 29) ^ k.v[1]) * 0xBF58476D1CE4E5B9ull;
+			h = (h ^ (h >> 32) ^ k.v[2]) * 0x94D049BB133111EBull;
+			return size_t(h ^ (h >> 31));
+		}
+	};
+
+	static inline PositionBits positionBits(const Vec3& p) {
+		PositionBits k;
+		const double c[3] = { p.x + 0.0, p.y + 0.0, p.z + 0.0 };
+		std::memcpy(k.v, c, sizeof(k.v));
+		return k;
+	}
+
+	/// @brief 容差为 0 时只合并坐标完全相同的顶点
+	static std::vector<std::uint32_t> weldExact(std::vector<Vec3>& positions) {
+		std::vector<std::uint32_t> remap(positions.size());
+		std::vector<Vec3> welded;
+		welded.reserve(positions.size());
+		std::unordered_map<PositionBits, std::uint32_t, PositionBitsHash> seen;
+		seen.reserve(positions.size());
+		for (size_t i = 0; i < positions.size(); ++i) {
+			auto inserted = seen.emplace(positionBits(positions[i]), std::uint32_t(welded.size()));
+			if (inserted.second) welded.push_back(positions[i]);
+			remap[i] = inserted.first->second;
+		}
+		positions.swap(welded);
+		return remap;
+	}
+
+	/// @brief 在容差内合并重复顶点，返回 旧索引 -> 新索引 的映射
+	/// 顶点按容差大小的网格分桶，只需检查相邻的 27 个桶
+	static std::vector<std::uint32_t> weldPositions(std::vector<Vec3>& positions, double tolerance) {
+		if (!(tolerance > 0.0)) return weldExact(positions);
+
+		std::vector<std::uint32_t> remap(positions.size());
+		std::vector<Vec3> welded;
+		welded.reserve(positions.size());
+
+		const double cell = tolerance;
+		const double tol2 = tolerance * tolerance;
+		std::unordered_map<std::uint64_t, std::vector<std::uint32_t>> grid;
+		grid.reserve(positions.size());
+
+		for (size_t i = 0; i < positions.size(); ++i) {
+			const Vec3& p = positions[i];
+			std::int64_t cx = cellCoord(p.x, cell);
+			std::int64_t cy = cellCoord(p.y, cell);
+			std::int64_t cz = cellCoord(p.z, cell);
+
+			std::uint32_t found = std::numeric_limits<std::uint32_t>::max();
+			for (int dz = -1; dz <= 1 && found == std::numeric_limits<std::uint32_t>::max(); ++dz) {
+				for (int dy = -1; dy <= 1 && found == std::numeric_limits<std::uint32_t>::max(); ++dy) {
+					for (int dx = -1; dx <= 1; ++dx) {
+						auto it = grid.find(cellKey(cx + dx, cy + dy, cz + dz));
+						if (it == grid.end()) continue;
+						for (std::uint32_t cand : it->second) {
+							if ((welded[cand] - p).length_squared() <= tol2) { found = cand; break; }
+						}
+						if (found != std::numeric_limits<std::uint32_t>::max()) break;
+					}
+				}
+			}
+
+			if (found == std::numeric_limits<std::uint32_t>::max()) {
+				found = std::uint32_t(welded.size());
+				welded.push_back(p);
+				grid[cellKey(cx, cy, cz)].push_back(found);
+			}
+			remap[i] = found;
+		}
+
+		positions.swap(welded);
+		return remap;
+	}
+}
+
+MeshOptimizeStats MeshLoader::optimizeMesh(MeshData& mesh, const MeshOptimizeOptions& options) {
+	MeshOptimizeStats stats;
+	stats.verticesIn = mesh.positions.size();
+	stats.trianglesIn = mesh.triangleCount();
+
+	// 1. 顶点焊接
+	if (options.weldVertices && !mesh.positions.empty()) {
+		std::vector<std::uint32_t> remap = weldPositions(mesh.positions, options.weldTolerance);
+		for (std::uint32_t& idx : mesh.indices) idx = remap[idx];
+	}
+
+	// 2. 删除退化面与重复面
+	struct Face {
+		std::array<std::uint32_t, 3> v;     // 原始绕序
+		std::array<std::uint32_t, 3> key;   // 排序后的顶点集合（用于查重）
+		MaterialId material;
+		std::uint32_t mortonCode;
+	};
+	std::vector<Face> faces;
+	faces.reserve(mesh.triangleCount());
+	for (size_t f = 0; f < mesh.triangleCount(); ++f) {
+		Face face;
+		face.v = { mesh.indices[3 * f + 0], mesh.indices[3 * f + 1], mesh.indices[3 * f + 2] };
+		face.material = mesh.faceMaterials[f];
+		face.mortonCode = 0;
+
+		if (options.removeDegenerate) {
+			bool degenerate = face.v[0] == face.v[1] || face.v[1] == face.v[2] || face.v[0] == face.v[2];
+			if (!degenerate) {
+				const Vec3& a = mesh.positions[face.v[0]];
+				const Vec3& b = mesh.positions[face.v[1]];
+				const Vec3& c = mesh.positions[face.v[2]];
+				double crossLen = Vec3::cross(b - a, c - a).length();
+				double maxEdge2 = std::max((b - a).length_squared(), std::max((c - b).length_squared(), (a - c).length_squared()));
+				degenerate = crossLen <= options.degenerateEpsilon * maxEdge2;
+			}
+			if (degenerate) { ++stats.degenerateRemoved; continue; }
+		}
+
+		face.key = face.v;
+		std::sort(face.key.begin(), face.key.end());
+		faces.push_back(face);
+	}
+
+	if (options.removeDuplicates && !faces.empty()) {
+		// 按顶点集合稳定排序，相邻相同者只保留第一次出现的面
+		std::vector<std::uint32_t> order(faces.size());
+		for (size_t i = 0; i < order.size(); ++i) order[i] = std::uint32_t(i);
+		std::stable_sort(order.begin(), order.end(), [&faces](std::uint32_t a, std::uint32_t b) { return faces[a].key < faces[b].key; });
+		std::vector<char> keep(faces.size(), 1);
+		for (size_t i = 1; i < order.size(); ++i) {
+			if (faces[order[i]].key == faces[order[i - 1]].key) {
+				keep[order[i]] = 0;
+				++stats.duplicatesRemoved;
+			}
+		}
+		size_t out = 0;
+		for (size_t i = 0; i < faces.size(); ++i) {
+			if (keep[i]) faces[out++] = faces[i];
+		}
+		faces.resize(out);
+	}
+
+	// 3. 按重心的 Morton 码重排三角形
+	if (options.spatialSort && !faces.empty()) {
+		const double INF = std::numeric_limits<double>::infinity();
+		Vec3 lo(INF, INF, INF), hi(-INF, -INF, -INF);
+		for (const Vec3& p : mesh.positions) {
+			lo = Vec3(std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z));
+			hi = Vec3(std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z));
+		}
+		Vec3 extent = hi - lo;
+		auto inv = [](double e) { return e > 0.0 ? 1.0 / e : 0.0; };
+		Vec3 invExtent(inv(extent.x), inv(extent.y), inv(extent.z));
+		for (Face& face : faces) {
+			Vec3 c = (mesh.positions[face.v[0]] + mesh.positions[face.v[1]] + mesh.positions[face.v[2]]) / 3.0;
+			Vec3 n = Vec3::hadamard(c - lo, invExtent);
+			face.mortonCode = Morton::encode(n.x, n.y, n.z);
+		}
+		std::stable_sort(faces.begin(), faces.end(), [](const Face& a, const Face& b) { return a.mortonCode < b.mortonCode; });
+	}
+
+	// 4. 按新面序首次使用的顺序压缩顶点（同时丢弃未引用顶点）
+	const std::uint32_t unused = std::numeric_limits<std::uint32_t>::max();
+	std::vector<std::uint32_t> vertexRemap(mesh.positions.size(), unused);
+	std::vector<Vec3> positions;
+	positions.reserve(mesh.positions.size());
+	mesh.indices.clear();
+	mesh.faceMaterials.clear();
+	for (const Face& face : faces) {
+		for (std::uint32_t v : face.v) {
+			if (vertexRemap[v] == unused) {
+				vertexRemap[v] = std::uint32_t(positions.size());
+				positions.push_back(mesh.positions[v]);
+			}
+			mesh.indices.push_back(vertexRemap[v]);
+		}
+		mesh.faceMaterials.push_back(face.material);
+	}
+	mesh.positions.swap(positions);
+
+	stats.verticesOut = mesh.positions.size();
+	stats.trianglesOut = mesh.triangleCount();
+	return stats;
+}
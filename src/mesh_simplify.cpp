@@ -0,0 +1,285 @@
+#include "mesh_loader.h"
+#include <algorithm>
+#include <array>
+#include <queue>
+#include <limits>
+#include <cmath>
+
+namespace {
+	/// @brief 对称4x4误差二次型（只存上三角10个元素）
+	struct Quadric {
+		double a[10] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+		/// @brief 由平面 n·x + d = 0 构造，并乘以权重
+		static Quadric fromPlane(const Vec3& n, double d, double w) {
+			Quadric q;
+			q.a[0] = w * n.x * n.x; q.a[1] = w * n.x * n.y; q.a[2] = w * n.x * n.z; q.a[3] = w * n.x * d;
+			q.a[4] = w * n.y * n.y; q.a[5] = w * n.y * n.z; q.a[6] = w * n.y * d;
+			q.a[7] = w * n.z * n.z; q.a[8] = w * n.z * d;
+			q.a[9] = w * d * d;
+			return q;
+		}
+
+		Quadric& operator+=(const Quadric& o) {
+			for (int i = 0; i < 10; ++i) a[i] += o.a[i];
+			return *this;
+		}
+
+		/// @brief 计算 v^T Q v（点到平面集合的加权平方距离和）
+		double evaluate(const Vec3& v) const {
+			return a[0] * v.x * v.x + 2.0 * a[1] * v.x * v.y + 2.0 * a[2] * v.x * v.z + 2.0 * a[3] * v.x
+				+ a[4] * v.y * v.y + 2.0 * a[5] * v.y * v.z + 2.0 * a[6] * v.y
+				+ a[7] * v.z * v.z + 2.0 * a[8] * v.z
+				+ a[9];
+		}
+
+		/// @brief 求使误差最小的位置；矩阵接近奇异时返回 false
+		bool optimal(Vec3& out) const {
+			double m00 = a[0], m01 = a[1], m02 = a[2];
+			double m11 = a[4], m12 = a[5], m22 = a[7];
+			double c00 = m11 * m22 - m12 * m12;
+			double c01 = m02 * m12 - m01 * m22;
+			double c02 = m01 * m12 - m02 * m11;
+			double det = m00 * c00 + m01 * c01 + m02 * c02;
+			double scale = std::fabs(m00) + std::fabs(m11) + std::fabs(m22);
+			if (std::fabs(det) <= 1e-12 * scale * scale * scale) return false;
+			double c11 = m00 * m22 - m02 * m02;
+			double c12 = m01 * m02 - m00 * m12;
+			double c22 = m00 * m11 - m01 * m01;
+			double inv = 1.0 / det;
+			Vec3 b(-a[3], -a[6], -a[8]);
+			out = Vec3(c00 * b.x + c01 * b.y + c02 * b.z,
+				c01 * b.x + c11 * b.y + c12 * b.z,
+				c02 * b.x + c12 * b.y + c22 * b.z) * inv;
+			return true;
+		}
+	};
+
+	/// @brief 边折叠候选（小根堆元素）
+	struct Collapse {
+		double cost;
+		std::uint32_t a, b;          // 将 b 折叠到 a
+		std::uint32_t versionA, versionB;
+		Vec3 target;
+		bool operator>(const Collapse& o) const { return cost > o.cost; }
+	};
+
+	/// @brief 边折叠简化器：Garland-Heckbert 二次误差度量
+	class Simplifier {
+	public:
+		explicit Simplifier(const MeshData& mesh) : pos(mesh.positions), faceMat(mesh.faceMaterials) {
+			size_t nv = pos.size(), nf = mesh.triangleCount();
+			quadric.assign(nv, Quadric());
+			version.assign(nv, 0);
+			vertexRemoved.assign(nv, 0);
+			vertexFaces.assign(nv, {});
+			faces.resize(nf);
+			faceRemoved.assign(nf, 0);
+			activeFaces = nf;
+
+			for (size_t f = 0; f < nf; ++f) {
+				faces[f] = { mesh.indices[3 * f], mesh.indices[3 * f + 1], mesh.indices[3 * f + 2] };
+				for (std::uint32_t v : faces[f]) vertexFaces[v].push_back(std::uint32_t(f));
+
+				// 面平面二次型，按面积加权
+				Vec3 n = faceCross(faces[f]);
+				double area2 = n.length();
+				if (area2 <= 0.0) continue;
+				n = n / area2;
+				double d = -Vec3::dot(n, pos[faces[f][0]]);
+				Quadric q = Quadric::fromPlane(n, d, 0.5 * area2);
+				for (std::uint32_t v : faces[f]) quadric[v] += q;
+			}
+
+			addBoundaryConstraints();
+		}
+
+		/// @brief 折叠到三角形数不超过 targetTriangles（或无可折叠边）
+		void run(size_t targetTriangles) {
+			std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+			for (size_t f = 0; f < faces.size(); ++f) {
+				for (int k = 0; k < 3; ++k) {
+					std::uint32_t a = faces[f][k], b = faces[f][(k + 1) % 3];
+					if (a < b) heap.push(makeCollapse(a, b));
+					else if (!hasEdge(b, a, f)) heap.push(makeCollapse(a, b));
+				}
+			}
+
+			while (activeFaces > targetTriangles && !heap.empty()) {
+				Collapse c = heap.top();
+				heap.pop();
+				if (vertexRemoved[c.a] || vertexRemoved[c.b]) continue;
+				if (version[c.a] != c.versionA || version[c.b] != c.versionB) continue;
+				if (!apply(c)) continue;
+
+				// 重新计算 a 周围所有边的代价
+				std::vector<std::uint32_t> ring;
+				for (std::uint32_t f : vertexFaces[c.a]) {
+					for (std::uint32_t v : faces[f]) if (v != c.a) ring.push_back(v);
+				}
+				std::sort(ring.begin(), ring.end());
+				ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+				for (std::uint32_t v : ring) heap.push(makeCollapse(c.a, v));
+			}
+		}
+
+		/// @brief 输出压缩后的网格
+		MeshData result() const {
+			MeshData out;
+			const std::uint32_t unused = std::numeric_limits<std::uint32_t>::max();
+			std::vector<std::uint32_t> remap(pos.size(), unused);
+			for (size_t f = 0; f < faces.size(); ++f) {
+				if (faceRemoved[f]) continue;
+				for (std::uint32_t v : faces[f]) {
+					if (remap[v] == unused) {
+						remap[v] = std::uint32_t(out.positions.size());
+						out.positions.push_back(pos[v]);
+					}
+					out.indices.push_back(remap[v]);
+				}
+				out.faceMaterials.push_back(faceMat[f]);
+			}
+			return out;
+		}
+
+	private:
+		std::vector<Vec3> pos;
+		std::vector<MaterialId> faceMat;
+		std::vector<Quadric> quadric;
+		std::vector<std::uint32_t> version;
+		std::vector<char> vertexRemoved;
+		std::vector<std::vector<std::uint32_t>> vertexFaces;
+		std::vector<std::array<std::uint32_t, 3>> faces;
+		std::vector<char> faceRemoved;
+		size_t activeFaces = 0;
+
+		Vec3 faceCross(const std::array<std::uint32_t, 3>& f) const {
+			return Vec3::cross(pos[f[1]] - pos[f[0]], pos[f[2]] - pos[f[0]]);
+		}
+
+		/// @brief 检查另一个面 (除 skip 外) 是否已包含有向边 a->b，避免同一条边重复入堆
+		bool hasEdge(std::uint32_t a, std::uint32_t b, size_t skip) const {
+			for (std::uint32_t f : vertexFaces[a]) {
+				if (f == skip) continue;
+				for (int k = 0; k < 3; ++k) {
+					if (faces[f][k] == a && faces[f][(k + 1) % 3] == b) return true;
+				}
+			}
+			return false;
+		}
+
+		/// @brief 为开放边界和材质边界添加垂直约束平面，防止轮廓收缩
+		void addBoundaryConstraints() {
+			const double boundaryWeight = 100.0;
+			for (size_t f = 0; f < faces.size(); ++f) {
+				Vec3 n = faceCross(faces[f]).normalized();
+				if (n.length_squared() == 0.0) continue;
+				for (int k = 0; k < 3; ++k) {
+					std::uint32_t a = faces[f][k], b = faces[f][(k + 1) % 3];
+					// 统计共享此边的其他面，以及是否跨越材质边界
+					int shared = 0;
+					bool materialSeam = false;
+					for (std::uint32_t g : vertexFaces[a]) {
+						if (g == f) continue;
+						const auto& fg = faces[g];
+						if (fg[0] == b || fg[1] == b || fg[2] == b) {
+							++shared;
+							if (faceMat[g] != faceMat[f]) materialSeam = true;
+						}
+					}
+					if (shared > 0 && !materialSeam) continue;
+					Vec3 edge = pos[b] - pos[a];
+					Vec3 bn = Vec3::cross(edge, n).normalized();
+					if (bn.length_squared() == 0.0) continue;
+					double d = -Vec3::dot(bn, pos[a]);
+					Quadric q = Quadric::fromPlane(bn, d, boundaryWeight * edge.length_squared());
+					quadric[a] += q;
+					quadric[b] += q;
+				}
+			}
+		}
+
+		Collapse makeCollapse(std::uint32_t a, std::uint32_t b) const {
+			Quadric q = quadric[a];
+			q += quadric[b];
+			Vec3 target;
+			double cost;
+			if (q.optimal(target)) {
+				cost = q.evaluate(target);
+			}
+			else {
+				// 退化时在两端点和中点中取误差最小者
+				Vec3 candidates[3] = { pos[a], pos[b], (pos[a] + pos[b]) * 0.5 };
+				cost = std::numeric_limits<double>::infinity();
+				for (const Vec3& p : candidates) {
+					double e = q.evaluate(p);
+					if (e < cost) { cost = e; target = p; }
+				}
+			}
+			return Collapse{ std::max(0.0, cost), a, b, version[a], version[b], target };
+		}
+
+		/// @brief 折叠后若有面法线翻转则拒绝
+		bool flips(std::uint32_t moved, std::uint32_t other, const Vec3& target) const {
+			for (std::uint32_t f : vertexFaces[moved]) {
+				if (faceRemoved[f]) continue;
+				const auto& fv = faces[f];
+				if (fv[0] == other || fv[1] == other || fv[2] == other) continue; // 该面会被删除
+				Vec3 before = faceCross(fv);
+				Vec3 p[3] = { pos[fv[0]], pos[fv[1]], pos[fv[2]] };
+				for (int k = 0; k < 3; ++k) if (fv[k] == moved) p[k] = target;
+				Vec3 after = Vec3::cross(p[1] - p[0], p[2] - p[0]);
+				if (Vec3::dot(before, after) <= 0.0) return true;
+			}
+			return false;
+		}
+
+		bool apply(const Collapse& c) {
+			if (flips(c.a, c.b, c.target) || flips(c.b, c.a, c.target)) return false;
+
+			pos[c.a] = c.target;
+			quadric[c.a] += quadric[c.b];
+			vertexRemoved[c.b] = 1;
+			++version[c.a];
+
+			for (std::uint32_t f : vertexFaces[c.b]) {
+				if (faceRemoved[f]) continue;
+				auto& fv = faces[f];
+				if (fv[0] == c.a || fv[1] == c.a || fv[2] == c.a) {
+					faceRemoved[f] = 1;
+					--activeFaces;
+					continue;
+				}
+				for (std::uint32_t& v : fv) if (v == c.b) v = c.a;
+				vertexFaces[c.a].push_back(f);
+			}
+			vertexFaces[c.b].clear();
+
+			auto& list = vertexFaces[c.a];
+			list.erase(std::remove_if(list.begin(), list.end(), [this](std::uint32_t f) { return faceRemoved[f] != 0; }), list.end());
+			return true;
+		}
+	};
+}
+
+MeshData MeshLoader::simplifyMesh(const MeshData& mesh, size_t targetTriangles) {
+	if (mesh.triangleCount() <= targetTriangles) return mesh;
+	Simplifier simplifier(mesh);
+	simplifier.run(targetTriangles);
+	return simplifier.result();
+}
+
+std::vector<MeshData> MeshLoader::buildLodChain(const MeshData& mesh, const MeshLodOptions& options) {
+	std::vector<MeshData> chain;
+	chain.push_back(mesh);
+	for (int level = 1; level < options.maxLevels; ++level) {
+		const MeshData& prev = chain.back();
+		size_t target = size_t(double(prev.triangleCount()) * options.reductionRatio);
+		if (target < options.minTriangles) break;
+		// 每级在上一级基础上继续简化，误差逐级累积但构建成本更低
+		MeshData next = simplifyMesh(prev, target);
+		if (next.triangleCount() >= prev.triangleCount()) break;
+		chain.push_back(std::move(next));
+	}
+	return chain;
+}
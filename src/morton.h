@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+#include <algorithm>
+
+// 30-bit Morton codes (10 bits per axis), shared by the mesh optimizer's triangle sort, ray stream
+// coherence sorting and the SphereSet BVH build.
+namespace Morton {
+	/// @brief 将10位整数的位间隔展开（每位之间插入两个0）
+	inline std::uint32_t expandBits10(std::uint32_t v) {
+		v &= 0x3FFu;
+		v = (v | (v << 16)) & 0x030000FFu;
+		v = (v | (v << 8)) & 0x0300F00Fu;
+		v = (v | (v << 4)) & 0x030C30C3u;
+		v = (v | (v << 2)) & 0x09249249u;
+		return v;
+	}
+
+	/// @brief 30位 Morton 码，输入为 [0,1] 范围内的归一化坐标（超出部分截断）
+	inline std::uint32_t encode(double x, double y, double z) {
+		auto q = [](double t) {
+			t = std::max(0.0, std::min(1.0, t));
+			return std::uint32_t(std::min(1023.0, t * 1024.0));
+		};
+		return (expandBits10(q(x)) << 2) | (expandBits10(q(y)) << 1) | expandBits10(q(z));
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+
+namespace Parallel {
+	/// @brief 工作线程数（至少为1）
+	inline int threadCount() {
+		unsigned n = std::thread::hardware_concurrency();
+		return n == 0 ? 1 : int(n);
+	}
+
+	// Calls fn(i) for every i in [begin, end). Work is handed out in chunks of 'grain' indices
+	// through an atomic counter, so uneven rows or tiles balance across threads. Runs inline
+	// when there is a single thread or a single chunk.
+	/// @brief 并行 for 循环
+	/// @param begin 起始下标
+	/// @param end 结束下标（不含）
+	/// @param fn 回调 fn(int i)，会被多个线程并发调用
+	/// @param grain 每次领取的下标数
+	template <typename Fn>
+	void forEach(int begin, int end, Fn&& fn, int grain = 1) {
+		if (end <= begin) return;
+		grain = std::max(1, grain);
+		int chunks = (end - begin + grain - 1) / grain;
+		int threads = std::min(threadCount(), chunks);
+		if (threads <= 1) {
+			for (int i = begin; i < end; ++i) fn(i);
+			return;
+		}
+
+		std::atomic<int> next(begin);
+		auto worker = [&]() {
+			for (;;) {
+				int start = next.fetch_add(grain);
+				if (start >= end) break;
+				int stop = std::min(end, start + grain);
+				for (int i = start; i < stop; ++i) fn(i);
+			}
+		};
+		std::vector<std::thread> pool;
+		pool.reserve(threads - 1);
+		for (int t = 1; t < threads; ++t) pool.emplace_back(worker);
+		worker();
+		for (auto& th : pool) th.join();
+	}
+}
@@ -0,0 +1,342 @@
+#include "mesh_loader.h"
+#include "sphere_set.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+namespace {
+	/// @brief PLY 标量类型
+	enum class PlyType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64, Invalid };
+
+	/// @brief 点云属性的用途
+	enum PlyRole { RoleX, RoleY, RoleZ, RoleRadius, RoleRed, RoleGreen, RoleBlue, RoleCount, RoleNone = RoleCount };
+
+	/// @brief PLY 属性
+	struct PlyProperty {
+		std::string name;
+		PlyType type = PlyType::Invalid;
+		PlyType countType = PlyType::Invalid;  // 列表属性的长度类型
+		bool list = false;
+		size_t offset = 0;                     // 定长元素中相对元素起点的字节偏移
+	};
+
+	/// @brief PLY 元素
+	struct PlyElement {
+		std::string name;
+		size_t count = 0;
+		std::vector<PlyProperty> properties;
+		size_t stride = 0;                     // 定长元素的字节数
+		bool hasList = false;
+	};
+
+	static PlyType parseType(const std::string& s) {
+		if (s == "char" || s == "int8") return PlyType::Int8;
+		if (s == "uchar" || s == "uint8") return PlyType::UInt8;
+		if (s == "short" || s == "int16") return PlyType::Int16;
+		if (s == "ushort" || s == "uint16") return PlyType::UInt16;
+		if (s == "int" || s == "int32") return PlyType::Int32;
+		if (s == "uint" || s == "uint32") return PlyType::UInt32;
+		if (s == "float" || s == "float32") return PlyType::Float32;
+		if (s == "double" || s == "float64") return PlyType::Float64;
+		return PlyType::Invalid;
+	}
+
+	static size_t sizeOf(PlyType t) {
+		switch (t) {
+		case PlyType::Int8: case PlyType::UInt8: return 1;
+		case PlyType::Int16: case PlyType::UInt16: return 2;
+		case PlyType::Int32: case PlyType::UInt32: case PlyType::Float32: return 4;
+		case PlyType::Float64: return 8;
+		default: return 0;
+		}
+	}
+
+	static PlyRole roleOf(const std::string& name) {
+		if (name == "x") return RoleX;
+		if (name == "y") return RoleY;
+		if (name == "z") return RoleZ;
+		if (name == "radius") return RoleRadius;
+		if (name == "red" || name == "r" || name == "diffuse_red") return RoleRed;
+		if (name == "green" || name == "g" || name == "diffuse_green") return RoleGreen;
+		if (name == "blue" || name == "b" || name == "diffuse_blue") return RoleBlue;
+		return RoleNone;
+	}
+
+	/// @brief 读取一个二进制标量（swap 为 true 时先翻转字节序）
+	static double decode(const unsigned char* p, PlyType t, bool swap) {
+		unsigned char b[8];
+		const size_t n = sizeOf(t);
+		if (swap) {
+			for (size_t i = 0; i < n; ++i) b[i] = p[n - 1 - i];
+		}
+		else {
+			std::memcpy(b, p, n);
+		}
+		switch (t) {
+		case PlyType::Int8: { std::int8_t v; std::memcpy(&v, b, 1); return v; }
+		case PlyType::UInt8: return b[0];
+		case PlyType::Int16: { std::int16_t v; std::memcpy(&v, b, 2); return v; }
+		case PlyType::UInt16: { std::uint16_t v; std::memcpy(&v, b, 2); return v; }
+		case PlyType::Int32: { std::int32_t v; std::memcpy(&v, b, 4); return v; }
+		case PlyType::UInt32: { std::uint32_t v; std::memcpy(&v, b, 4); return v; }
+		case PlyType::Float32: { float v; std::memcpy(&v, b, 4); return v; }
+		case PlyType::Float64: { double v; std::memcpy(&v, b, 8); return v; }
+		default: return 0.0;
+		}
+	}
+
+	/// @brief 颜色分量转 8 位：浮点视为 [0,1]，16 位整数取高 8 位
+	static std::uint8_t colorByte(double v, PlyType t) {
+		if (t == PlyType::Float32 || t == PlyType::Float64) v = v * 255.0 + 0.5;
+		else if (t == PlyType::UInt16 || t == PlyType::Int16) v = v / 257.0 + 0.5;
+		return std::uint8_t(std::max(0.0, std::min(255.0, v)));
+	}
+
+	/// @brief 跳过二进制元素（含列表属性时逐条读取长度）
+	static bool skipBinaryElement(std::istream& in, const PlyElement& element, bool swap) {
+		if (!element.hasList) {
+			in.seekg(std::streamoff(element.stride * element.count), std::ios::cur);
+			return bool(in);
+		}
+		unsigned char buf[8];
+		for (size_t i = 0; i < element.count; ++i) {
+			for (const PlyProperty& prop : element.properties) {
+				if (!prop.list) {
+					in.ignore(std::streamsize(sizeOf(prop.type)));
+					continue;
+				}
+				if (!in.read(reinterpret_cast<char*>(buf), std::streamsize(sizeOf(prop.countType)))) return false;
+				const double n = decode(buf, prop.countType, swap);
+				in.ignore(std::streamsize(n * double(sizeOf(prop.type))));
+			}
+		}
+		return bool(in);
+	}
+}
+
+bool MeshLoader::loadPLYPoints(const std::string& path, PointCloudData& outPoints) {
+	std::ifstream in(path, std::ios::binary);
+	if (!in.is_open()) {
+		std::cerr << "Failed to open PLY: " << path << "\n";
+		return false;
+	}
+	outPoints = PointCloudData();
+
+	// Header: ASCII lines up to 'end_header'
+	std::string line;
+	if (!std::getline(in, line) || line.compare(0, 3, "ply") != 0) {
+		std::cerr << "Not a PLY file: " << path << "\n";
+		return false;
+	}
+	enum { Ascii, BinaryLE, BinaryBE } format = Ascii;
+	std::vector<PlyElement> elements;
+	bool headerDone = false;
+	while (std::getline(in, line)) {
+		if (!line.empty() && line.back() == '\r') line.pop_back();
+		std::istringstream ss(line);
+		std::string keyword;
+		ss >> keyword;
+		if (keyword == "format") {
+			std::string f;
+			ss >> f;
+			if (f == "ascii") format = Ascii;
+			else if (f == "binary_little_endian") format = BinaryLE;
+			else if (f == "binary_big_endian") format = BinaryBE;
+			else {
+				std::cerr << "PLY: unknown format '" << f << "' in " << path << "\n";
+				return false;
+			}
+		}
+		else if (keyword == "element") {
+			PlyElement e;
+			ss >> e.name >> e.count;
+			elements.push_back(e);
+		}
+		else if (keyword == "property") {
+			if (elements.empty()) {
+				std::cerr << "PLY: property before any element in " << path << "\n";
+				return false;
+			}
+			PlyProperty p;
+			std::string t;
+			ss >> t;
+			if (t == "list") {
+				std::string countType, itemType;
+				ss >> countType >> itemType >> p.name;
+				p.list = true;
+				p.countType = parseType(countType);
+				p.type = parseType(itemType);
+			}
+			else {
+				p.type = parseType(t);
+				ss >> p.name;
+			}
+			if (p.type == PlyType::Invalid || (p.list && p.countType == PlyType::Invalid)) {
+				std::cerr << "PLY: unsupported property '" << line << "' in " << path << "\n";
+				return false;
+			}
+			PlyElement& e = elements.back();
+			p.offset = e.stride;
+			e.stride += p.list ? 0 : sizeOf(p.type);
+			e.hasList = e.hasList || p.list;
+			e.properties.push_back(p);
+		}
+		else if (keyword == "end_header") {
+			headerDone = true;
+			break;
+		}
+		// comment / obj_info 忽略
+	}
+	if (!headerDone) {
+		std::cerr << "PLY: missing end_header in " << path << "\n";
+		return false;
+	}
+
+	size_t vertexElement = elements.size();
+	for (size_t i = 0; i < elements.size(); ++i) {
+		if (elements[i].name == "vertex") { vertexElement = i; break; }
+	}
+	if (vertexElement == elements.size()) {
+		std::cerr << "PLY: no vertex element in " << path << "\n";
+		return false;
+	}
+	const PlyElement& vertex = elements[vertexElement];
+	const PlyProperty* roles[RoleCount] = {};
+	for (const PlyProperty& p : vertex.properties) {
+		PlyRole role = roleOf(p.name);
+		if (role != RoleNone && !p.list) roles[role] = &p;
+	}
+	if (!roles[RoleX] || !roles[RoleY] || !roles[RoleZ]) {
+		std::cerr << "PLY: vertex element needs x, y and z in " << path << "\n";
+		return false;
+	}
+	if (vertex.count >= 0xFFFFFFFFu) {
+		std::cerr << "PLY: too many vertices in " << path << "\n";
+		return false;
+	}
+	const bool hasRadius = roles[RoleRadius] != nullptr;
+	const bool hasColor = roles[RoleRed] && roles[RoleGreen] && roles[RoleBlue];
+	const size_t n = vertex.count;
+	outPoints.x.resize(n);
+	outPoints.y.resize(n);
+	outPoints.z.resize(n);
+	if (hasRadius) outPoints.radius.resize(n);
+	if (hasColor) outPoints.rgb.resize(3 * n);
+
+	if (format == Ascii) {
+		// 跳过顶点之前的元素（每条一行）
+		for (size_t e = 0; e < vertexElement; ++e) {
+			for (size_t i = 0; i < elements[e].count; ++i) std::getline(in, line);
+		}
+		std::vector<double> values;
+		for (size_t i = 0; i < n; ++i) {
+			if (!std::getline(in, line)) {
+				std::cerr << "PLY: unexpected end of file at vertex " << i << " in " << path << "\n";
+				return false;
+			}
+			values.clear();
+			const char* s = line.c_str();
+			char* endp = nullptr;
+			for (const PlyProperty& p : vertex.properties) {
+				double v = std::strtod(s, &endp);
+				s = endp;
+				if (p.list) {
+					for (int k = 0; k < int(v); ++k) { std::strtod(s, &endp); s = endp; }
+					v = 0.0;
+				}
+				values.push_back(v);
+			}
+			auto value = [&](PlyRole role) { return values[size_t(roles[role] - vertex.properties.data())]; };
+			outPoints.x[i] = float(value(RoleX));
+			outPoints.y[i] = float(value(RoleY));
+			outPoints.z[i] = float(value(RoleZ));
+			if (hasRadius) outPoints.radius[i] = float(value(RoleRadius));
+			if (hasColor) {
+				outPoints.rgb[3 * i + 0] = colorByte(value(RoleRed), roles[RoleRed]->type);
+				outPoints.rgb[3 * i + 1] = colorByte(value(RoleGreen), roles[RoleGreen]->type);
+				outPoints.rgb[3 * i + 2] = colorByte(value(RoleBlue), roles[RoleBlue]->type);
+			}
+		}
+		return true;
+	}
+
+	const std::uint16_t one = 1;
+	const bool hostLittle = *reinterpret_cast<const unsigned char*>(&one) == 1;
+	const bool swap = (format == BinaryLE) != hostLittle;
+	for (size_t e = 0; e < vertexElement; ++e) {
+		if (!skipBinaryElement(in, elements[e], swap)) {
+			std::cerr << "PLY: unexpected end of file in element '" << elements[e].name << "' of " << path << "\n";
+			return false;
+		}
+	}
+	if (vertex.hasList) {
+		std::cerr << "PLY: list properties on vertices are not supported in binary files (" << path << ")\n";
+		return false;
+	}
+
+	// 定长顶点按块读取后逐属性解码
+	const size_t chunk = 1 << 16;
+	std::vector<unsigned char> buffer(chunk * vertex.stride);
+	for (size_t first = 0; first < n; first += chunk) {
+		const size_t count = std::min(chunk, n - first);
+		if (!in.read(reinterpret_cast<char*>(buffer.data()), std::streamsize(count * vertex.stride))) {
+			std::cerr << "PLY: unexpected end of file at vertex " << first << " in " << path << "\n";
+			return false;
+		}
+		for (size_t k = 0; k < count; ++k) {
+			const unsigned char* v = buffer.data() + k * vertex.stride;
+			const size_t i = first + k;
+			outPoints.x[i] = float(decode(v + roles[RoleX]->offset, roles[RoleX]->type, swap));
+			outPoints.y[i] = float(decode(v + roles[RoleY]->offset, roles[RoleY]->type, swap));
+			outPoints.z[i] = float(decode(v + roles[RoleZ]->offset, roles[RoleZ]->type, swap));
+			if (hasRadius) outPoints.radius[i] = float(decode(v + roles[RoleRadius]->offset, roles[RoleRadius]->type, swap));
+			if (hasColor) {
+				for (int c = 0; c < 3; ++c) {
+					const PlyProperty* p = roles[RoleRed + c];
+					outPoints.rgb[3 * i + c] = colorByte(decode(v + p->offset, p->type, swap), p->type);
+				}
+			}
+		}
+	}
+	return true;
+}
+
+void MeshLoader::transformPoints(PointCloudData& points, double uniformScale, const Vec3& translate) {
+	for (size_t i = 0; i < points.size(); ++i) {
+		points.x[i] = float(points.x[i] * uniformScale + translate.x);
+		points.y[i] = float(points.y[i] * uniformScale + translate.y);
+		points.z[i] = float(points.z[i] * uniformScale + translate.z);
+	}
+	for (float& r : points.radius) r = float(r * std::abs(uniformScale));
+}
+
+bool MeshLoader::loadPLYSpheres(
+	const std::string& path,
+	double uniformScale,
+	const Vec3& translate,
+	MaterialId material,
+	std::vector<std::shared_ptr<Hittable>>& outObjects,
+	const SphereSetOptions& options) {
+
+	PointCloudData points;
+	if (!loadPLYPoints(path, points)) return false;
+	transformPoints(points, uniformScale, translate);
+	// 统一半径与文件中的逐点半径同为文件单位，一起缩放
+	SphereSetOptions scaled = options;
+	scaled.pointRadius *= std::abs(uniformScale);
+
+	auto set = std::make_shared<SphereSet>(std::move(points), material, scaled);
+	if (options.report) {
+		const SphereSetStats& st = set->stats();
+		std::cout << "Point cloud (" << path << "): " << st.spheres << " spheres, "
+			<< double(st.pointBytes) / (1024.0 * 1024.0) << " MB points + "
+			<< double(st.nodeBytes) / (1024.0 * 1024.0) << " MB nodes (" << st.nodes << " nodes, depth " << st.depth
+			<< "), built in " << st.buildSeconds << " s\n";
+	}
+	outObjects.push_back(set);
+	return true;
+}
@@ -1,98 +1,391 @@
 #include "postprocess.h"
 #include <cmath>
 #include <limits>
+#include <cstdint>
+#include "parallel.h"
 
-void Postprocess::applyDepthEdgeOutline(std::vector<Vec3>& colors,
-	const std::vector<double>& depths,
-	int width, int height,
-	double threshold,
-	const Vec3& outlineColor) {
-	
-	// 如果颜色或深度缓冲区大小不匹配，直接返回
-	if ((int)colors.size() != width * height || (int)depths.size() != width * height) return;
+bool Postprocess::DepthSobelEdge::apply(const PixelContext& ctx, Vec3& color) const {
+	// Sobel needs a full 3x3 neighbourhood; the outermost ring is left untouched
+	if (ctx.onBorder()) return false;
 
-	const double INF = std::numeric_limits<double>::infinity();
+	// Skip if current pixel is background
+	if (std::isinf(ctx.depth())) return false;
 
-	// Lambda函数：根据(x,y)坐标计算一维数组索引
-	/// @param x 像素x坐标
-	/// @param y 像素y坐标
-	/// @return 对应于(x,y)的一维数组索引
-	auto idx = [width](int x, int y) { return y * width + x; };
+	// Sobel operator kernels for edge detection
+	// Gx: [-1  0  1]    Gy: [-1 -2 -1]
+	//     [-2  0  2]        [ 0  0  0]
+	//     [-1  0  1]        [ 1  2  1]
 
-	// 标记边缘像素的数组
-	std::vector<char> isEdge(width * height, 0);
+	// Helper function to get depth value (treat INF as 0 for gradient calculation)
+	auto getDepth = [&ctx](int dx, int dy) -> double {
+		double val = ctx.depth(dx, dy);
+		return std::isinf(val) ? 0.0 : val;
+	};
 
-	// Sobel operator kernels for edge detection
-	// Gx (horizontal gradient):
-	// [-1  0  1]
-	// [-2  0  2]
-	// [-1  0  1]
-	// Gy (vertical gradient):
-	// [-1 -2 -1]
-	// [ 0  0  0]
-	// [ 1  2  1]
-
-	for (int y = 1; y < height - 1; ++y) {
-		for (int x = 1; x < width - 1; ++x) {
-			int i = idx(x, y);
-			double d = depths[i];
-			
-			// Skip if current pixel is background
-			if (std::isinf(d)) continue;
-
-			// Apply Sobel operator
-			// Sobel kernels:
-			// Gx: [-1  0  1]    Gy: [-1 -2 -1]
-			//     [-2  0  2]        [ 0  0  0]
-			//     [-1  0  1]        [ 1  2  1]
-			
-			double gx = 0.0, gy = 0.0;
-			
-			// Helper function to get depth value (treat INF as 0 for gradient calculation)
-			auto getDepth = [&depths, &idx, INF](int px, int py) -> double {
-				double val = depths[idx(px, py)];
-				return std::isinf(val) ? 0.0 : val;
-			};
-
-			// Calculate Sobel Gx (horizontal gradient)
-			gx = -1.0 * getDepth(x-1, y-1) +  1.0 * getDepth(x+1, y-1)
-			   + -2.0 * getDepth(x-1, y)   +  2.0 * getDepth(x+1, y)
-			   + -1.0 * getDepth(x-1, y+1) +  1.0 * getDepth(x+1, y+1);
-
-			// Calculate Sobel Gy (vertical gradient)
-			gy = -1.0 * getDepth(x-1, y-1) + -2.0 * getDepth(x, y-1) + -1.0 * getDepth(x+1, y-1)
-			   +  1.0 * getDepth(x-1, y+1) +  2.0 * getDepth(x, y+1) +  1.0 * getDepth(x+1, y+1);
-
-			// Calculate gradient magnitude
-			double gradientMagnitude = std::sqrt(gx * gx + gy * gy);
-
-			// Check for background edges (if any neighbor is background)
-			bool backgroundEdge = false;
-			for (int oy = -1; oy <= 1; ++oy) {
-				for (int ox = -1; ox <= 1; ++ox) {
-					if (ox == 0 && oy == 0) continue;
-					double dn = depths[idx(x + ox, y + oy)];
-					if (std::isinf(dn)) {
-						backgroundEdge = true;
-						break;
+	// Calculate Sobel Gx (horizontal gradient)
+	double gx = -1.0 * getDepth(-1, -1) +  1.0 * getDepth(1, -1)
+	          + -2.0 * getDepth(-1, 0)  +  2.0 * getDepth(1, 0)
+	          + -1.0 * getDepth(-1, 1)  +  1.0 * getDepth(1, 1);
+
+	// Calculate Sobel Gy (vertical gradient)
+	double gy = -1.0 * getDepth(-1, -1) + -2.0 * getDepth(0, -1) + -1.0 * getDepth(1, -1)
+	          +  1.0 * getDepth(-1, 1)  +  2.0 * getDepth(0, 1)  +  1.0 * getDepth(1, 1);
+
+	// Calculate gradient magnitude
+	double gradientMagnitude = std::sqrt(gx * gx + gy * gy);
+
+	// Check for background edges (if any neighbor is background)
+	bool backgroundEdge = false;
+	for (int oy = -1; oy <= 1 && !backgroundEdge; ++oy) {
+		for (int ox = -1; ox <= 1; ++ox) {
+			if (ox == 0 && oy == 0) continue;
+			if (std::isinf(ctx.depth(ox, oy))) {
+				backgroundEdge = true;
+				break;
+			}
+		}
+	}
+
+	// Mark as edge if gradient magnitude exceeds threshold or is a background edge
+	if (gradientMagnitude > threshold || backgroundEdge) {
+		color = outlineColor;
+		return true;
+	}
+	return false;
+}
+
+Postprocess::NormalEdge::NormalEdge(double angleDegrees, const Vec3& outlineColor)
+	: cosThreshold(std::cos(angleDegrees * 3.14159265358979323846 / 180.0)), outlineColor(outlineColor) {}
+
+bool Postprocess::NormalEdge::apply(const PixelContext& ctx, Vec3& color) const {
+	if (std::isinf(ctx.depth())) return false;
+	const Vec3& n = ctx.normal();
+	static const int offsets[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+	for (const auto& o : offsets) {
+		// 与背景的交界由深度描边负责
+		if (std::isinf(ctx.depth(o[0], o[1]))) continue;
+		if (Vec3::dot(n, ctx.normal(o[0], o[1])) < cosThreshold) {
+			color = outlineColor;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Postprocess::IdEdge::apply(const PixelContext& ctx, Vec3& color) const {
+	auto id = [this, &ctx](int dx, int dy) {
+		return channel == Channel::Object ? ctx.objectId(dx, dy) : ctx.materialId(dx, dy);
+	};
+	std::uint32_t self = id(0, 0);
+	if (self == GBuffer::kNoId) return false;
+	double d = ctx.depth();
+	static const int offsets[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+	for (const auto& o : offsets) {
+		std::uint32_t other = id(o[0], o[1]);
+		if (other == GBuffer::kNoId || other == self) continue;
+		// 只在较近（或等深）的一侧描边，保持单像素线宽
+		if (d <= ctx.depth(o[0], o[1])) {
+			color = outlineColor;
+			return true;
+		}
+	}
+	return false;
+}
+
+void Postprocess::Pipeline::run(GBuffer& buffer) const {
+	run(buffer, PixelRect(0, 0, buffer.width, buffer.height));
+}
+
+void Postprocess::Pipeline::run(GBuffer& buffer, const PixelRect& rect) const {
+	const int width = buffer.width;
+	const int height = buffer.height;
+	if (filters.empty() || width <= 0 || height <= 0) return;
+	if ((int)buffer.color.size() != width * height || (int)buffer.depth.size() != width * height) return;
+	const PixelRect r = rect.intersect(PixelRect(0, 0, width, height));
+	if (r.empty()) return;
+
+	const bool markOutline = (int)buffer.outline.size() == width * height;
+	const int strip = std::max(1, tileWidth);
+	// 滚动行窗口：3 行 x (条带宽 + 左右各1列) 的原始颜色
+	std::vector<Vec3> window(3 * size_t(strip + 2));
+
+	// 条带左侧的外扩列属于前一条带，扫描前先保存其原始颜色
+	const int haloY0 = std::max(0, r.y0 - 1), haloY1 = std::min(height - 1, r.y1);
+	const size_t haloRows = size_t(haloY1 - haloY0 + 1);
+	const int strips = (r.width() + strip - 1) / strip;
+	std::vector<Vec3> leftHalo(size_t(strips) * haloRows);
+	for (int k = 1; k < strips; ++k) {
+		const int hx = r.x0 + k * strip - 1;
+		for (int y = haloY0; y <= haloY1; ++y) leftHalo[size_t(k) * haloRows + (y - haloY0)] = buffer.color[size_t(y) * width + hx];
+	}
+
+	for (int sx0 = r.x0; sx0 < r.x1; sx0 += strip) {
+		const int sx1 = std::min(r.x1, sx0 + strip);
+		const int wx0 = std::max(0, sx0 - 1);
+		const int wx1 = std::min(width, sx1 + 1);
+		const int ww = wx1 - wx0;
+
+		Vec3* slot[3] = { &window[0], &window[size_t(strip + 2)], &window[2 * size_t(strip + 2)] };
+		const int k = (sx0 - r.x0) / strip;
+		auto loadRow = [&](Vec3* dst, int y) {
+			y = std::max(0, std::min(height - 1, y));
+			const Vec3* src = &buffer.color[size_t(y) * width + wx0];
+			std::copy(src, src + ww, dst);
+			if (k > 0) dst[0] = leftHalo[size_t(k) * haloRows + (y - haloY0)];
+		};
+		loadRow(slot[0], r.y0 - 1);
+		loadRow(slot[1], r.y0);
+
+		for (int y = r.y0; y < r.y1; ++y) {
+			// 载入下一行（仍为原始颜色），之后才写回当前行
+			loadRow(slot[2], y + 1);
+			const Vec3* rows[3] = { slot[0], slot[1], slot[2] };
+			for (int x = sx0; x < sx1; ++x) {
+				PixelContext ctx(buffer, rows, wx0, x, y);
+				Vec3 c = ctx.color();
+				bool edge = false;
+				for (const auto& f : filters) edge |= f->apply(ctx, c);
+				buffer.color[size_t(y) * width + x] = c;
+				if (edge && markOutline) buffer.outline[size_t(y) * width + x] = 1;
+			}
+			// 窗口下移一行
+			Vec3* oldest = slot[0];
+			slot[0] = slot[1];
+			slot[1] = slot[2];
+			slot[2] = oldest;
+		}
+	}
+}
+
+void Postprocess::thickenOutlines(GBuffer& buffer, double width) {
+	const int w = buffer.width;
+	const int h = buffer.height;
+	const size_t n = size_t(w) * size_t(h);
+	if (width <= 1.0 || w <= 0 || h <= 0 || buffer.outline.size() != n || buffer.color.size() != n) return;
+
+	// 线宽 W 对应的膨胀半径：单像素线向两侧各扩 (W-1)/2
+	const double radius = 0.5 * (width - 1.0);
+	const double radius2 = radius * radius;
+
+	// nearest[i] = 最近描边种子像素的下标，-1 表示尚未找到
+	std::vector<std::int32_t> nearest(n, -1), next(n, -1);
+	bool anySeed = false;
+	for (size_t i = 0; i < n; ++i) {
+		if (buffer.outline[i]) { nearest[i] = std::int32_t(i); anySeed = true; }
+	}
+	if (!anySeed) return;
+
+	auto dist2 = [w](int x, int y, std::int32_t seed) {
+		double dx = double(x - seed % w), dy = double(y - seed / w);
+		return dx * dx + dy * dy;
+	};
+
+	// 步长序列 K, K/2, ..., 1, 1（末尾额外一步 1 修正 JFA 的少量误差）
+	int step = 1;
+	while (step < int(std::ceil(radius))) step *= 2;
+	std::vector<int> steps;
+	for (int k = step; k >= 1; k /= 2) steps.push_back(k);
+	steps.push_back(1);
+
+	for (int k : steps) {
+		for (int y = 0; y < h; ++y) {
+			for (int x = 0; x < w; ++x) {
+				std::int32_t best = nearest[size_t(y) * w + x];
+				double bestD = best >= 0 ? dist2(x, y, best) : std::numeric_limits<double>::infinity();
+				for (int oy = -k; oy <= k; oy += k) {
+					int ny = y + oy;
+					if (ny < 0 || ny >= h) continue;
+					for (int ox = -k; ox <= k; ox += k) {
+						int nx = x + ox;
+						if (nx < 0 || nx >= w || (ox == 0 && oy == 0)) continue;
+						std::int32_t cand = nearest[size_t(ny) * w + nx];
+						if (cand < 0) continue;
+						double d = dist2(x, y, cand);
+						if (d < bestD) { bestD = d; best = cand; }
 					}
 				}
-				if (backgroundEdge) break;
+				next[size_t(y) * w + x] = best;
 			}
+		}
+		nearest.swap(next);
+	}
 
-			// Mark as edge if gradient magnitude exceeds threshold or is a background edge
-			// For Sobel, we use a higher threshold to get thinner edges
-			if (gradientMagnitude > threshold || backgroundEdge) {
-				isEdge[i] = 1;
+	// 距最近种子不超过半径的像素涂成该种子的描边颜色（种子本身不会被改写）
+	for (int y = 0; y < h; ++y) {
+		for (int x = 0; x < w; ++x) {
+			size_t i = size_t(y) * w + x;
+			std::int32_t seed = nearest[i];
+			if (seed < 0 || buffer.outline[i]) continue;
+			if (dist2(x, y, seed) <= radius2) {
+				buffer.color[i] = buffer.color[seed];
+				buffer.outline[i] = 1;
 			}
 		}
 	}
+}
+
+namespace {
+	/// @brief 像素中心的相机光线（与渲染器的主光线一致）
+	static Ray pixelRay(const Camera& camera, int x, int y, int width, int height) {
+		double u = (double(x) + 0.5) / double(width);
+		double v = (double(y) + 0.5) / double(height);
+		return camera.get_ray(u, 1.0 - v);
+	}
 
-	for (int i = 0; i < width * height; ++i) {
-		if (isEdge[i]) {
-			colors[i] = outlineColor;
+	/// @brief 整数哈希，用于逐像素旋转采样核
+	static inline std::uint32_t hashPixel(std::uint32_t x, std::uint32_t y) {
+		std::uint32_t h = x * 0x8da6b343u ^ y * 0xd8163841u;
+		h ^= h >> 13;
+		h *= 0x5bd1e995u;
+		h ^= h >> 15;
+		return h;
+	}
+}
+
+void Postprocess::computeSSAO(const GBuffer& buffer, const Camera& camera, const SSAOParams& params, std::vector<double>& occlusion) {
+	const int w = buffer.width;
+	const int h = buffer.height;
+	const size_t n = size_t(w) * size_t(h);
+	occlusion.assign(n, 0.0);
+	if (w <= 0 || h <= 0 || buffer.depth.size() != n || buffer.normal.size() != n) return;
+
+	// 半球采样核（z 轴朝上），越靠近中心的样本越密
+	const int samples = std::max(1, params.samples);
+	std::vector<Vec3> kernel;
+	kernel.reserve(samples);
+	std::uint32_t seed = 0x12345678u;
+	auto rnd = [&seed]() {
+		seed = seed * 1664525u + 1013904223u;
+		return double(seed >> 8) / double(1u << 24);
+	};
+	while ((int)kernel.size() < samples) {
+		Vec3 k(rnd() * 2.0 - 1.0, rnd() * 2.0 - 1.0, rnd());
+		double len2 = k.length_squared();
+		if (len2 > 1.0 || len2 < 1e-6) continue;
+		double scale = double(kernel.size()) / double(samples);
+		scale = 0.1 + 0.9 * scale * scale;
+		kernel.push_back(k.normalized() * (scale * rnd()));
+	}
+
+	// 1. 原始遮蔽率（逐行并行）
+	std::vector<double> raw(n, 0.0);
+	Parallel::forEach(0, h, [&](int y) {
+		for (int x = 0; x < w; ++x) {
+			size_t i = size_t(y) * w + x;
+			double t = buffer.depth[i];
+			if (std::isinf(t)) continue;
+			Ray r = pixelRay(camera, x, y, w, h);
+			Vec3 P = r.at(t);
+			Vec3 N = buffer.normal[i];
+
+			// 以逐像素随机切线构建 TBN，使相邻像素的采样方向不同（噪声由双边模糊消除）
+			std::uint32_t hsh = hashPixel(std::uint32_t(x), std::uint32_t(y));
+			double angle = double(hsh & 0xFFFFu) / 65536.0 * 6.283185307179586;
+			Vec3 helper = std::fabs(N.x) < 0.9 ? Vec3(1, 0, 0) : Vec3(0, 1, 0);
+			Vec3 T0 = Vec3::cross(helper, N).normalized();
+			Vec3 B0 = Vec3::cross(N, T0);
+			Vec3 T = T0 * std::cos(angle) + B0 * std::sin(angle);
+			Vec3 B = Vec3::cross(N, T);
+
+			double occluded = 0.0;
+			for (const Vec3& k : kernel) {
+				Vec3 S = P + (T * k.x + B * k.y + N * k.z) * params.radius;
+				double u, v, s;
+				if (!camera.project(S, u, v, s)) continue;
+				int sx = int(std::floor(u * w));
+				int sy = int(std::floor((1.0 - v) * h));
+				if (sx < 0 || sy < 0 || sx >= w || sy >= h) continue;
+				double tq = buffer.depth[size_t(sy) * w + sx];
+				if (std::isinf(tq)) continue;
+
+				// 场景表面比采样点更靠近相机则视为遮挡，并按距离衰减（避免远处物体造成光晕）
+				double distS = (S - r.origin).length();
+				if (tq < distS - params.bias) {
+					Vec3 Q = pixelRay(camera, sx, sy, w, h).at(tq);
+					double dist = (Q - P).length();
+					occluded += std::min(1.0, params.radius / std::max(1e-9, dist));
+				}
+			}
+			raw[i] = occluded / double(samples);
 		}
+	}, 4);
+
+	// 2. 可分离双边模糊：深度与法线差异大的邻居权重接近0
+	const int radius = std::max(0, params.blurRadius);
+	auto blurPass = [&](const std::vector<double>& src, std::vector<double>& dst, int dx, int dy) {
+		Parallel::forEach(0, h, [&](int y) {
+			for (int x = 0; x < w; ++x) {
+				size_t i = size_t(y) * w + x;
+				double d0 = buffer.depth[i];
+				if (std::isinf(d0)) { dst[i] = 0.0; continue; }
+				const Vec3& n0 = buffer.normal[i];
+				double sum = 0.0, wsum = 0.0;
+				for (int k = -radius; k <= radius; ++k) {
+					int nx = x + k * dx, ny = y + k * dy;
+					if (nx < 0 || ny < 0 || nx >= w || ny >= h) continue;
+					size_t j = size_t(ny) * w + nx;
+					double dj = buffer.depth[j];
+					if (std::isinf(dj)) continue;
+					double rel = (dj - d0) / (params.blurDepthSigma * d0);
+					double nd = std::max(0.0, Vec3::dot(n0, buffer.normal[j]));
+					double nd2 = nd * nd, nd4 = nd2 * nd2;
+					double wgt = std::exp(-0.5 * (double(k * k) / double(std::max(1, radius * radius / 4)) + rel * rel)) * nd4 * nd4;
+					sum += src[j] * wgt;
+					wsum += wgt;
+				}
+				dst[i] = wsum > 0.0 ? sum / wsum : src[i];
+			}
+		}, 4);
+	};
+	if (radius > 0) {
+		std::vector<double> tmp(n, 0.0);
+		blurPass(raw, tmp, 1, 0);
+		blurPass(tmp, occlusion, 0, 1);
+	}
+	else {
+		occlusion.swap(raw);
 	}
 }
 
+void Postprocess::applySSAO(GBuffer& buffer, const Camera& camera, const SSAOParams& params) {
+	std::vector<double> occlusion;
+	computeSSAO(buffer, camera, params, occlusion);
+	if (occlusion.size() != buffer.color.size()) return;
+
+	// 卡通量化：阈值以下不变暗，其上按 bands 个等级逐级变暗，最暗一级为 strength
+	const int bands = std::max(1, params.bands);
+	const double span = std::max(1e-9, 1.0 - params.threshold);
+	Parallel::forEach(0, buffer.height, [&](int y) {
+		for (int x = 0; x < buffer.width; ++x) {
+			size_t i = size_t(y) * buffer.width + x;
+			double o = occlusion[i];
+			if (o <= params.threshold) continue;
+			double level = std::ceil((o - params.threshold) / span * bands) / bands;
+			level = std::min(1.0, level);
+			buffer.color[i] = buffer.color[i] * (1.0 - params.strength * level);
+		}
+	}, 16);
+}
+
+void Postprocess::applyDepthEdgeOutline(std::vector<Vec3>& colors,
+	const std::vector<double>& depths,
+	int width, int height,
+	double threshold,
+	const Vec3& outlineColor) {
+	
+	// 如果颜色或深度缓冲区大小不匹配，直接返回
+	if ((int)colors.size() != width * height || (int)depths.size() != width * height) return;
+
+	// 只含颜色和深度的缓冲：深度 Sobel 不读取法线与ID
+	GBuffer buffer;
+	buffer.width = width;
+	buffer.height = height;
+	buffer.color.swap(colors);
+	buffer.depth = depths;
 
+	Pipeline pipeline;
+	pipeline.add(std::make_shared<DepthSobelEdge>(threshold, outlineColor));
+	pipeline.run(buffer);
+
+	colors.swap(buffer.color);
+}
@@ -1,8 +1,149 @@
 #pragma once
 #include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
 #include "vec3.h"
+#include "gbuffer.h"
+#include "camera.h"
+
+/// @brief 屏幕空间环境光遮蔽参数
+struct SSAOParams {
+	int samples = 16;            // 每像素半球采样数
+	double radius = 0.5;         // 采样半径（世界单位）
+	double bias = 0.02;          // 深度比较偏移（世界单位），避免平面自遮蔽
+	int blurRadius = 4;          // 双边模糊半径（像素）
+	double blurDepthSigma = 0.05; // 双边模糊的相对深度容差
+	double threshold = 0.3;      // 遮蔽率超过此值才开始变暗
+	int bands = 1;               // 卡通量化色带数
+	double strength = 0.35;      // 最暗色带的变暗比例
+};
 
 namespace Postprocess {
+	/// @brief 后处理滤镜看到的像素邻域
+	/// depth / normal / ID 直接读缓冲（后处理不修改它们）；color 读取滚动行窗口中保存的原始颜色
+	/// （条带边界的外扩列取扫描前保存的副本），因此同一遍扫描中前面像素的写回不会影响后面像素的邻域。
+	/// 坐标越界时截断到图像边缘。
+	class PixelContext {
+	public:
+		PixelContext(const GBuffer& buffer, const Vec3* const* windowRows, int windowX0, int x, int y)
+			: buf(buffer), rows(windowRows), wx0(windowX0), x(x), y(y) {}
+
+		const GBuffer& buf;
+		const Vec3* const* rows;  // rows[0..2] = 原始颜色第 y-1, y, y+1 行（窗口内）
+		int wx0;                  // 窗口第0列对应的图像x
+		int x, y;
+
+		int width() const { return buf.width; }
+		int height() const { return buf.height; }
+		/// @brief 是否为图像最外一圈像素
+		bool onBorder() const { return x == 0 || y == 0 || x == buf.width - 1 || y == buf.height - 1; }
+
+		double depth(int dx = 0, int dy = 0) const { return buf.depth[at(dx, dy)]; }
+		const Vec3& normal(int dx = 0, int dy = 0) const { return buf.normal[at(dx, dy)]; }
+		std::uint32_t objectId(int dx = 0, int dy = 0) const { return buf.objectId[at(dx, dy)]; }
+		std::uint32_t materialId(int dx = 0, int dy = 0) const { return buf.materialId[at(dx, dy)]; }
+		/// @brief 原始（未经本遍修改的）颜色
+		const Vec3& color(int dx = 0, int dy = 0) const {
+			int cx = std::max(0, std::min(buf.width - 1, x + dx));
+			return rows[std::max(-1, std::min(1, dy)) + 1][cx - wx0];
+		}
+
+	private:
+		int at(int dx, int dy) const {
+			int cx = std::max(0, std::min(buf.width - 1, x + dx));
+			int cy = std::max(0, std::min(buf.height - 1, y + dy));
+			return cy * buf.width + cx;
+		}
+	};
+
+	/// @brief 图像空间滤镜：读取 3x3 邻域，修改当前像素颜色
+	class Filter {
+	public:
+		virtual ~Filter() = default;
+		/// @param ctx 像素邻域
+		/// @param color 当前像素颜色（链中前一个滤镜的输出），原地修改
+		/// @return 该像素是否被画成描边（写入 GBuffer::outline 掩码）
+		virtual bool apply(const PixelContext& ctx, Vec3& color) const = 0;
+	};
+
+	/// @brief 深度 Sobel 描边（与 applyDepthEdgeOutline 行为一致）
+	class DepthSobelEdge : public Filter {
+	public:
+		DepthSobelEdge(double threshold, const Vec3& outlineColor) : threshold(threshold), outlineColor(outlineColor) {}
+		bool apply(const PixelContext& ctx, Vec3& color) const override;
+	private:
+		double threshold;
+		Vec3 outlineColor;
+	};
+
+	/// @brief 法线不连续（折痕）描边：与4邻域法线夹角超过阈值时描边
+	class NormalEdge : public Filter {
+	public:
+		/// @param angleDegrees 折痕角阈值（度）
+		NormalEdge(double angleDegrees, const Vec3& outlineColor);
+		bool apply(const PixelContext& ctx, Vec3& color) const override;
+	private:
+		double cosThreshold;
+		Vec3 outlineColor;
+	};
+
+	/// @brief ID 边界描边：4邻域的对象ID或材质ID不同时，在较近的一侧描边
+	class IdEdge : public Filter {
+	public:
+		enum class Channel { Object, Material };
+		IdEdge(Channel channel, const Vec3& outlineColor) : channel(channel), outlineColor(outlineColor) {}
+		bool apply(const PixelContext& ctx, Vec3& color) const override;
+	private:
+		Channel channel;
+		Vec3 outlineColor;
+	};
+
+	// Runs a chain of filters in a single tiled sweep: the frame is split into vertical strips
+	// of 'tileWidth' columns and each strip is swept top to bottom, keeping only a rolling
+	// window of three original color rows. Adding a filter adds per-pixel arithmetic but no
+	// extra full-frame pass or temporary buffer.
+	/// @brief 融合后处理管线
+	class Pipeline {
+	public:
+		/// @brief 追加滤镜（按添加顺序执行）
+		void add(std::shared_ptr<Filter> filter) { filters.push_back(std::move(filter)); }
+		bool empty() const { return filters.empty(); }
+
+		/// @brief 对缓冲执行一遍融合扫描，原地修改 color（outline 掩码已分配时同时标记描边像素）
+		void run(GBuffer& buffer) const;
+
+		/// @brief 只处理矩形 rect 内的像素；邻域颜色从 buffer 读取，rect 外不修改
+		/// rect 四周1像素内的颜色须为未经处理的原始颜色，结果与整帧执行时 rect 内的结果一致
+		void run(GBuffer& buffer, const PixelRect& rect) const;
+
+		/// @brief 条带宽度（像素）
+		int tileWidth = 128;
+
+	private:
+		std::vector<std::shared_ptr<Filter>> filters;
+	};
+
+	// Widens the pixels marked in buffer.outline to lines about 'width' pixels wide, painting each
+	// covered pixel with the color of its nearest outline pixel. Nearest seeds are found with a jump
+	// flood whose first step is the smallest power of two >= the radius, so the cost is O(log width)
+	// per pixel instead of the O(width^2) of a neighbourhood dilation.
+	/// @brief 描边加粗（跳跃泛洪距离变换）
+	/// @param buffer 帧缓冲（使用 color 与 outline）
+	/// @param width 目标线宽（像素），<= 1 时不做处理
+	void thickenOutlines(GBuffer& buffer, double width);
+
+	// Screen-space ambient occlusion from the depth and normal buffers. Positions are rebuilt from
+	// the camera rays and depths; each pixel tests a fixed hemisphere kernel (rotated per pixel)
+	// against the depth buffer, the result is smoothed with a separable depth/normal-aware
+	// bilateral blur and quantized into toon bands. Rows are processed in parallel. Cost depends
+	// only on resolution and sample count, not on scene complexity.
+	/// @brief 计算 SSAO 遮蔽率（0 = 无遮蔽，1 = 完全遮蔽；背景为0）
+	void computeSSAO(const GBuffer& buffer, const Camera& camera, const SSAOParams& params, std::vector<double>& occlusion);
+
+	/// @brief 计算 SSAO 并按卡通色带调暗颜色
+	void applySSAO(GBuffer& buffer, const Camera& camera, const SSAOParams& params);
+
 	// Write black outlines into colors where the depth difference to any 8-neighbor exceeds threshold.
 	// depths[i] = INF (or very large) means background.
 	/// @brief 应用基于深度的边缘描边效果
@@ -18,5 +159,3 @@ namespace Postprocess {
 		double threshold,
 		const Vec3& outlineColor = Vec3(0, 0, 0));
 }
-
-
@@ -0,0 +1,297 @@
+#include "raster.h"
+#include "triangle.h"
+#include "sphere.h"
+#include "lod_mesh.h"
+#include "bvh_mesh.h"
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TOON_RASTER_SSE2 1
+#endif
+
+namespace {
+	const std::uint32_t kSphereBit = 0x80000000u;
+	/// @brief 投影深度下限：s 不大于此值的顶点视为在相机平面上或后方
+	const double kMinDepth = 1e-9;
+}
+
+Rasterizer::Rasterizer(const Camera& cam, int w, int h, int tile)
+	: camera(cam), width(w), height(h), tileSize(std::max(4, tile)) {
+	tilesX = (width + tileSize - 1) / tileSize;
+	tilesY = (height + tileSize - 1) / tileSize;
+}
+
+void Rasterizer::rasterize(const std::vector<std::shared_ptr<Hittable>>& objects) {
+	rasterize(objects, std::vector<PixelRect>(1, PixelRect(0, 0, width, height)));
+}
+
+void Rasterizer::rasterize(const std::vector<std::shared_ptr<Hittable>>& objects, const std::vector<PixelRect>& areas) {
+	activeTiles.assign(size_t(tilesX) * tilesY, 0);
+	for (const PixelRect& area : areas) {
+		const PixelRect r = area.intersect(PixelRect(0, 0, width, height));
+		if (r.empty()) continue;
+		for (int ty = r.y0 / tileSize; ty <= (r.y1 - 1) / tileSize; ++ty) {
+			for (int tx = r.x0 / tileSize; tx <= (r.x1 - 1) / tileSize; ++tx) activeTiles[size_t(ty) * tilesX + tx] = 1;
+		}
+	}
+
+	prims.clear();
+	tris.clear();
+	spheres.clear();
+	fallback.clear();
+	bins.assign(size_t(tilesX) * tilesY, {});
+	binned = 0;
+
+	// 1. 图元建立：投影到屏幕，计算包围盒
+	for (size_t o = 0; o < objects.size(); ++o) {
+		const Hittable* obj = objects[o].get();
+		std::uint32_t objectId = std::uint32_t(o);
+		if (const Triangle* tri = dynamic_cast<const Triangle*>(obj)) {
+			setupTriangle(*tri, objectId);
+		}
+		else if (const LodLevel* lod = dynamic_cast<const LodLevel*>(obj)) {
+			if (lod->mesh().levelCount() == 0) continue;
+			for (const Triangle& t : lod->triangles()) setupTriangle(t, objectId);
+		}
+		else if (const LodMesh* mesh = dynamic_cast<const LodMesh*>(obj)) {
+			if (mesh->levelCount() == 0) continue;
+			for (const Triangle& t : mesh->triangles(0)) setupTriangle(t, objectId);
+		}
+		else if (const BvhMesh* mesh = dynamic_cast<const BvhMesh*>(obj)) {
+			for (const Triangle& t : mesh->triangles()) setupTriangle(t, objectId);
+		}
+		else if (const Sphere* sphere = dynamic_cast<const Sphere*>(obj)) {
+			if (!setupSphere(sphere->getCenter(), sphere->getRadius(), sphere, objectId)) fallback.push_back(objectId);
+		}
+		else {
+			fallback.push_back(objectId);
+		}
+	}
+	// 同一对象可能因多个三角形跨越相机平面而重复登记
+	std::sort(fallback.begin(), fallback.end());
+	fallback.erase(std::unique(fallback.begin(), fallback.end()), fallback.end());
+
+	// 2. 分箱
+	for (size_t i = 0; i < tris.size(); ++i) {
+		const TriSetup& t = tris[i];
+		binRect(std::uint32_t(i), t.minX, t.minY, t.maxX, t.maxY);
+	}
+	for (size_t i = 0; i < spheres.size(); ++i) {
+		const SphereSetup& sp = spheres[i];
+		binRect(std::uint32_t(i) | kSphereBit, sp.minX, sp.minY, sp.maxX, sp.maxY);
+	}
+
+	// 3. 逐分块光栅化
+	visible.assign(size_t(width) * height, -1);
+	std::vector<double> tileDepth(size_t(tileSize) * tileSize);
+	std::vector<std::int32_t> tileId(size_t(tileSize) * tileSize);
+	for (int ty = 0; ty < tilesY; ++ty) {
+		for (int tx = 0; tx < tilesX; ++tx) {
+			if (!activeTiles[size_t(ty) * tilesX + tx]) continue;
+			rasterizeTile(tx, ty, tileDepth, tileId);
+			int x0 = tx * tileSize, y0 = ty * tileSize;
+			int x1 = std::min(width, x0 + tileSize), y1 = std::min(height, y0 + tileSize);
+			for (int y = y0; y < y1; ++y) {
+				std::copy(&tileId[size_t(y - y0) * tileSize], &tileId[size_t(y - y0) * tileSize] + (x1 - x0),
+					&visible[size_t(y) * width + x0]);
+			}
+		}
+	}
+}
+
+void Rasterizer::setupTriangle(const Triangle& tri, std::uint32_t objectId) {
+	TriSetup t;
+	int behind = 0;
+	for (int k = 0; k < 3; ++k) {
+		double u, v, s;
+		camera.project(tri.vertex(k), u, v, s);
+		if (s <= kMinDepth) { ++behind; continue; }
+		t.x[k] = u * width;
+		t.y[k] = (1.0 - v) * height;
+		t.invS[k] = 1.0 / s;
+	}
+	// 完全在相机后方：主光线不可能击中
+	if (behind == 3) return;
+	// 跨越相机平面：交给光线求交
+	if (behind > 0) { fallback.push_back(objectId); return; }
+
+	double area = (t.x[1] - t.x[0]) * (t.y[2] - t.y[0]) - (t.y[1] - t.y[0]) * (t.x[2] - t.x[0]);
+	if (area == 0.0 || !std::isfinite(area)) return; // 侧对相机，不覆盖任何像素中心
+	if (area < 0.0) {
+		// 统一为正向绕序（双面渲染）
+		std::swap(t.x[1], t.x[2]);
+		std::swap(t.y[1], t.y[2]);
+		std::swap(t.invS[1], t.invS[2]);
+		area = -area;
+	}
+	t.invArea = 1.0 / area;
+
+	// 像素中心位于 (x + 0.5, y + 0.5)
+	double minXf = std::min(t.x[0], std::min(t.x[1], t.x[2]));
+	double maxXf = std::max(t.x[0], std::max(t.x[1], t.x[2]));
+	double minYf = std::min(t.y[0], std::min(t.y[1], t.y[2]));
+	double maxYf = std::max(t.y[0], std::max(t.y[1], t.y[2]));
+	if (maxXf < 0.0 || maxYf < 0.0 || minXf > width || minYf > height) return;
+	t.minX = std::max(0, int(std::floor(minXf - 0.5)));
+	t.minY = std::max(0, int(std::floor(minYf - 0.5)));
+	t.maxX = std::min(width - 1, int(std::ceil(maxXf - 0.5)));
+	t.maxY = std::min(height - 1, int(std::ceil(maxYf - 0.5)));
+	if (t.minX > t.maxX || t.minY > t.maxY) return;
+
+	t.prim = std::int32_t(prims.size());
+	prims.push_back(RasterPrim{ &tri, objectId });
+	tris.push_back(t);
+}
+
+bool Rasterizer::setupSphere(const Vec3& center, double radius, const Hittable* shape, std::uint32_t objectId) {
+	// 用包围盒 8 个角点的投影作为保守屏幕范围
+	double minXf = std::numeric_limits<double>::infinity(), maxXf = -minXf;
+	double minYf = minXf, maxYf = -minXf;
+	int behind = 0;
+	for (int k = 0; k < 8; ++k) {
+		Vec3 corner = center + Vec3((k & 1) ? radius : -radius, (k & 2) ? radius : -radius, (k & 4) ? radius : -radius);
+		double u, v, s;
+		camera.project(corner, u, v, s);
+		if (s <= kMinDepth) { ++behind; continue; }
+		double x = u * width, y = (1.0 - v) * height;
+		minXf = std::min(minXf, x); maxXf = std::max(maxXf, x);
+		minYf = std::min(minYf, y); maxYf = std::max(maxYf, y);
+	}
+	if (behind == 8) return true;
+	if (behind > 0) return false;
+	if (maxXf < 0.0 || maxYf < 0.0 || minXf > width || minYf > height) return true;
+
+	SphereSetup sp;
+	sp.center = center;
+	sp.radius = radius;
+	sp.minX = std::max(0, int(std::floor(minXf - 0.5)));
+	sp.minY = std::max(0, int(std::floor(minYf - 0.5)));
+	sp.maxX = std::min(width - 1, int(std::ceil(maxXf - 0.5)));
+	sp.maxY = std::min(height - 1, int(std::ceil(maxYf - 0.5)));
+	if (sp.minX > sp.maxX || sp.minY > sp.maxY) return true;
+	sp.prim = std::int32_t(prims.size());
+	prims.push_back(RasterPrim{ shape, objectId });
+	spheres.push_back(sp);
+	return true;
+}
+
+void Rasterizer::binRect(std::uint32_t ref, int minX, int minY, int maxX, int maxY) {
+	int tx0 = minX / tileSize, tx1 = maxX / tileSize;
+	int ty0 = minY / tileSize, ty1 = maxY / tileSize;
+	for (int ty = ty0; ty <= ty1; ++ty) {
+		for (int tx = tx0; tx <= tx1; ++tx) {
+			if (!activeTiles[size_t(ty) * tilesX + tx]) continue;
+			bins[size_t(ty) * tilesX + tx].push_back(ref);
+			++binned;
+		}
+	}
+}
+
+void Rasterizer::rasterizeTile(int tx, int ty, std::vector<double>& depth, std::vector<std::int32_t>& id) const {
+	const double INF = std::numeric_limits<double>::infinity();
+	std::fill(depth.begin(), depth.end(), INF);
+	std::fill(id.begin(), id.end(), -1);
+
+	const int tileX0 = tx * tileSize, tileY0 = ty * tileSize;
+	const int tileX1 = std::min(width, tileX0 + tileSize) - 1;
+	const int tileY1 = std::min(height, tileY0 + tileSize) - 1;
+
+	for (std::uint32_t ref : bins[size_t(ty) * tilesX + tx]) {
+		if (ref & kSphereBit) {
+			// 解析球：逐像素求光线与球的交点，再换算为投影深度
+			const SphereSetup& sp = spheres[ref & ~kSphereBit];
+			int x0 = std::max(tileX0, sp.minX), x1 = std::min(tileX1, sp.maxX);
+			int y0 = std::max(tileY0, sp.minY), y1 = std::min(tileY1, sp.maxY);
+			for (int y = y0; y <= y1; ++y) {
+				double v = 1.0 - (double(y) + 0.5) / double(height);
+				for (int x = x0; x <= x1; ++x) {
+					double u = (double(x) + 0.5) / double(width);
+					Ray r = camera.get_ray(u, v);
+					Vec3 oc = r.origin - sp.center;
+					double half_b = Vec3::dot(oc, r.direction);
+					double c = oc.length_squared() - sp.radius * sp.radius;
+					double disc = half_b * half_b - r.direction.length_squared() * c;
+					if (disc < 0.0) continue;
+					double sq = std::sqrt(disc);
+					double a = r.direction.length_squared();
+					double t = (-half_b - sq) / a;
+					if (t < 1e-4) t = (-half_b + sq) / a;
+					if (t < 1e-4) continue;
+					double pu, pv, s;
+					if (!camera.project(r.at(t), pu, pv, s)) continue;
+					size_t li = size_t(y - tileY0) * tileSize + (x - tileX0);
+					if (s < depth[li]) { depth[li] = s; id[li] = sp.prim; }
+				}
+			}
+			continue;
+		}
+
+		const TriSetup& t = tris[ref];
+		int x0 = std::max(tileX0, t.minX), x1 = std::min(tileX1, t.maxX);
+		int y0 = std::max(tileY0, t.minY), y1 = std::min(tileY1, t.maxY);
+		if (x0 > x1 || y0 > y1) continue;
+
+		// 边函数 E_k(p) = (b - a) x (p - a)，k 为对边顶点；E(x+1) = E + A，E(y+1) = E + B
+		double A[3], B[3], rowE[3];
+		double px = double(x0) + 0.5, py = double(y0) + 0.5;
+		for (int k = 0; k < 3; ++k) {
+			int a = (k + 1) % 3, b = (k + 2) % 3;
+			A[k] = -(t.y[b] - t.y[a]);
+			B[k] = t.x[b] - t.x[a];
+			rowE[k] = (t.x[b] - t.x[a]) * (py - t.y[a]) - (t.y[b] - t.y[a]) * (px - t.x[a]);
+		}
+		// 1/s 关于屏幕坐标的平面方程系数
+		double zA = (A[0] * t.invS[0] + A[1] * t.invS[1] + A[2] * t.invS[2]) * t.invArea;
+		double zB = (B[0] * t.invS[0] + B[1] * t.invS[1] + B[2] * t.invS[2]) * t.invArea;
+		double rowZ = (rowE[0] * t.invS[0] + rowE[1] * t.invS[1] + rowE[2] * t.invS[2]) * t.invArea;
+
+		for (int y = y0; y <= y1; ++y) {
+			double* depthRow = &depth[size_t(y - tileY0) * tileSize - tileX0];
+			std::int32_t* idRow = &id[size_t(y - tileY0) * tileSize - tileX0];
+			int x = x0;
+#ifdef TOON_RASTER_SSE2
+			// 每步两个像素：三条边函数同时非负即覆盖
+			const __m128d zero = _mm_setzero_pd();
+			const __m128d lane = _mm_set_pd(1.0, 0.0);
+			__m128d e0 = _mm_add_pd(_mm_set1_pd(rowE[0]), _mm_mul_pd(lane, _mm_set1_pd(A[0])));
+			__m128d e1 = _mm_add_pd(_mm_set1_pd(rowE[1]), _mm_mul_pd(lane, _mm_set1_pd(A[1])));
+			__m128d e2 = _mm_add_pd(_mm_set1_pd(rowE[2]), _mm_mul_pd(lane, _mm_set1_pd(A[2])));
+			__m128d z = _mm_add_pd(_mm_set1_pd(rowZ), _mm_mul_pd(lane, _mm_set1_pd(zA)));
+			const __m128d step0 = _mm_set1_pd(2.0 * A[0]);
+			const __m128d step1 = _mm_set1_pd(2.0 * A[1]);
+			const __m128d step2 = _mm_set1_pd(2.0 * A[2]);
+			const __m128d stepZ = _mm_set1_pd(2.0 * zA);
+			for (; x + 1 <= x1; x += 2) {
+				__m128d outside = _mm_or_pd(_mm_or_pd(_mm_cmplt_pd(e0, zero), _mm_cmplt_pd(e1, zero)), _mm_cmplt_pd(e2, zero));
+				int mask = _mm_movemask_pd(outside);
+				if (mask != 3) {
+					alignas(16) double zs[2];
+					_mm_store_pd(zs, z);
+					for (int l = 0; l < 2; ++l) {
+						if (mask & (1 << l)) continue;
+						// 深度比较使用 s = 1 / (1/s)，越小越近
+						double s = 1.0 / zs[l];
+						if (s < depthRow[x + l]) { depthRow[x + l] = s; idRow[x + l] = t.prim; }
+					}
+				}
+				e0 = _mm_add_pd(e0, step0);
+				e1 = _mm_add_pd(e1, step1);
+				e2 = _mm_add_pd(e2, step2);
+				z = _mm_add_pd(z, stepZ);
+			}
+#endif
+			// 标量路径（及 SIMD 的剩余像素）
+			for (; x <= x1; ++x) {
+				double dx = double(x - x0);
+				double w0 = rowE[0] + A[0] * dx, w1 = rowE[1] + A[1] * dx, w2 = rowE[2] + A[2] * dx;
+				if (w0 < 0.0 || w1 < 0.0 || w2 < 0.0) continue;
+				double s = 1.0 / (rowZ + zA * dx);
+				if (s < depthRow[x]) { depthRow[x] = s; idRow[x] = t.prim; }
+			}
+			for (int k = 0; k < 3; ++k) rowE[k] += B[k];
+			rowZ += zB;
+		}
+	}
+}
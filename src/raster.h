@@ -0,0 +1,95 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "hittable.h"
+#include "camera.h"
+#include "gbuffer.h"
+
+class Triangle;
+
+/// @brief 可被光栅化的图元（三角形或解析球）
+struct RasterPrim {
+	/// @brief 图元本体，用于在像素光线上重建精确的 HitRecord
+	const Hittable* shape = nullptr;
+	/// @brief 所属顶层对象在场景列表中的下标
+	std::uint32_t objectId = 0;
+};
+
+// Tiled CPU rasterizer for primary visibility. Triangles (Triangle, the level of a LodLevel or
+// level 0 of a bare LodMesh) are projected through the camera and binned into screen tiles;
+// each tile resolves visibility with incremental edge functions (SSE2, two pixels per step)
+// against a tile-local depth buffer. Spheres are rasterized analytically over their projected
+// bounds. Depth is the camera's projective depth s, which is linear along each primary ray.
+// Objects that cannot be rasterized (unknown Hittable types, primitives crossing the camera
+// plane) are reported as fallbacks and must be ray traced against the raster result.
+// rasterize() can be limited to a set of pixel rectangles: every primitive is still set up once,
+// but only tiles overlapping a rectangle are binned and rasterized; other pixels report -1.
+/// @brief 分块光栅化可见性后端
+class Rasterizer {
+public:
+	/// @param cam 相机
+	/// @param width 图像宽度
+	/// @param height 图像高度
+	/// @param tileSize 分块边长（像素）
+	Rasterizer(const Camera& cam, int width, int height, int tileSize = 32);
+
+	/// @brief 光栅化场景，生成每像素的可见图元
+	void rasterize(const std::vector<std::shared_ptr<Hittable>>& objects);
+	/// @brief 只光栅化与 areas 中矩形相交的分块（其余像素为 -1）
+	void rasterize(const std::vector<std::shared_ptr<Hittable>>& objects, const std::vector<PixelRect>& areas);
+
+	/// @brief 像素 i 处可见图元的下标，-1 表示未覆盖
+	std::int32_t primitiveAt(int i) const { return visible[i]; }
+	/// @brief 图元
+	const RasterPrim& primitive(std::int32_t index) const { return prims[index]; }
+	/// @brief 需要光线求交补充的对象下标
+	const std::vector<std::uint32_t>& fallbackObjects() const { return fallback; }
+
+	/// @brief 光栅化的三角形数
+	size_t triangleCount() const { return tris.size(); }
+	/// @brief 分箱引用总数（三角形/球 x 覆盖的分块）
+	size_t binnedReferences() const { return binned; }
+
+private:
+	/// @brief 三角形建立数据（屏幕空间）
+	struct TriSetup {
+		double x[3], y[3];     // 屏幕坐标（像素，y 向下）
+		double invS[3];        // 1/s，在屏幕空间线性插值
+		double invArea;        // 1 / 有向面积
+		int minX, minY, maxX, maxY;
+		std::int32_t prim;
+	};
+	/// @brief 球建立数据
+	struct SphereSetup {
+		Vec3 center;
+		double radius;
+		int minX, minY, maxX, maxY;
+		std::int32_t prim;
+	};
+
+	Camera camera;
+	int width;
+	int height;
+	int tileSize;
+	int tilesX;
+	int tilesY;
+
+	std::vector<RasterPrim> prims;
+	std::vector<TriSetup> tris;
+	std::vector<SphereSetup> spheres;
+	std::vector<std::uint32_t> fallback;
+	/// @brief 每个分块的图元列表：三角形下标，最高位置 1 表示球下标
+	std::vector<std::vector<std::uint32_t>> bins;
+	/// @brief 需要光栅化的分块
+	std::vector<std::uint8_t> activeTiles;
+	size_t binned = 0;
+
+	std::vector<std::int32_t> visible;
+
+	void setupTriangle(const Triangle& tri, std::uint32_t objectId);
+	/// @return false 表示该球无法光栅化（跨越相机平面）
+	bool setupSphere(const Vec3& center, double radius, const Hittable* shape, std::uint32_t objectId);
+	void binRect(std::uint32_t ref, int minX, int minY, int maxX, int maxY);
+	void rasterizeTile(int tx, int ty, std::vector<double>& depth, std::vector<std::int32_t>& id) const;
+};
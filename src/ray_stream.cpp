@@ -0,0 +1,74 @@
+#include "ray_stream.h"
+#include "morton.h"
+#include <algorithm>
+#include <numeric>
+#include <limits>
+
+namespace {
+	/// @brief 按排列 order 重排数组
+	template <typename T>
+	static void permute(std::vector<T>& v, const std::vector<std::uint32_t>& order, std::vector<T>& scratch) {
+		scratch.resize(v.size());
+		for (size_t i = 0; i < order.size(); ++i) scratch[i] = v[order[i]];
+		v.swap(scratch);
+	}
+}
+
+void RayStream::clear() {
+	ox.clear(); oy.clear(); oz.clear();
+	dx.clear(); dy.clear(); dz.clear();
+	pixel.clear();
+	triangleRays.clear();
+}
+
+void RayStream::reserve(size_t n) {
+	ox.reserve(n); oy.reserve(n); oz.reserve(n);
+	dx.reserve(n); dy.reserve(n); dz.reserve(n);
+	pixel.reserve(n);
+}
+
+void RayStream::prepareTriangleRays() {
+	triangleRays.resize(size());
+	for (size_t i = 0; i < size(); ++i) {
+		triangleRays[i] = TriangleRay(Vec3(ox[i], oy[i], oz[i]), Vec3(dx[i], dy[i], dz[i]));
+	}
+}
+
+void RayStream::sortForCoherence() {
+	const size_t n = size();
+	if (n < 2) return;
+
+	// 起点包围盒，用于归一化
+	const double INF = std::numeric_limits<double>::infinity();
+	double lo[3] = { INF, INF, INF }, hi[3] = { -INF, -INF, -INF };
+	for (size_t i = 0; i < n; ++i) {
+		lo[0] = std::min(lo[0], ox[i]); hi[0] = std::max(hi[0], ox[i]);
+		lo[1] = std::min(lo[1], oy[i]); hi[1] = std::max(hi[1], oy[i]);
+		lo[2] = std::min(lo[2], oz[i]); hi[2] = std::max(hi[2], oz[i]);
+	}
+	double inv[3];
+	for (int a = 0; a < 3; ++a) inv[a] = hi[a] > lo[a] ? 1.0 / (hi[a] - lo[a]) : 0.0;
+
+	// 键：卦限(3位) | 方向 Morton(30位) | 起点 Morton(30位)
+	std::vector<std::uint64_t> keys(n);
+	for (size_t i = 0; i < n; ++i) {
+		std::uint64_t octant = (dx[i] < 0 ? 4u : 0u) | (dy[i] < 0 ? 2u : 0u) | (dz[i] < 0 ? 1u : 0u);
+		std::uint64_t dirCode = Morton::encode(dx[i] * 0.5 + 0.5, dy[i] * 0.5 + 0.5, dz[i] * 0.5 + 0.5);
+		std::uint64_t orgCode = Morton::encode((ox[i] - lo[0]) * inv[0], (oy[i] - lo[1]) * inv[1], (oz[i] - lo[2]) * inv[2]);
+		keys[i] = (octant << 60) | (dirCode << 30) | orgCode;
+	}
+
+	std::vector<std::uint32_t> order(n);
+	std::iota(order.begin(), order.end(), 0u);
+	std::stable_sort(order.begin(), order.end(), [&keys](std::uint32_t a, std::uint32_t b) { return keys[a] < keys[b]; });
+
+	std::vector<double> scratch;
+	permute(ox, order, scratch); permute(oy, order, scratch); permute(oz, order, scratch);
+	permute(dx, order, scratch); permute(dy, order, scratch); permute(dz, order, scratch);
+	std::vector<std::uint32_t> scratchIdx;
+	permute(pixel, order, scratchIdx);
+	if (triangleRays.size() == n) {
+		std::vector<TriangleRay> scratchSetup;
+		permute(triangleRays, order, scratchSetup);
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "ray.h"
+#include "triangle_ray.h"
+
+/// @brief 光线流（SoA）：波前模式中各阶段之间传递的一批光线
+struct RayStream {
+	/// @brief 起点分量
+	std::vector<double> ox, oy, oz;
+	/// @brief 方向分量（单位向量）
+	std::vector<double> dx, dy, dz;
+	/// @brief 光线对应的像素下标（或调用方自定义的载荷）
+	std::vector<std::uint32_t> pixel;
+	/// @brief 逐光线的三角形求交预计算（prepareTriangleRays 之后有效；为空或条数不符时三角形自行构建）
+	std::vector<TriangleRay> triangleRays;
+
+	size_t size() const { return pixel.size(); }
+	bool empty() const { return pixel.empty(); }
+
+	/// @brief 清空（保留容量，批次之间复用）
+	void clear();
+	void reserve(size_t n);
+
+	/// @brief 追加一条光线
+	void push(const Ray& r, std::uint32_t payload) {
+		ox.push_back(r.origin.x); oy.push_back(r.origin.y); oz.push_back(r.origin.z);
+		dx.push_back(r.direction.x); dy.push_back(r.direction.y); dz.push_back(r.direction.z);
+		pixel.push_back(payload);
+	}
+
+	/// @brief 为当前全部光线构建 TriangleRay，整批光线与各三角形求交时共用（追加或重排光线后需重新构建）
+	void prepareTriangleRays();
+	/// @brief triangleRays 是否与当前光线一一对应
+	bool hasTriangleRays() const { return triangleRays.size() == pixel.size(); }
+
+	/// @brief 第 i 条光线
+	Ray ray(size_t i) const { return Ray(Vec3(ox[i], oy[i], oz[i]), Vec3(dx[i], dy[i], dz[i])); }
+
+	// Reorders the stream for coherence: rays are grouped by direction octant, then along a Morton
+	// curve over direction and over origin (normalized to the stream's origin bounds). Primary rays
+	// of a pinhole camera end up ordered by direction, shadow rays of a directional light by origin.
+	/// @brief 按方向卦限与方向/起点的 Morton 码重排
+	void sortForCoherence();
+};
@@ -1,86 +1,1276 @@
 #include "renderer.h"
 #include "postprocess.h"
+#include "lod_mesh.h"
+#include "raster.h"
+#include "ray_stream.h"
+#include "parallel.h"
+#include "frame_partial.h"
+#include "image_writer.h"
 #include <limits>
 #include <fstream>
 #include <iostream>
+#include <cmath>
+#include <chrono>
+#include <atomic>
+
+namespace {
+	/// @brief 背景（天空）颜色
+	const Vec3 kBackgroundColor = Vec3(0.8, 0.9, 1.0) * 0.95;
+	/// @brief 描边颜色
+	const Vec3 kOutlineColor = Vec3(0.8, 0.55, 0.14);
+}
 
 Renderer::Renderer(int w, int h, const Camera& cam, const Light& l)
 	: width(w), height(h), camera(cam), light(l) {}
 
 bool Renderer::renderPPM(const std::vector<std::shared_ptr<Hittable>>& objects,
+	const MaterialTable& materials,
 	const ToonParams& toonParams,
 	const std::string& outputPath,
 	bool enableDepthEdges,
 	double depthEdgeThreshold) {
-	const double INF = std::numeric_limits<double>::infinity();
-	std::vector<Vec3> colorBuffer(width * height, Vec3(0, 0, 0));
-	std::vector<double> depthBuffer(width * height, INF);
-
-	auto idx = [this](int x, int y) { return y * this->width + x; };
-
-	std::cout << "Rendering " << width << "x" << height << " image...\n";
-	for (int y = 0; y < height; ++y) {
-		if (y % 50 == 0) {
-			std::cout << "Progress: " << (y * 100 / height) << "%\n";
-		}
-		double v = (double(y) + 0.5) / double(height);
-		for (int x = 0; x < width; ++x) {
-			double u = (double(x) + 0.5) / double(width);
-			Ray r = camera.get_ray(u, 1.0 - v); // flip v so image isn't upside down
-
-			double t_min = 1e-4;
-			double t_max = INF;
-			HitRecord closestHit;
-			bool hitSomething = false;
-			for (const auto& obj : objects) {
-				HitRecord rec;
-				if (obj->hit(r, t_min, t_max, rec)) {
-					hitSomething = true;
-					t_max = rec.t;
-					closestHit = rec;
-				}
+	GBuffer frame(width, height);
+	renderFrame(objects, materials, toonParams, PixelRect(0, 0, width, height), frame);
+	if (options.retainFrame) lastRaw = frame;
+	postprocessFrame(frame, enableDepthEdges, depthEdgeThreshold);
+	const bool written = writeImage(frame.color, outputPath);
+
+	hasLastFrame = options.retainFrame;
+	if (hasLastFrame) {
+		lastOutput = frame.color;
+		captureBounds(objects);
+	}
+	else {
+		lastRaw = GBuffer();
+		lastOutput.clear();
+	}
+	return written;
+}
+
+void Renderer::captureBounds(const std::vector<std::shared_ptr<Hittable>>& objects) {
+	lastBounds.assign(objects.size(), AABB());
+	for (size_t o = 0; o < objects.size(); ++o) {
+		// 无界对象保持空盒，增量渲染时视为整帧脏
+		if (!objects[o]->boundingBox(lastBounds[o])) lastBounds[o] = AABB();
+	}
+}
+
+bool Renderer::renderIncremental(const std::vector<std::shared_ptr<Hittable>>& objects,
+	const MaterialTable& materials,
+	const ToonParams& toonParams,
+	const std::string& outputPath,
+	bool enableDepthEdges,
+	double depthEdgeThreshold,
+	const std::vector<std::uint32_t>& changedObjects) {
+	if (!hasLastFrame || lastBounds.size() != objects.size() || lastRaw.width != width || lastRaw.height != height) {
+		std::cout << "Incremental: no compatible previous frame, rendering the full frame\n";
+		RenderOptions saved = options;
+		options.retainFrame = true;
+		bool ok = renderPPM(objects, materials, toonParams, outputPath, enableDepthEdges, depthEdgeThreshold);
+		options = saved;
+		return ok;
+	}
+
+	const std::vector<std::shared_ptr<Hittable>> scene = prepareFrame(objects, toonParams, PixelRect(0, 0, width, height));
+
+	const int kTile = 32;
+	const int tilesX = (width + kTile - 1) / kTile;
+	const int tilesY = (height + kTile - 1) / kTile;
+	std::vector<std::uint8_t> dirtyTile(size_t(tilesX) * tilesY, 0);
+	auto markRect = [&](int x0, int y0, int x1, int y1) {
+		x0 = std::max(0, x0); y0 = std::max(0, y0);
+		x1 = std::min(width, x1); y1 = std::min(height, y1);
+		if (x1 <= x0 || y1 <= y0) return;
+		for (int ty = y0 / kTile; ty <= (y1 - 1) / kTile; ++ty) {
+			for (int tx = x0 / kTile; tx <= (x1 - 1) / kTile; ++tx) dirtyTile[size_t(ty) * tilesX + tx] = 1;
+		}
+	};
+
+	// 点集投影的屏幕范围（外扩 1~2 像素）标脏；有点在相机平面之后时返回 false
+	auto markProjected = [&](const Vec3* points, int count) {
+		double xMin = 1e300, yMin = 1e300, xMax = -1e300, yMax = -1e300;
+		for (int c = 0; c < count; ++c) {
+			double u, v, sDepth;
+			if (!camera.project(points[c], u, v, sDepth)) return false;
+			double px = u * width - 0.5, py = (1.0 - v) * height - 0.5;
+			xMin = std::min(xMin, px); xMax = std::max(xMax, px);
+			yMin = std::min(yMin, py); yMax = std::max(yMax, py);
+		}
+		if (xMax < -1.0 || yMax < -1.0 || xMin > width || yMin > height) return true;
+		markRect(int(std::floor(std::max(-1.0, xMin))) - 1, int(std::floor(std::max(-1.0, yMin))) - 1,
+			int(std::ceil(std::min(double(width), xMax))) + 2, int(std::ceil(std::min(double(height), yMax))) + 2);
+		return true;
+	};
+
+	// 1. 被修改对象的旧/新包围盒投影到屏幕（覆盖上一帧与本帧中该对象的所有像素）
+	bool fullDirty = false;
+	std::vector<AABB> changedBoxes;
+	for (std::uint32_t o : changedObjects) {
+		if (o >= objects.size()) { fullDirty = true; break; }
+		AABB box = lastBounds[o];
+		AABB now;
+		if (box.empty() || !objects[o]->boundingBox(now)) { fullDirty = true; break; }
+		box.expand(now);
+		changedBoxes.push_back(box);
+		Vec3 corners[8];
+		for (int c = 0; c < 8; ++c) corners[c] = box.corner(c);
+		// 包围盒跨过相机平面时无法得到有限的屏幕范围
+		if (!markProjected(corners, 8)) { fullDirty = true; break; }
+	}
+
+	// 2. 开启阴影时，旧/新包围盒沿光照方向扫出的阴影体：落在其中的表面点阴影可能改变
+	if (!fullDirty && toonParams.enableShadows && !changedBoxes.empty()) {
+		// 阴影只落在场景包围盒内的表面上；场景含无界对象时阴影体延伸到很远处
+		AABB sceneBox;
+		bool bounded = true;
+		for (const auto& obj : objects) {
+			AABB box;
+			if (!obj->boundingBox(box)) { bounded = false; break; }
+			sceneBox.expand(box);
+		}
+		const Vec3 away = light.direction.normalized();
+		for (const AABB& box : changedBoxes) {
+			AABB reachBox = sceneBox;
+			reachBox.expand(box);
+			const double reach = bounded ? (reachBox.max - reachBox.min).length() : 1e6 * (1.0 + (box.max - box.min).length());
+			Vec3 corners[16];
+			for (int c = 0; c < 8; ++c) {
+				corners[c] = box.corner(c);
+				corners[c + 8] = corners[c] + away * reach;
 			}
+			if (!markProjected(corners, 16)) { fullDirty = true; break; }
+		}
+	}
+	if (fullDirty) std::fill(dirtyTile.begin(), dirtyTile.end(), 1);
+
+	// 3. 用配置的可见性后端重新渲染脏分块：同一行连续的脏分块合并为一个矩形
+	std::vector<PixelRect> dirtyRects;
+	for (int ty = 0; ty < tilesY; ++ty) {
+		for (int tx = 0; tx < tilesX; ++tx) {
+			if (!dirtyTile[size_t(ty) * tilesX + tx]) continue;
+			int tx1 = tx;
+			while (tx1 + 1 < tilesX && dirtyTile[size_t(ty) * tilesX + tx1 + 1]) ++tx1;
+			dirtyRects.push_back(PixelRect(tx * kTile, ty * kTile, (tx1 + 1) * kTile, (ty + 1) * kTile)
+				.intersect(PixelRect(0, 0, width, height)));
+			tx = tx1;
+		}
+	}
+	// 光栅后端对本次全部脏矩形只建立、分箱一次，各矩形从同一结果读取可见性
+	std::unique_ptr<Rasterizer> raster;
+	if (options.visibility == VisibilityBackend::Raster && !dirtyRects.empty()) {
+		raster = std::make_unique<Rasterizer>(camera, width, height);
+		raster->rasterize(scene, dirtyRects);
+		std::cout << "Raster: " << raster->triangleCount() << " triangles, " << raster->binnedReferences()
+			<< " tile references, " << raster->fallbackObjects().size() << " ray-traced fallback objects\n";
+	}
+	long long retraced = 0;
+	for (const PixelRect& rect : dirtyRects) {
+		// 各后端对子区域的结果与整帧渲染的对应像素一致（网格与分块都固定在整帧原点上）
+		region = rect;
+		GBuffer part(rect);
+		if (raster) shadeRaster(*raster, scene, materials, toonParams, part);
+		else renderVisibility(scene, materials, toonParams, part);
+		for (int y = rect.y0; y < rect.y1; ++y) {
+			const size_t from = size_t(part.index(rect.x0, y)), to = size_t(lastRaw.index(rect.x0, y));
+			std::copy_n(part.color.begin() + from, rect.width(), lastRaw.color.begin() + to);
+			std::copy_n(part.depth.begin() + from, rect.width(), lastRaw.depth.begin() + to);
+			std::copy_n(part.normal.begin() + from, rect.width(), lastRaw.normal.begin() + to);
+			std::copy_n(part.objectId.begin() + from, rect.width(), lastRaw.objectId.begin() + to);
+			std::copy_n(part.materialId.begin() + from, rect.width(), lastRaw.materialId.begin() + to);
+			std::copy_n(part.outline.begin() + from, rect.width(), lastRaw.outline.begin() + to);
+		}
+		retraced += (long long)rect.width() * rect.height();
+	}
+	region = PixelRect(0, 0, width, height);
+	stats.pixelsShaded = retraced;
+	std::cout << "Incremental: re-rendered " << stats.pixelsShaded << " of " << stats.pixelsTotal << " pixels ("
+		<< std::count(dirtyTile.begin(), dirtyTile.end(), 1) << " of " << tilesX * tilesY << " tiles)\n";
 
-			int i = idx(x, y);
-			if (hitSomething) {
-				// View direction is from point to camera
-				Vec3 viewDir = ( - r.direction ).normalized();
-				Vec3 c = ToonShader::shade(closestHit, viewDir, light, toonParams);
-				colorBuffer[i] = c;
-				depthBuffer[i] = closestHit.t;
+	// 4. 后处理就地写入颜色与描边掩码，之后恢复 lastRaw 的原始值
+	if (options.enableSSAO || effectiveOutlineWidth() > 1.0) {
+		// SSAO 与描边加粗作用范围不局限于脏分块，整帧重做
+		std::vector<Vec3> rawColor = lastRaw.color;
+		std::vector<std::uint8_t> rawOutline = lastRaw.outline;
+		postprocessFrame(lastRaw, enableDepthEdges, depthEdgeThreshold);
+		lastOutput.swap(lastRaw.color);
+		lastRaw.color.swap(rawColor);
+		lastRaw.outline.swap(rawOutline);
+	}
+	else {
+		// 只在脏矩形（外扩1像素）上重跑描边；逐矩形处理后恢复，后续矩形的邻域读到的仍是原始颜色
+		Postprocess::Pipeline post = outlinePipeline(enableDepthEdges, depthEdgeThreshold);
+		std::vector<Vec3> rawColor;
+		std::vector<std::uint8_t> rawOutline;
+		for (const PixelRect& dirty : dirtyRects) {
+			const PixelRect rect = PixelRect(dirty.x0 - 1, dirty.y0 - 1, dirty.x1 + 1, dirty.y1 + 1)
+				.intersect(PixelRect(0, 0, width, height));
+			rawColor.clear();
+			rawOutline.clear();
+			for (int y = rect.y0; y < rect.y1; ++y) {
+				const int i = lastRaw.index(rect.x0, y);
+				rawColor.insert(rawColor.end(), lastRaw.color.begin() + i, lastRaw.color.begin() + i + rect.width());
+				rawOutline.insert(rawOutline.end(), lastRaw.outline.begin() + i, lastRaw.outline.begin() + i + rect.width());
 			}
-			else {
-				// Sky/background: flat color
-				colorBuffer[i] = Vec3(0.8, 0.9, 1.0) * 0.95;
-				depthBuffer[i] = INF;
+			post.run(lastRaw, rect);
+			for (int y = rect.y0; y < rect.y1; ++y) {
+				const int i = lastRaw.index(rect.x0, y);
+				const size_t k = size_t(y - rect.y0) * rect.width();
+				std::copy_n(lastRaw.color.begin() + i, rect.width(), lastOutput.begin() + i);
+				std::copy_n(rawColor.begin() + k, rect.width(), lastRaw.color.begin() + i);
+				std::copy_n(rawOutline.begin() + k, rect.width(), lastRaw.outline.begin() + i);
 			}
 		}
 	}
+
+	const bool written = writeImage(lastOutput, outputPath);
+	for (std::uint32_t o : changedObjects) {
+		if (o < objects.size() && !objects[o]->boundingBox(lastBounds[o])) lastBounds[o] = AABB();
+	}
+	return written;
+}
+
+bool Renderer::renderToSink(const std::vector<std::shared_ptr<Hittable>>& objects,
+	const MaterialTable& materials,
+	const ToonParams& toonParams,
+	VideoSink& sink,
+	bool enableDepthEdges,
+	double depthEdgeThreshold) {
+	// 复用上一帧的缓冲：尺寸不变时 resize 只重置内容，不重新分配
+	sinkFrame.resize(width, height);
+	renderFrame(objects, materials, toonParams, PixelRect(0, 0, width, height), sinkFrame);
+	postprocessFrame(sinkFrame, enableDepthEdges, depthEdgeThreshold);
+	return sink.writeFrame(sinkFrame.color);
+}
+
+bool Renderer::renderPartial(const std::vector<std::shared_ptr<Hittable>>& objects,
+	const MaterialTable& materials,
+	const ToonParams& toonParams,
+	const PixelRect& partRegion,
+	const std::string& partialPath) {
+	PixelRect r = partRegion.intersect(PixelRect(0, 0, width, height));
+	if (r.empty()) {
+		std::cerr << "Partial region is outside the " << width << "x" << height << " frame\n";
+		return false;
+	}
+	// 只分配分块大小的缓冲，渲染时仍使用整帧坐标
+	GBuffer part(r);
+	renderFrame(objects, materials, toonParams, r, part);
+	return FramePartial::write(partialPath, part, width, height);
+}
+
+bool Renderer::mergePartials(const std::vector<std::string>& partialPaths,
+	const std::string& outputPath,
+	bool enableDepthEdges,
+	double depthEdgeThreshold) {
+	GBuffer frame(width, height);
+	std::vector<std::uint8_t> covered(size_t(width) * height, 0);
+	for (const std::string& path : partialPaths) {
+		PixelRect r;
+		if (!FramePartial::read(path, frame, r)) return false;
+		for (int y = r.y0; y < r.y1; ++y) {
+			for (int x = r.x0; x < r.x1; ++x) covered[frame.index(x, y)] = 1;
+		}
+		std::cout << "Merged " << path << " [" << r.x0 << "," << r.y0 << " - " << r.x1 << "," << r.y1 << ")\n";
+	}
+	long long missing = 0;
+	for (std::uint8_t c : covered) missing += c ? 0 : 1;
+	if (missing > 0) {
+		std::cerr << "Merge: " << missing << " pixels are not covered by any partial\n";
+		return false;
+	}
+
+	// 在整帧上做后处理，描边与 SSAO 跨越分块边界
+	postprocessFrame(frame, enableDepthEdges, depthEdgeThreshold);
+	return writeImage(frame.color, outputPath);
+}
+
+bool Renderer::renderViews(const std::vector<std::shared_ptr<Hittable>>& objects,
+	const MaterialTable& materials,
+	const ToonParams& toonParams,
+	const std::vector<Camera>& cameras,
+	const std::vector<std::string>& outputPaths,
+	bool enableDepthEdges,
+	double depthEdgeThreshold) {
+	if (cameras.empty() || cameras.size() != outputPaths.size()) {
+		std::cerr << "renderViews: expected one output path per camera\n";
+		return false;
+	}
+	const Camera savedCamera = camera;
+	const PixelRect full(0, 0, width, height);
+	const int views = int(cameras.size());
+	std::vector<GBuffer> frames(views, GBuffer(width, height));
+
+	const bool sharedQueue = options.visibility == VisibilityBackend::RayTrace && !options.sparseShading && !options.wavefront;
+	if (sharedQueue) {
+		const std::vector<std::shared_ptr<Hittable>> scene = prepareFrame(objects, toonParams, full, cameras);
+		std::cout << "Rendering " << views << " views of " << width << "x" << height << "...\n";
+
+		// 所有视图的光源剔除分块进入同一个并行队列
+		const int tile = std::max(1, std::min(options.lightTileSize, std::max(width, height)));
+		const int tilesX = (width + tile - 1) / tile, tilesY = (height + tile - 1) / tile;
+		const int tilesPerView = tilesX * tilesY;
+		std::atomic<long long> lightTiles(0), tileLightRefs(0);
+		Parallel::forEach(0, views * tilesPerView, [&](int k) {
+			const int v = k / tilesPerView, t = k % tilesPerView;
+			const Camera& view = cameras[v];
+			const int tx = (t % tilesX) * tile, ty = (t / tilesX) * tile;
+			std::vector<PixelHit> hits;
+			std::vector<std::uint32_t> tileLights;
+			ShadeBatch shade;
+			long long lights = shadeTile(scene, materials, toonParams, frames[v],
+				PixelRect(tx, ty, tx + tile, ty + tile).intersect(full),
+				[&](int x, int y, PixelHit& h) {
+					h.ray = primaryRay(view, x, y);
+					h.hit = tracePrimary(scene, size_t(v), x, y, h.ray, h.rec, h.object);
+				}, hits, tileLights, shade);
+			if (lights >= 0) {
+				++lightTiles;
+				tileLightRefs += lights;
+			}
+		});
+		stats.pixelsTotal = (long long)views * width * height;
+		stats.pixelsShaded = stats.pixelsTotal;
+		stats.lightTiles = lightTiles.load();
+		stats.tileLightRefs = tileLightRefs.load();
+		std::cout << "Progress: 100%\n";
+	}
+	else {
+		// LOD 按全部视图选择一次，各视图看到同一组层级（逐视图准备时 LodLevel 保持不变）
+		const std::vector<std::shared_ptr<Hittable>> scene = selectLods(objects, cameras);
+		for (int v = 0; v < views; ++v) {
+			camera = cameras[v];
+			renderFrame(scene, materials, toonParams, full, frames[v]);
+		}
+	}
+
+	// 每个视图用自己的相机做后处理（SSAO 需要相机）
+	bool written = true;
+	for (int v = 0; v < views; ++v) {
+		camera = cameras[v];
+		postprocessFrame(frames[v], enableDepthEdges, depthEdgeThreshold);
+		if (!writeImage(frames[v].color, outputPaths[v])) {
+			written = false;
+			continue;
+		}
+		std::cout << "Wrote view " << v << ": " << outputPaths[v] << "\n";
+	}
+	camera = savedCamera;
+
+	hasLastFrame = false;
+	lastRaw = GBuffer();
+	lastOutput.clear();
+	return written;
+}
+
+bool Renderer::verifyRaster(const std::vector<std::shared_ptr<Hittable>>& objects,
+	const MaterialTable& materials,
+	const ToonParams& toonParams) {
+	const RenderOptions saved = options;
+	const PixelRect full(0, 0, width, height);
+	GBuffer traced(width, height), rasterized(width, height);
+	options.sparseShading = false;
+	options.wavefront = false;
+	options.visibility = VisibilityBackend::RayTrace;
+	renderFrame(objects, materials, toonParams, full, traced);
+	options.visibility = VisibilityBackend::Raster;
+	renderFrame(objects, materials, toonParams, full, rasterized);
+	options = saved;
+
+	long long idMismatches = 0, depthMismatches = 0;
+	double maxDepthError = 0.0;
+	for (size_t i = 0; i < traced.depth.size(); ++i) {
+		if (traced.objectId[i] != rasterized.objectId[i]) { ++idMismatches; continue; }
+		if (traced.depth[i] == rasterized.depth[i]) continue;
+		++depthMismatches;
+		maxDepthError = std::max(maxDepthError, std::fabs(traced.depth[i] - rasterized.depth[i]));
+	}
+	std::cout << "Verify raster: " << traced.depth.size() << " pixels, " << idMismatches << " object ID mismatches, "
+		<< depthMismatches << " depth mismatches (max error " << maxDepthError << ")\n";
+	return idMismatches == 0 && depthMismatches == 0;
+}
+
+void Renderer::renderFrame(const std::vector<std::shared_ptr<Hittable>>& objects,
+	const MaterialTable& materials,
+	const ToonParams& toonParams,
+	const PixelRect& frameRegion,
+	GBuffer& frame) {
+	const std::vector<std::shared_ptr<Hittable>> scene = prepareFrame(objects, toonParams, frameRegion);
+
+	if (region.width() == width && region.height() == height) {
+		std::cout << "Rendering " << width << "x" << height << " image...\n";
+	}
+	else {
+		std::cout << "Rendering region [" << region.x0 << "," << region.y0 << " - " << region.x1 << "," << region.y1
+			<< ") of " << width << "x" << height << " image...\n";
+	}
+	renderVisibility(scene, materials, toonParams, frame);
+	if (options.visibility != VisibilityBackend::Raster && options.sparseShading) {
+		std::cout << "Sparse shading: shaded " << stats.pixelsShaded << " samples, filled " << stats.pixelsFilled << " of "
+			<< stats.pixelsTotal << " pixels from cell corners ("
+			<< (100.0 * double(stats.pixelsFilled) / double(std::max(1LL, stats.pixelsTotal))) << "% of shade calls skipped)\n";
+	}
 	std::cout << "Progress: 100%\n";
+	if (!localLights.empty() && stats.lightTiles > 0) {
+		std::cout << "Light culling: " << localLights.size() << " local lights, "
+			<< double(stats.tileLightRefs) / double(stats.lightTiles) << " per tile on average\n";
+	}
+}
+
+void Renderer::renderVisibility(const std::vector<std::shared_ptr<Hittable>>& objects,
+	const MaterialTable& materials,
+	const ToonParams& toonParams,
+	GBuffer& frame) {
+	if (options.visibility == VisibilityBackend::Raster) {
+		renderRaster(objects, materials, toonParams, frame);
+	}
+	else if (options.sparseShading) {
+		renderSparse(objects, materials, toonParams, frame);
+	}
+	else if (options.wavefront) {
+		renderWavefront(objects, materials, toonParams, frame);
+	}
+	else {
+		renderDense(objects, materials, toonParams, frame);
+	}
+}
+
+std::vector<std::shared_ptr<Hittable>> Renderer::prepareFrame(const std::vector<std::shared_ptr<Hittable>>& objects,
+	const ToonParams& toonParams,
+	const PixelRect& frameRegion) {
+	return prepareFrame(objects, toonParams, frameRegion, std::vector<Camera>(1, camera));
+}
+
+std::vector<std::shared_ptr<Hittable>> Renderer::prepareFrame(const std::vector<std::shared_ptr<Hittable>>& objects,
+	const ToonParams& toonParams,
+	const PixelRect& frameRegion,
+	const std::vector<Camera>& lodViews) {
+	region = frameRegion;
+
+	std::vector<std::shared_ptr<Hittable>> scene = selectLods(objects, lodViews);
+
+	stats = RenderStats();
+	stats.pixelsTotal = (long long)region.width() * region.height();
 
-	if (enableDepthEdges) {
-		std::cout << "Applying depth edge detection...\n";
-		Postprocess::applyDepthEdgeOutline(colorBuffer, depthBuffer, width, height, depthEdgeThreshold, Vec3(0.8, 0.55, 0.14)); // Bright red outline
+	shaderKernel = ToonShader::Kernel(toonParams, light);
+	std::cout << "Shader variant: " << shaderKernel.name() << "\n";
+
+	allLightIndices.resize(localLights.size());
+	for (size_t l = 0; l < localLights.size(); ++l) allLightIndices[l] = std::uint32_t(l);
+
+	// 主光线分块候选表：只有逐像素追踪主光线的后端使用
+	viewCandidates.clear();
+	if (options.tileCulling && options.visibility == VisibilityBackend::RayTrace && !options.wavefront && !objects.empty()) {
+		auto start = std::chrono::steady_clock::now();
+		double refsPerRay = 0.0;
+		for (const Camera& view : lodViews) {
+			viewCandidates.push_back(binObjects(scene, view));
+			const TileCandidates& bins = viewCandidates.back();
+			// 按分块内像素数加权：边缘分块不满
+			for (int ty = 0; ty < bins.tilesY; ++ty) {
+				const int rows = std::min(height, (ty + 1) * bins.tileSize) - ty * bins.tileSize;
+				for (int tx = 0; tx < bins.tilesX; ++tx) {
+					const int cols = std::min(width, (tx + 1) * bins.tileSize) - tx * bins.tileSize;
+					const int t = ty * bins.tilesX + tx;
+					refsPerRay += double(bins.offsets[t + 1] - bins.offsets[t]) * rows * cols;
+				}
+			}
+		}
+		stats.candidatesPerRay = refsPerRay / (double(width) * height * double(lodViews.size()));
+		std::cout << "Tile culling: " << objects.size() << " objects, " << stats.candidatesPerRay
+			<< " candidates per primary ray, binned in "
+			<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms\n";
 	}
+	return scene;
+}
+
+Renderer::TileCandidates Renderer::binObjects(const std::vector<std::shared_ptr<Hittable>>& objects, const Camera& view) const {
+	TileCandidates bins;
+	bins.tileSize = std::max(1, options.tileCullingSize);
+	bins.tilesX = (width + bins.tileSize - 1) / bins.tileSize;
+	bins.tilesY = (height + bins.tileSize - 1) / bins.tileSize;
+	const int objectCount = int(objects.size());
+
+	// 1. 每个对象覆盖的分块范围 [x0, x1] x [y0, y1]（x0 > x1 表示不覆盖任何分块）
+	struct TileRange { int x0, y0, x1, y1; };
+	const TileRange everywhere = { 0, 0, bins.tilesX - 1, bins.tilesY - 1 };
+	std::vector<TileRange> ranges(objects.size());
+	Parallel::forEach(0, objectCount, [&](int o) {
+		TileRange& range = ranges[o];
+		range = { 0, 0, -1, -1 };
+		AABB box;
+		if (!objects[o]->boundingBox(box)) { range = everywhere; return; }
+		if (box.empty()) return;
+		// 主光线上的点满足 s = t > 0；包围盒完全在相机平面后方时不可能被击中，
+		// 跨过相机平面时投影范围无界，保守地放入所有分块
+		double xMin = std::numeric_limits<double>::infinity(), xMax = -xMin, yMin = xMin, yMax = -xMin;
+		int behind = 0;
+		for (int c = 0; c < 8; ++c) {
+			double u, v, sDepth;
+			if (!view.project(box.corner(c), u, v, sDepth)) { ++behind; continue; }
+			const double px = u * width - 0.5, py = (1.0 - v) * height - 0.5;
+			xMin = std::min(xMin, px); xMax = std::max(xMax, px);
+			yMin = std::min(yMin, py); yMax = std::max(yMax, py);
+		}
+		if (behind == 8) return;
+		if (behind > 0) { range = everywhere; return; }
+		// 像素中心坐标下的投影范围，外扩一个像素吸收舍入误差
+		if (xMax < -1.0 || yMax < -1.0 || xMin > width || yMin > height) return;
+		const int ix0 = std::max(0, int(std::floor(xMin)) - 1), ix1 = std::min(width - 1, int(std::ceil(xMax)) + 1);
+		const int iy0 = std::max(0, int(std::floor(yMin)) - 1), iy1 = std::min(height - 1, int(std::ceil(yMax)) + 1);
+		if (ix0 > ix1 || iy0 > iy1) return;
+		range = { ix0 / bins.tileSize, iy0 / bins.tileSize, ix1 / bins.tileSize, iy1 / bins.tileSize };
+	}, 256);
+
+	// 2. 按分块行并行计数、前缀和、再按对象下标顺序填充（结果与线程数无关）
+	const size_t tiles = size_t(bins.tilesX) * bins.tilesY;
+	bins.offsets.assign(tiles + 1, 0);
+	Parallel::forEach(0, bins.tilesY, [&](int ty) {
+		std::uint32_t* count = bins.offsets.data() + 1 + size_t(ty) * bins.tilesX;
+		for (const TileRange& range : ranges) {
+			if (ty < range.y0 || ty > range.y1) continue;
+			for (int tx = range.x0; tx <= range.x1; ++tx) ++count[tx];
+		}
+	});
+	for (size_t t = 0; t < tiles; ++t) bins.offsets[t + 1] += bins.offsets[t];
+	bins.refs.resize(bins.offsets[tiles]);
+	Parallel::forEach(0, bins.tilesY, [&](int ty) {
+		std::vector<std::uint32_t> cursor(bins.offsets.begin() + size_t(ty) * bins.tilesX,
+			bins.offsets.begin() + size_t(ty + 1) * bins.tilesX);
+		for (int o = 0; o < objectCount; ++o) {
+			const TileRange& range = ranges[o];
+			if (ty < range.y0 || ty > range.y1) continue;
+			for (int tx = range.x0; tx <= range.x1; ++tx) bins.refs[cursor[tx]++] = std::uint32_t(o);
+		}
+	});
+	return bins;
+}
 
-	writePPM(colorBuffer, outputPath);
-	return true;
+bool Renderer::tracePrimary(const std::vector<std::shared_ptr<Hittable>>& objects, size_t view, int x, int y,
+	const Ray& r, HitRecord& closestHit, size_t& hitObject) const {
+	if (view >= viewCandidates.size()) return traceClosest(objects, r, closestHit, hitObject);
+	const TileCandidates& bins = viewCandidates[view];
+	const size_t t = size_t(y / bins.tileSize) * bins.tilesX + x / bins.tileSize;
+	return traceClosest(objects, bins.refs.data() + bins.offsets[t], bins.offsets[t + 1] - bins.offsets[t],
+		r, closestHit, hitObject);
 }
 
-void Renderer::writePPM(const std::vector<Vec3>& colors, const std::string& path) const {
-	std::ofstream out(path, std::ios::binary);
-	if (!out.is_open()) {
-		std::cerr << "Failed to open output PPM: " << path << "\n";
-		return;
+int Renderer::renderProgressive(const std::vector<std::shared_ptr<Hittable>>& objects,
+	const MaterialTable& materials,
+	const ToonParams& toonParams,
+	const std::string& outputPath,
+	bool enableDepthEdges,
+	double depthEdgeThreshold,
+	double timeBudgetSeconds,
+	const std::function<void(int step, const GBuffer& preview)>& onLevel) {
+	using Clock = std::chrono::steady_clock;
+	const Clock::time_point startTime = Clock::now();
+	auto elapsed = [&startTime]() { return std::chrono::duration<double>(Clock::now() - startTime).count(); };
+
+	const std::vector<std::shared_ptr<Hittable>> scene = prepareFrame(objects, toonParams, PixelRect(0, 0, width, height));
+	if (options.visibility != VisibilityBackend::RayTrace || options.sparseShading || options.wavefront) {
+		std::cout << "Progressive: tracing per pixel; raster, sparse and wavefront options do not apply\n";
 	}
-	out << "P3\n" << width << " " << height << "\n255\n";
-	for (int i = 0; i < width * height; ++i) {
-		Vec3 c = Vec3::clamp01(colors[i]);
-		int ir = static_cast<int>(255.999 * c.x);
-		int ig = static_cast<int>(255.999 * c.y);
-		int ib = static_cast<int>(255.999 * c.z);
-		out << ir << " " << ig << " " << ib << "\n";
+
+	GBuffer frame(width, height);
+	// 每个像素是否已追踪：粗层级的样本在细层级中直接复用
+	std::vector<std::uint8_t> traced(size_t(width) * height, 0);
+	long long shaded = 0;
+	int finestStep = 0;
+
+	for (int step = 8; step >= 1; step /= 2) {
+		// 第一层总是完成，保证至少有一张预览；之后超出预算即停止
+		const bool firstLevel = finestStep == 0;
+		if (!firstLevel && elapsed() >= timeBudgetSeconds) break;
+
+		std::atomic<bool> expired(false);
+		std::atomic<long long> levelShaded(0);
+		const int rows = (height + step - 1) / step;
+		Parallel::forEach(0, rows, [&](int row) {
+			if (!firstLevel && (expired.load() || elapsed() >= timeBudgetSeconds)) { expired = true; return; }
+			const int y = row * step;
+			long long count = 0;
+			for (int x = 0; x < width; x += step) {
+				int i = frame.index(x, y);
+				if (traced[i]) continue;
+				PixelSample sample = tracePixel(scene, materials, toonParams, x, y);
+				storeSample(frame, i, sample);
+				traced[i] = 1;
+				++count;
+
+				// 样本复制到本层级的块内尚未追踪的像素，作为预览
+				if (step > 1) {
+					for (int by = y; by < std::min(height, y + step); ++by) {
+						for (int bx = x; bx < std::min(width, x + step); ++bx) {
+							int j = frame.index(bx, by);
+							if (!traced[j]) storeSample(frame, j, sample);
+						}
+					}
+				}
+			}
+			levelShaded += count;
+		});
+		shaded += levelShaded.load();
+		if (!expired.load()) finestStep = step;
+
+		// 预览：在帧缓冲副本上做后处理，保留原始样本供下一层级复用
+		GBuffer preview = frame;
+		postprocessFrame(preview, enableDepthEdges, depthEdgeThreshold);
+		if (!writeImage(preview.color, outputPath)) return 0;
+		std::cout << "Progressive: 1/" << step << " resolution" << (expired.load() ? " (partial)" : "")
+			<< " after " << elapsed() << " s, wrote " << outputPath << "\n";
+		if (onLevel) onLevel(step, preview);
+		if (expired.load()) break;
 	}
+	stats.pixelsShaded = shaded;
+	return finestStep;
 }
 
+Postprocess::Pipeline Renderer::outlinePipeline(bool enableDepthEdges, double depthEdgeThreshold) const {
+	Postprocess::Pipeline post;
+	if (enableDepthEdges) post.add(std::make_shared<Postprocess::DepthSobelEdge>(depthEdgeThreshold, kOutlineColor));
+	if (options.enableNormalEdges) post.add(std::make_shared<Postprocess::NormalEdge>(options.normalEdgeAngle, kOutlineColor));
+	if (options.enableMaterialEdges) post.add(std::make_shared<Postprocess::IdEdge>(Postprocess::IdEdge::Channel::Material, kOutlineColor));
+	if (options.enableObjectEdges) post.add(std::make_shared<Postprocess::IdEdge>(Postprocess::IdEdge::Channel::Object, kOutlineColor));
+	return post;
+}
+
+double Renderer::effectiveOutlineWidth() const {
+	return options.outlineWidthFraction > 0.0 ? options.outlineWidthFraction * height : options.outlineWidth;
+}
+
+void Renderer::postprocessFrame(GBuffer& frame, bool enableDepthEdges, double depthEdgeThreshold) const {
+	if (options.enableSSAO) {
+		std::cout << "Applying SSAO...\n";
+		Postprocess::applySSAO(frame, camera, options.ssao);
+	}
+
+	// 所有描边检测在一遍融合扫描中完成
+	Postprocess::Pipeline post = outlinePipeline(enableDepthEdges, depthEdgeThreshold);
+	if (!post.empty()) {
+		std::cout << "Applying edge detection...\n";
+		post.run(frame);
+	}
 
+	double outlineWidth = effectiveOutlineWidth();
+	if (outlineWidth > 1.0) {
+		std::cout << "Thickening outlines to " << outlineWidth << " px...\n";
+		Postprocess::thickenOutlines(frame, outlineWidth);
+	}
+}
+
+Ray Renderer::primaryRay(int x, int y) const {
+	return primaryRay(camera, x, y);
+}
+
+Ray Renderer::primaryRay(const Camera& view, int x, int y) const {
+	double u = (double(x) + 0.5) / double(width);
+	double v = (double(y) + 0.5) / double(height);
+	return view.get_ray(u, 1.0 - v); // flip v so image isn't upside down
+}
+
+bool Renderer::traceClosest(const std::vector<std::shared_ptr<Hittable>>& objects, const Ray& r,
+	HitRecord& closestHit, size_t& hitObject) {
+	double t_min = 1e-4;
+	double t_max = std::numeric_limits<double>::infinity();
+	bool hitSomething = false;
+	// 三角形求交的逐光线预计算只做一次，所有对象共用
+	const TriangleRay tray(r);
+	for (size_t o = 0; o < objects.size(); ++o) {
+		HitRecord rec;
+		if (objects[o]->hitPrepared(r, tray, t_min, t_max, rec)) {
+			hitSomething = true;
+			t_max = rec.t;
+			closestHit = rec;
+			hitObject = o;
+		}
+	}
+	return hitSomething;
+}
+
+bool Renderer::traceClosest(const std::vector<std::shared_ptr<Hittable>>& objects,
+	const std::uint32_t* candidates, size_t count, const Ray& r,
+	HitRecord& closestHit, size_t& hitObject) {
+	double t_min = 1e-4;
+	double t_max = std::numeric_limits<double>::infinity();
+	bool hitSomething = false;
+	const TriangleRay tray(r);
+	for (size_t k = 0; k < count; ++k) {
+		const size_t o = candidates[k];
+		HitRecord rec;
+		if (objects[o]->hitPrepared(r, tray, t_min, t_max, rec)) {
+			hitSomething = true;
+			t_max = rec.t;
+			closestHit = rec;
+			hitObject = o;
+		}
+	}
+	return hitSomething;
+}
+
+bool Renderer::occludedAny(const std::vector<std::shared_ptr<Hittable>>& objects, const Ray& r, double t_min, double t_max) {
+	const TriangleRay tray(r);
+	for (const auto& obj : objects) {
+		if (obj->occludedPrepared(r, tray, t_min, t_max)) return true;
+	}
+	return false;
+}
+
+Renderer::PixelSample Renderer::shadeHit(const Ray& r, bool hitSomething, HitRecord& closestHit, size_t hitObject,
+	const std::vector<std::shared_ptr<Hittable>>& objects,
+	const MaterialTable& materials,
+	const ToonParams& toonParams,
+	const std::vector<std::uint32_t>& lightList) const {
+	if (!hitSomething) {
+		// Sky/background: flat color
+		PixelSample sample;
+		sample.color = kBackgroundColor;
+		sample.depth = std::numeric_limits<double>::infinity();
+		return sample;
+	}
+
+	return shadeSurface(r, closestHit, hitObject, materials, toonParams, shadowed(objects, closestHit, toonParams), lightList);
+}
+
+bool Renderer::shadowed(const std::vector<std::shared_ptr<Hittable>>& objects, const HitRecord& rec,
+	const ToonParams& toonParams) const {
+	// 阴影光线：背光面本来就在最暗色带，只对朝向光源的点做遮挡查询
+	if (!toonParams.enableShadows) return false;
+	Vec3 L = (-light.direction).normalized();
+	if (Vec3::dot(rec.normal, L) <= 0.0) return false;
+	Ray shadowRay(rec.point + rec.normal * toonParams.shadowBias, L);
+	return occludedAny(objects, shadowRay, 1e-4, std::numeric_limits<double>::infinity());
+}
+
+void Renderer::setShade(ShadeBatch& batch, size_t k, const Ray& r, HitRecord& rec, size_t hitObject, int pixel,
+	bool inShadow, const MaterialTable& materials) const {
+	ToonShadeInput& in = batch.inputs[k];
+	in.material = &materials[rec.materialId];
+	// 逐图元颜色（点云）：用覆盖了反照率的材质副本着色
+	if (rec.albedoRGB != HitRecord::kNoAlbedo) {
+		Material& colored = batch.colored[k];
+		colored = *in.material;
+		colored.albedo = Vec3(double((rec.albedoRGB >> 16) & 0xFF),
+			double((rec.albedoRGB >> 8) & 0xFF), double(rec.albedoRGB & 0xFF)) * (1.0 / 255.0);
+		in.material = &colored;
+	}
+	in.normal = rec.normal;
+	in.viewDir = (-r.direction).normalized();
+	in.inShadow = inShadow;
+	batch.records[k] = &rec;
+	batch.objects[k] = std::uint32_t(hitObject);
+	batch.pixels[k] = pixel;
+}
+
+void Renderer::flushShade(ShadeBatch& batch, size_t begin, size_t end, const ToonParams& toonParams,
+	const std::vector<std::uint32_t>& lightList, GBuffer& frame) const {
+	if (end <= begin) return;
+	shaderKernel.shade(batch.inputs.data() + begin, end - begin, batch.colors.data() + begin, batch.infos.data() + begin);
+	for (size_t k = begin; k < end; ++k) {
+		HitRecord& rec = *batch.records[k];
+		PixelSample sample;
+		sample.hit = true;
+		sample.color = batch.colors[k];
+		sample.info = batch.infos[k];
+		// 局部光源叠加在色带结果上；轮廓像素保持纯描边色
+		if (!lightList.empty() && !sample.info.silhouette) {
+			rec.material = batch.inputs[k].material;
+			sample.color = Vec3::clamp01(sample.color
+				+ ToonShader::shadeLocalLights(rec, localLights, lightList.data(), lightList.size(), toonParams));
+		}
+		sample.depth = rec.t;
+		sample.normal = rec.normal;
+		sample.objectId = batch.objects[k];
+		sample.materialId = rec.materialId;
+		storeSample(frame, batch.pixels[k], sample);
+	}
+}
+
+Renderer::PixelSample Renderer::shadeSurface(const Ray& r, HitRecord& closestHit, size_t hitObject,
+	const MaterialTable& materials,
+	const ToonParams& toonParams,
+	bool inShadow,
+	const std::vector<std::uint32_t>& lightList) const {
+	PixelSample sample;
+	closestHit.material = &materials[closestHit.materialId];
+	// 逐图元颜色（点云）：用覆盖了反照率的材质副本着色，返回前恢复材质表指针
+	Material colored;
+	if (closestHit.albedoRGB != HitRecord::kNoAlbedo) {
+		colored = *closestHit.material;
+		colored.albedo = Vec3(double((closestHit.albedoRGB >> 16) & 0xFF),
+			double((closestHit.albedoRGB >> 8) & 0xFF), double(closestHit.albedoRGB & 0xFF)) * (1.0 / 255.0);
+		closestHit.material = &colored;
+	}
+	// View direction is from point to camera
+	Vec3 viewDir = ( - r.direction ).normalized();
+
+	sample.hit = true;
+	sample.color = shaderKernel.shade(closestHit, viewDir, inShadow, &sample.info);
+	// 局部光源叠加在色带结果上；轮廓像素保持纯描边色
+	if (!lightList.empty() && !sample.info.silhouette) {
+		sample.color = Vec3::clamp01(sample.color
+			+ ToonShader::shadeLocalLights(closestHit, localLights, lightList.data(), lightList.size(), toonParams));
+	}
+	sample.depth = closestHit.t;
+	sample.normal = closestHit.normal;
+	sample.objectId = std::uint32_t(hitObject);
+	sample.materialId = closestHit.materialId;
+	closestHit.material = &materials[closestHit.materialId];
+	return sample;
+}
+
+Renderer::PixelSample Renderer::tracePixel(const std::vector<std::shared_ptr<Hittable>>& objects,
+	const MaterialTable& materials,
+	const ToonParams& toonParams,
+	int x, int y) const {
+	Ray r = primaryRay(x, y);
+	HitRecord closestHit;
+	size_t hitObject = 0;
+	bool hitSomething = tracePrimary(objects, 0, x, y, r, closestHit, hitObject);
+	return shadeHit(r, hitSomething, closestHit, hitObject, objects, materials, toonParams, allLightIndices);
+}
+
+void Renderer::cullLights(const Vec3& lo, const Vec3& hi, std::vector<std::uint32_t>& out) const {
+	out.clear();
+	for (size_t l = 0; l < localLights.size(); ++l) {
+		const LocalLight& light = localLights[l];
+		// 光源到包围盒的最近距离
+		const Vec3& p = light.position;
+		double dx = std::max(0.0, std::max(lo.x - p.x, p.x - hi.x));
+		double dy = std::max(0.0, std::max(lo.y - p.y, p.y - hi.y));
+		double dz = std::max(0.0, std::max(lo.z - p.z, p.z - hi.z));
+		if (dx * dx + dy * dy + dz * dz < light.range * light.range) out.push_back(std::uint32_t(l));
+	}
+}
+
+void Renderer::shadeTiled(const std::vector<std::shared_ptr<Hittable>>& objects,
+	const MaterialTable& materials,
+	const ToonParams& toonParams,
+	GBuffer& frame,
+	const std::function<void(int x, int y, PixelHit& out)>& resolve) {
+	const int tile = std::max(1, std::min(options.lightTileSize, std::max(width, height)));
+	std::vector<PixelHit> hits(size_t(std::min(tile, width)) * std::min(tile, height));
+	std::vector<std::uint32_t> tileLights;
+	ShadeBatch shade;
+
+	// 分块网格固定在整帧原点上，渲染区域只裁剪分块
+	int nextProgress = region.y0;
+	for (int ty = region.y0 / tile * tile; ty < region.y1; ty += tile) {
+		if (ty >= nextProgress) {
+			std::cout << "Progress: " << ((std::max(ty, region.y0) - region.y0) * 100 / std::max(1, region.height())) << "%\n";
+			nextProgress += 50;
+		}
+		for (int tx = region.x0 / tile * tile; tx < region.x1; tx += tile) {
+			PixelRect rect = PixelRect(tx, ty, tx + tile, ty + tile).intersect(region);
+			long long lights = shadeTile(objects, materials, toonParams, frame, rect, resolve, hits, tileLights, shade);
+			if (lights >= 0) {
+				++stats.lightTiles;
+				stats.tileLightRefs += lights;
+			}
+		}
+	}
+	stats.pixelsShaded = (long long)region.width() * region.height();
+}
+
+long long Renderer::shadeTile(const std::vector<std::shared_ptr<Hittable>>& objects,
+	const MaterialTable& materials,
+	const ToonParams& toonParams,
+	GBuffer& frame,
+	const PixelRect& tileRect,
+	const std::function<void(int x, int y, PixelHit& out)>& resolve,
+	std::vector<PixelHit>& hits,
+	std::vector<std::uint32_t>& tileLights,
+	ShadeBatch& shade) const {
+	const double INF = std::numeric_limits<double>::infinity();
+	const int x0 = tileRect.x0, y0 = tileRect.y0, x1 = tileRect.x1, y1 = tileRect.y1;
+	const int stride = tileRect.width();
+	if (hits.size() < size_t(stride) * tileRect.height()) hits.resize(size_t(stride) * tileRect.height());
+
+	// 1. 块内可见性，同时累计击中点的世界空间包围盒
+	Vec3 lo(INF, INF, INF), hi(-INF, -INF, -INF);
+	bool anyHit = false;
+	for (int y = y0; y < y1; ++y) {
+		for (int x = x0; x < x1; ++x) {
+			PixelHit& h = hits[(y - y0) * stride + (x - x0)];
+			h = PixelHit();
+			resolve(x, y, h);
+			if (!h.hit) continue;
+			anyHit = true;
+			const Vec3& p = h.rec.point;
+			lo = Vec3(std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z));
+			hi = Vec3(std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z));
+		}
+	}
+
+	// 2. 按块剔除局部光源
+	tileLights.clear();
+	long long culled = -1;
+	if (anyHit && !localLights.empty()) {
+		cullLights(lo, hi, tileLights);
+		culled = (long long)tileLights.size();
+	}
+
+	// 3. 阴影查询后，块内全部击中整批调用一次着色内核，只用本块的光源列表
+	shade.resize(size_t(stride) * tileRect.height());
+	size_t queued = 0;
+	for (int y = y0; y < y1; ++y) {
+		for (int x = x0; x < x1; ++x) {
+			PixelHit& h = hits[(y - y0) * stride + (x - x0)];
+			if (!h.hit) {
+				storeSample(frame, frame.index(x, y), shadeHit(h.ray, false, h.rec, h.object, objects, materials, toonParams, tileLights));
+				continue;
+			}
+			setShade(shade, queued++, h.ray, h.rec, h.object, frame.index(x, y), shadowed(objects, h.rec, toonParams), materials);
+		}
+	}
+	flushShade(shade, 0, queued, toonParams, tileLights, frame);
+	return culled;
+}
+
+void Renderer::renderDense(const std::vector<std::shared_ptr<Hittable>>& objects,
+	const MaterialTable& materials,
+	const ToonParams& toonParams,
+	GBuffer& frame) {
+	shadeTiled(objects, materials, toonParams, frame, [&](int x, int y, PixelHit& h) {
+		h.ray = primaryRay(x, y);
+		h.hit = tracePrimary(objects, 0, x, y, h.ray, h.rec, h.object);
+	});
+}
+
+void Renderer::renderSparse(const std::vector<std::shared_ptr<Hittable>>& objects,
+	const MaterialTable& materials,
+	const ToonParams& toonParams,
+	GBuffer& frame) {
+	const int cell = std::max(1, options.sparseCellSize);
+
+	// 网格角点坐标：0, cell, 2*cell, ..., 最后一行/列
+	auto gridCoords = [cell](int extent) {
+		std::vector<int> coords;
+		for (int c = 0; c < extent - 1; c += cell) coords.push_back(c);
+		coords.push_back(std::max(0, extent - 1));
+		return coords;
+	};
+	const std::vector<int> gx = gridCoords(width);
+	const std::vector<int> gy = gridCoords(height);
+
+	// 与渲染区域相交的单元范围 [begin, end)；网格固定在整帧原点上，分块渲染与整帧结果一致
+	const size_t cellsX = std::max<size_t>(1, gx.size() - 1);
+	const size_t cellsY = std::max<size_t>(1, gy.size() - 1);
+	auto cellRange = [](const std::vector<int>& g, size_t cells, int lo, int hi, size_t& begin, size_t& end) {
+		begin = 0;
+		while (begin + 1 < cells && g[begin + 1] < lo) ++begin;
+		end = begin;
+		while (end < cells && g[end] < hi) ++end;
+	};
+	size_t ib, ie, jb, je;
+	cellRange(gx, cellsX, region.x0, region.x1, ib, ie);
+	cellRange(gy, cellsY, region.y0, region.y1, jb, je);
+
+	// 角点：完整样本，外加不含局部光源的色带颜色与击中点（供单元内插值）
+	struct Corner {
+		PixelSample sample;
+		Vec3 base;
+		Vec3 point;
+		bool fillable = true;   // 逐图元颜色（点云）无法插值
+	};
+	const std::vector<std::uint32_t> noLights;
+	std::atomic<long long> shaded(0), filled(0);
+
+	// 1. 追踪这些单元的所有角点（按行并行）
+	std::vector<Corner> corners(gx.size() * gy.size());
+	const size_t ci1 = std::min(ie, gx.size() - 1), cj1 = std::min(je, gy.size() - 1);
+	Parallel::forEach(int(jb), int(cj1) + 1, [&](int j) {
+		for (size_t i = ib; i <= ci1; ++i) {
+			const int x = gx[i], y = gy[j];
+			Corner& c = corners[size_t(j) * gx.size() + i];
+			Ray r = primaryRay(x, y);
+			HitRecord rec;
+			size_t hitObject = 0;
+			const bool hit = tracePrimary(objects, 0, x, y, r, rec, hitObject);
+			c.sample = shadeHit(r, hit, rec, hitObject, objects, materials, toonParams, noLights);
+			c.base = c.sample.color;
+			c.point = rec.point;
+			c.fillable = !hit || rec.albedoRGB == HitRecord::kNoAlbedo;
+			if (hit && !localLights.empty() && !c.sample.info.silhouette) {
+				// 与 tracePixel 相同：局部光源叠加在色带颜色上；点云重新着色以使用逐点反照率
+				if (c.fillable) {
+					c.sample.color = Vec3::clamp01(c.base
+						+ ToonShader::shadeLocalLights(rec, localLights, allLightIndices.data(), allLightIndices.size(), toonParams));
+				}
+				else {
+					c.sample = shadeSurface(r, rec, hitObject, materials, toonParams, c.sample.info.shadowed, allLightIndices);
+				}
+			}
+			if (region.contains(x, y)) storeSample(frame, frame.index(x, y), c.sample);
+			++shaded;
+		}
+	});
+
+	// 角点是否属于同一平坦区域
+	auto sameRegion = [this](const Corner& ca, const Corner& cb) {
+		const PixelSample& a = ca.sample;
+		const PixelSample& b = cb.sample;
+		if (a.hit != b.hit) return false;
+		if (!a.hit) return true;
+		if (!ca.fillable || !cb.fillable) return false;
+		if (a.objectId != b.objectId || a.materialId != b.materialId) return false;
+		if (a.info.silhouette != b.info.silhouette) return false;
+		if (a.info.rampSegment != b.info.rampSegment) return false;
+		if (a.info.specularLevel != b.info.specularLevel) return false;
+		if (a.info.shadowed != b.info.shadowed) return false;
+		return std::fabs(a.depth - b.depth) <= options.sparseDepthTolerance * std::min(a.depth, b.depth);
+	};
+
+	// 平坦单元内的像素：色带、高光级别与阴影由角点确定，颜色、深度、法线和击中点双线性插值，
+	// 不调用着色内核；只有局部光源（逐像素硬边色带）按插值后的击中点计算
+	auto fill = [&](const Corner* const c[4], double u, double v) {
+		const PixelSample& c00 = c[0]->sample;
+		if (!c00.hit) return c00;  // 背景为常量
+		const double w00 = (1.0 - u) * (1.0 - v), w10 = u * (1.0 - v), w01 = (1.0 - u) * v, w11 = u * v;
+		PixelSample s = c00;
+		s.color = c[0]->base * w00 + c[1]->base * w10 + c[2]->base * w01 + c[3]->base * w11;
+		s.depth = c00.depth * w00 + c[1]->sample.depth * w10 + c[2]->sample.depth * w01 + c[3]->sample.depth * w11;
+		Vec3 n = c00.normal * w00 + c[1]->sample.normal * w10 + c[2]->sample.normal * w01 + c[3]->sample.normal * w11;
+		s.normal = n.length_squared() > 0.0 ? n.normalized() : c00.normal;
+		if (!localLights.empty() && !s.info.silhouette) {
+			HitRecord rec;
+			rec.point = c[0]->point * w00 + c[1]->point * w10 + c[2]->point * w01 + c[3]->point * w11;
+			rec.normal = s.normal;
+			rec.material = &materials[s.materialId];
+			s.color = Vec3::clamp01(s.color
+				+ ToonShader::shadeLocalLights(rec, localLights, allLightIndices.data(), allLightIndices.size(), toonParams));
+		}
+		return s;
+	};
+
+	// 2. 逐单元（按单元行并行）：平坦则由角点填充，否则逐像素追踪。每个单元负责 [x0, x1) x [y0, y1)，
+	// 最后一列/行的单元再负责右/下边，相邻单元互不重叠；角点已在第1步写入
+	Parallel::forEach(int(jb), int(je), [&](int j) {
+		const size_t j1 = std::min(size_t(j) + 1, gy.size() - 1);
+		long long rowShaded = 0, rowFilled = 0;
+		for (size_t i = ib; i < ie; ++i) {
+			const size_t i1 = std::min(i + 1, gx.size() - 1);
+			const Corner* c[4] = {
+				&corners[size_t(j) * gx.size() + i], &corners[size_t(j) * gx.size() + i1],
+				&corners[j1 * gx.size() + i], &corners[j1 * gx.size() + i1] };
+			const bool uniform = sameRegion(*c[0], *c[1]) && sameRegion(*c[0], *c[2]) && sameRegion(*c[0], *c[3])
+				&& sameRegion(*c[1], *c[3]) && sameRegion(*c[2], *c[3]) && sameRegion(*c[1], *c[2]);
+
+			const int x0 = gx[i], x1 = gx[i1], y0 = gy[j], y1 = gy[j1];
+			const int xEnd = (i + 1 == cellsX || x1 == x0) ? x1 : x1 - 1;
+			const int yEnd = (size_t(j) + 1 == cellsY || y1 == y0) ? y1 : y1 - 1;
+			for (int y = std::max(y0, region.y0); y <= std::min(yEnd, region.y1 - 1); ++y) {
+				for (int x = std::max(x0, region.x0); x <= std::min(xEnd, region.x1 - 1); ++x) {
+					if ((x == x0 || x == x1) && (y == y0 || y == y1)) continue;
+					if (!uniform) {
+						storeSample(frame, frame.index(x, y), tracePixel(objects, materials, toonParams, x, y));
+						++rowShaded;
+						continue;
+					}
+					const double u = x1 > x0 ? double(x - x0) / double(x1 - x0) : 0.0;
+					const double v = y1 > y0 ? double(y - y0) / double(y1 - y0) : 0.0;
+					storeSample(frame, frame.index(x, y), fill(c, u, v));
+					++rowFilled;
+				}
+			}
+		}
+		shaded += rowShaded;
+		filled += rowFilled;
+	});
+	stats.pixelsShaded = shaded.load();
+	stats.pixelsFilled = filled.load();
+}
+
+void Renderer::renderWavefront(const std::vector<std::shared_ptr<Hittable>>& objects,
+	const MaterialTable& materials,
+	const ToonParams& toonParams,
+	GBuffer& frame) {
+	const double INF = std::numeric_limits<double>::infinity();
+	const double t_min = 1e-4;
+	const std::uint32_t kMiss = GBuffer::kNoId;
+	const int kChunk = 256;  // 并行求交时每个任务的光线数
+	const int regionWidth = region.width();
+	const int pixels = regionWidth * region.height();
+	const int batch = std::max(1, std::min(options.wavefrontBatchSize, pixels));
+	const Vec3 L = (-light.direction).normalized();
+
+	RayStream primary, shadow;
+	primary.reserve(batch);
+	std::vector<HitRecord> records;
+	std::vector<double> tMax;
+	std::vector<std::uint32_t> hitObject;
+	std::vector<std::uint32_t> hits;
+	std::vector<char> inShadow, blocked;
+	ShadeBatch shade;
+
+	int nextProgress = 0;
+	for (int start = 0; start < pixels; start += batch) {
+		if (start >= nextProgress) {
+			std::cout << "Progress: " << (int)((long long)start * 100 / pixels) << "%\n";
+			nextProgress += 50 * regionWidth;
+		}
+		const int end = std::min(pixels, start + batch);
+
+		// 1. 生成：整批主光线写入 SoA 光线流
+		primary.clear();
+		for (int p = start; p < end; ++p) {
+			int x = region.x0 + p % regionWidth, y = region.y0 + p / regionWidth;
+			primary.push(primaryRay(x, y), std::uint32_t(frame.index(x, y)));
+		}
+		if (options.wavefrontSortRays) primary.sortForCoherence();
+		// 三角形求交的逐光线预计算只做一次，整批光线与所有对象（三角形与网格）共用
+		primary.prepareTriangleRays();
+
+		// 2. 求交：对象在外层循环，同一对象的数据与代码在整段光线上保持热；此阶段只记录 t 与对象
+		const int n = int(primary.size());
+		tMax.assign(n, INF);
+		hitObject.assign(n, kMiss);
+		Parallel::forEach(0, (n + kChunk - 1) / kChunk, [&](int c) {
+			const int b = c * kChunk, e = std::min(n, b + kChunk);
+			for (size_t o = 0; o < objects.size(); ++o) {
+				objects[o]->hitStream(primary, b, e, t_min, tMax.data(), hitObject.data(), std::uint32_t(o));
+			}
+		});
+
+		// 3. 压缩：只保留击中的光线，未击中直接写背景；击中记录由最近对象重新求交得到
+		hits.clear();
+		for (int i = 0; i < n; ++i) {
+			if (hitObject[i] != kMiss) { hits.push_back(std::uint32_t(i)); continue; }
+			PixelSample sky;
+			sky.color = kBackgroundColor;
+			sky.depth = INF;
+			storeSample(frame, int(primary.pixel[i]), sky);
+		}
+		records.resize(n);
+		Parallel::forEach(0, int(hits.size()), [&](int k) {
+			std::uint32_t i = hits[k];
+			objects[hitObject[i]]->hitPrepared(primary.ray(i), primary.triangleRays[i], t_min, std::nextafter(tMax[i], INF), records[i]);
+		}, 256);
+
+		// 4. 阴影：朝向光源的击中点组成阴影光线流，逐对象做遮挡查询
+		inShadow.assign(n, 0);
+		if (toonParams.enableShadows) {
+			shadow.clear();
+			for (std::uint32_t i : hits) {
+				const HitRecord& h = records[i];
+				if (Vec3::dot(h.normal, L) > 0.0) shadow.push(Ray(h.point + h.normal * toonParams.shadowBias, L), i);
+			}
+			if (options.wavefrontSortRays) shadow.sortForCoherence();
+			shadow.prepareTriangleRays();
+			const int m = int(shadow.size());
+			blocked.assign(m, 0);
+			Parallel::forEach(0, (m + kChunk - 1) / kChunk, [&](int c) {
+				const int b = c * kChunk, e = std::min(m, b + kChunk);
+				for (const auto& obj : objects) {
+					for (int i = b; i < e; ++i) {
+						if (!blocked[i] && obj->occludedPrepared(shadow.ray(i), shadow.triangleRays[i], 1e-4, INF)) blocked[i] = 1;
+					}
+				}
+			});
+			for (int i = 0; i < m; ++i) inShadow[shadow.pixel[i]] = blocked[i];
+		}
+
+		// 5. 着色：击中列表按段并行，每段整批调用一次着色内核
+		const int hitCount = int(hits.size());
+		shade.resize(hits.size());
+		Parallel::forEach(0, (hitCount + kChunk - 1) / kChunk, [&](int c) {
+			const int b = c * kChunk, e = std::min(hitCount, b + kChunk);
+			for (int k = b; k < e; ++k) {
+				std::uint32_t i = hits[k];
+				setShade(shade, size_t(k), primary.ray(i), records[i], hitObject[i], int(primary.pixel[i]),
+					inShadow[i] != 0, materials);
+			}
+			flushShade(shade, size_t(b), size_t(e), toonParams, allLightIndices, frame);
+		});
+	}
+	stats.pixelsShaded = (long long)pixels;
+}
+
+void Renderer::renderRaster(const std::vector<std::shared_ptr<Hittable>>& objects,
+	const MaterialTable& materials,
+	const ToonParams& toonParams,
+	GBuffer& frame) {
+	// 只光栅化渲染区域覆盖的分块
+	Rasterizer raster(camera, width, height);
+	raster.rasterize(objects, std::vector<PixelRect>(1, region));
+	std::cout << "Raster: " << raster.triangleCount() << " triangles, " << raster.binnedReferences()
+		<< " tile references, " << raster.fallbackObjects().size() << " ray-traced fallback objects\n";
+	shadeRaster(raster, objects, materials, toonParams, frame);
+}
+
+void Renderer::shadeRaster(const Rasterizer& raster,
+	const std::vector<std::shared_ptr<Hittable>>& objects,
+	const MaterialTable& materials,
+	const ToonParams& toonParams,
+	GBuffer& frame) {
+	const double INF = std::numeric_limits<double>::infinity();
+	const double t_min = 1e-4;
+
+	long long fullTraces = 0;
+	shadeTiled(objects, materials, toonParams, frame, [&](int x, int y, PixelHit& h) {
+		h.ray = primaryRay(x, y);
+		std::int32_t prim = raster.primitiveAt(y * width + x);
+		if (prim >= 0) {
+			// 只与可见图元求交，得到与光线后端一致的击中数据
+			const RasterPrim& rp = raster.primitive(prim);
+			h.hit = rp.shape->hit(h.ray, t_min, INF, h.rec);
+			h.object = rp.objectId;
+			if (!h.hit) {
+				// 图元边缘的数值差异：退回完整光线追踪
+				h.rec = HitRecord();
+				h.hit = traceClosest(objects, h.ray, h.rec, h.object);
+				++fullTraces;
+				return;
+			}
+		}
+
+		// 无法光栅化的对象用光线求交补充，t_max 取光栅结果
+		if (raster.fallbackObjects().empty()) return;
+		const TriangleRay tray(h.ray);
+		for (std::uint32_t o : raster.fallbackObjects()) {
+			HitRecord rec;
+			if (objects[o]->hitPrepared(h.ray, tray, t_min, h.hit ? h.rec.t : INF, rec)) {
+				h.hit = true;
+				h.rec = rec;
+				h.object = o;
+			}
+		}
+	});
+	if (fullTraces > 0) std::cout << "Raster: " << fullTraces << " edge pixels re-traced\n";
+}
+
+void Renderer::storeSample(GBuffer& frame, int i, const PixelSample& s) {
+	frame.color[i] = s.color;
+	frame.depth[i] = s.depth;
+	frame.normal[i] = s.normal;
+	frame.objectId[i] = s.objectId;
+	frame.materialId[i] = s.materialId;
+	frame.outline[i] = s.info.silhouette ? 1 : 0;
+}
+
+std::vector<std::shared_ptr<Hittable>> Renderer::selectLods(const std::vector<std::shared_ptr<Hittable>>& objects,
+	const std::vector<Camera>& views) const {
+	const double kPi = 3.14159265358979323846;
+	std::vector<std::shared_ptr<Hittable>> scene(objects);
+	if (!options.enableLod) return scene;  // LodMesh 自身按最精细层级求交
+	for (auto& obj : scene) {
+		std::shared_ptr<const LodMesh> mesh = std::dynamic_pointer_cast<const LodMesh>(obj);
+		if (!mesh) continue;
+
+		// 投影包围球面积（像素） / 每三角形像素数 = 该尺寸下值得追踪的三角形数
+		double pixelRadius = 0.0;
+		for (const Camera& view : views) {
+			pixelRadius = std::max(pixelRadius, view.projectedRadius(mesh->boundsCenter(), mesh->boundsRadius()) * height);
+		}
+		double budget = kPi * pixelRadius * pixelRadius / std::max(1e-6, options.lodPixelsPerTriangle);
+
+		// 选择三角形数仍不少于预算的最粗层级
+		int level = 0;
+		while (level + 1 < mesh->levelCount() && double(mesh->triangleCount(level + 1)) >= budget) ++level;
+		obj = std::make_shared<LodLevel>(mesh, level);
+	}
+	return scene;
+}
+
+bool Renderer::writeImage(const std::vector<Vec3>& colors, const std::string& path) const {
+	return ImageWriter::write(path, colors, width, height, options.pngCompression);
+}
@@ -2,28 +2,450 @@
 #include <vector>
 #include <memory>
 #include <string>
+#include <functional>
 #include "hittable.h"
 #include "camera.h"
+#include "gbuffer.h"
+#include "postprocess.h"
+#include "material.h"
 #include "toon_shader.h"
+#include "video_sink.h"
+
+class Rasterizer;
+
+/// @brief 主可见性后端
+enum class VisibilityBackend {
+	RayTrace,  // 逐像素光线求交
+	Raster     // 分块光栅化（见 Rasterizer）
+};
+
+/// @brief 渲染选项（逐帧生效）
+struct RenderOptions {
+	// Primary visibility backend. Raster resolves visibility with the tiled rasterizer, then rebuilds
+	// each pixel's HitRecord by intersecting its ray with the visible primitive only, so shading
+	// sees the same hit data as the ray backend. Sparse shading applies to the ray backend only.
+	// renderProgressive ignores this and the sparse/wavefront switches (see there).
+	VisibilityBackend visibility = VisibilityBackend::RayTrace;  // 主可见性后端
+
+
+	// LOD selection for LodMesh objects: the coarsest level is chosen whose triangles still
+	// cover at most this many pixels each (estimated from the projected bounding sphere).
+	bool enableLod = true;                // 是否按屏幕大小选择LOD
+	double lodPixelsPerTriangle = 2.0;    // 每个三角形允许覆盖的像素数，越大越早切换到粗层级
+
+	// Band-aware sparse shading: trace a coarse grid of cell corners first. Cells whose corners
+	// agree on hit/miss, object, material, toon band, specular level, shadow and depth are flat:
+	// their pixels are filled from the corners without tracing or shading (colour, depth, normal
+	// and hit point interpolated bilinearly; only local lights are evaluated per pixel). All other
+	// cells, and cells showing per-point colours, are traced per pixel against the whole scene.
+	// Cell rows run in parallel. Objects smaller than a cell that touch no corner can be missed.
+	// Not used by renderProgressive.
+	bool sparseShading = false;           // 是否启用稀疏着色
+	int sparseCellSize = 4;               // 网格单元边长（像素）
+	double sparseDepthTolerance = 0.02;   // 角点深度相对差异阈值
+
+	// Extra outline detectors, fused with the depth Sobel into one post-process sweep.
+	bool enableNormalEdges = false;       // 法线折痕描边
+	double normalEdgeAngle = 40.0;        // 折痕角阈值（度）
+	bool enableMaterialEdges = false;     // 材质边界描边
+	bool enableObjectEdges = false;       // 对象边界描边（对象 = 场景列表中的一项）
+
+	// Screen-space ambient occlusion, applied to the shaded colors before outlines.
+	bool enableSSAO = false;              // 是否启用 SSAO
+	SSAOParams ssao;                      // SSAO 参数
+
+	// Outline width: silhouette and edge pixels are widened with a jump-flood distance transform.
+	// If outlineWidthFraction > 0 the width is that fraction of the image height instead.
+	double outlineWidth = 1.0;            // 描边线宽（像素），1 为原始单像素线
+	double outlineWidthFraction = 0.0;    // 描边线宽占图像高度的比例（>0 时优先）
+
+	// Keep the last frame's raw buffers, output colors and object bounds so renderIncremental can
+	// re-render only what an edit touched. Costs one extra G-buffer and color buffer of memory.
+	bool retainFrame = false;             // 保留上一帧供增量重渲染
+
+	// Wavefront trace: rays are processed in batches, stage by stage over SoA streams (generate,
+	// intersect object by object, compact hits, shadow rays, shade). Used by the ray backend when
+	// sparse shading is off. Local lights are range-tested per pixel instead of culled per tile.
+	// Not used by renderProgressive.
+	bool wavefront = false;               // 是否启用波前（光线流）模式
+	int wavefrontBatchSize = 65536;       // 每批光线数
+	bool wavefrontSortRays = false;       // 求交前按方向/起点重排光线流
+
+	// Local light culling: dense and raster frames are resolved in square tiles; each tile keeps
+	// only the local lights whose range sphere touches the bounding box of its visible hit points.
+	int lightTileSize = 16;               // 光源剔除分块边长（像素）
+
+	// Tile-frustum culling for primary rays (ray backend, dense/sparse/progressive): before each
+	// frame every object's bounds are projected through the camera and binned into screen tiles;
+	// a primary ray is then tested only against its tile's candidates, in scene order, so the
+	// result is identical to testing every object. Shadow rays still test the whole scene.
+	bool tileCulling = true;              // 主光线分块视锥剔除
+	int tileCullingSize = 16;             // 剔除分块边长（像素）
+
+	// Output format follows the file extension: .qoi and .png are encoded in parallel row bands,
+	// anything else is written as ASCII PPM.
+	int pngCompression = 6;               // PNG 压缩级别（0 不压缩，1-9 越大越小越慢）
+};
+
+/// @brief 上一帧的渲染统计
+struct RenderStats {
+	long long pixelsTotal = 0;   // 像素总数
+	long long pixelsShaded = 0;  // 逐像素追踪并着色的样本数（稀疏着色时含区域外的角点）
+	long long pixelsFilled = 0;  // 稀疏着色中由角点插值填充、未调用着色的像素数
+	long long lightTiles = 0;    // 参与光源剔除的分块数（含可见几何）
+	long long tileLightRefs = 0; // 剔除后各分块光源列表长度之和
+	double candidatesPerRay = 0.0; // 分块剔除后每条主光线平均测试的对象数（未剔除时为 0）
+};
 
 class Renderer {
 public:
 	Renderer(int w, int h, const Camera& cam, const Light& light);
 
+	/// @brief 设置渲染选项
+	void setOptions(const RenderOptions& opts) { options = opts; }
+	/// @brief 当前渲染选项
+	const RenderOptions& getOptions() const { return options; }
+	/// @brief 设置局部光源（点光/聚光），与主方向光叠加
+	void setLocalLights(const std::vector<LocalLight>& lights) { localLights = lights; }
+	/// @brief 当前局部光源
+	const std::vector<LocalLight>& getLocalLights() const { return localLights; }
+	/// @brief 设置相机（序列中逐帧移动相机；增量渲染要求相机不变）
+	void setCamera(const Camera& cam) { camera = cam; }
+	/// @brief 当前相机
+	const Camera& getCamera() const { return camera; }
+	/// @brief 上一次 renderPPM 的统计
+	const RenderStats& getLastStats() const { return stats; }
+
 	// Renders scene into a color buffer and depth buffer, applies optional depth-edge outlining, and writes PPM.
+	// Hit material IDs are resolved through 'materials' before shading.
 	bool renderPPM(const std::vector<std::shared_ptr<Hittable>>& objects,
+		const MaterialTable& materials,
+		const ToonParams& toonParams,
+		const std::string& outputPath,
+		bool enableDepthEdges,
+		double depthEdgeThreshold);
+
+	// Renders one frame like renderPPM but appends it to an open video stream instead of writing
+	// a PPM file (sequences: call once per frame with the same sink). The frame buffer is kept
+	// between calls, so a sequence allocates it only once.
+	bool renderToSink(const std::vector<std::shared_ptr<Hittable>>& objects,
+		const MaterialTable& materials,
+		const ToonParams& toonParams,
+		VideoSink& sink,
+		bool enableDepthEdges,
+		double depthEdgeThreshold);
+
+	// Incremental re-render after editing the objects listed in 'changedObjects' (indices into
+	// 'objects'; an object is moved by replacing it in the list). Needs a previous frame rendered
+	// with RenderOptions::retainFrame and the same object count; camera, light, materials and
+	// parameters must be unchanged. Dirty 32x32 tiles are those covered by the projected union of
+	// the old and new bounds of each edited object and, with shadows, by the projection of that box
+	// swept away from the light across the scene bounds. Only those tiles are re-rendered, with the
+	// configured visibility backend (the raster backend sets up the scene once and rasterizes only
+	// the dirty tiles); outlines are re-run on them with a 1 pixel halo (SSAO and
+	// outline thickening re-run on the whole frame). Falls back to a full render when there is no
+	// usable previous frame.
+	bool renderIncremental(const std::vector<std::shared_ptr<Hittable>>& objects,
+		const MaterialTable& materials,
+		const ToonParams& toonParams,
+		const std::string& outputPath,
+		bool enableDepthEdges,
+		double depthEdgeThreshold,
+		const std::vector<std::uint32_t>& changedObjects);
+
+	// Progressive preview: traces every 8th pixel in each direction, then every 4th, 2nd and finally
+	// all pixels, reusing the samples of coarser levels. After each level the frame (untraced pixels
+	// take the nearest coarser sample) is post-processed, written to 'outputPath' and passed to
+	// 'onLevel'. Stops once 'timeBudgetSeconds' is exceeded; the first level always completes.
+	// Every level traces its pixels one by one with the dense ray backend, whatever 'visibility',
+	// 'sparseShading' and 'wavefront' select: the other backends only render whole rectangles, so
+	// they can neither skip the samples of coarser levels nor stop at the budget mid-level.
+	// Returns the finest fully completed step (1 = full resolution, identical to renderPPM with
+	// the dense ray backend), or 0 if writing a preview failed.
+	int renderProgressive(const std::vector<std::shared_ptr<Hittable>>& objects,
+		const MaterialTable& materials,
 		const ToonParams& toonParams,
 		const std::string& outputPath,
 		bool enableDepthEdges,
+		double depthEdgeThreshold,
+		double timeBudgetSeconds,
+		const std::function<void(int step, const GBuffer& preview)>& onLevel = nullptr);
+
+	// Distributed rendering: renders only 'partRegion' and saves its raw G-buffer channels (color,
+	// depth, normal, IDs, silhouette mask) as a partial file; no post-processing is applied.
+	bool renderPartial(const std::vector<std::shared_ptr<Hittable>>& objects,
+		const MaterialTable& materials,
+		const ToonParams& toonParams,
+		const PixelRect& partRegion,
+		const std::string& partialPath);
+
+	// Stitches partial files that together cover the frame, then runs SSAO, the outline pipeline
+	// and outline thickening on the whole frame and writes PPM. Must be called on a Renderer with
+	// the same size, camera and options as the workers; the result matches renderPPM exactly.
+	bool mergePartials(const std::vector<std::string>& partialPaths,
+		const std::string& outputPath,
+		bool enableDepthEdges,
+		double depthEdgeThreshold);
+
+	// Multi-view: renders one image per camera (stereo pairs, turnaround sheets, cubemap faces)
+	// in one job over the same objects and acceleration structures. LOD levels are chosen for
+	// the view that needs the most detail. With the dense ray backend the light-culling tiles of
+	// all views go through one parallel tile queue; other backends render the views one after
+	// another. Each view is post-processed with its own camera and written to outputPaths[v].
+	bool renderViews(const std::vector<std::shared_ptr<Hittable>>& objects,
+		const MaterialTable& materials,
+		const ToonParams& toonParams,
+		const std::vector<Camera>& cameras,
+		const std::vector<std::string>& outputPaths,
+		bool enableDepthEdges,
 		double depthEdgeThreshold);
 
+	// Consistency check between the visibility backends: renders the frame's raw G-buffer with the
+	// ray backend (dense) and with the raster backend, then compares object IDs and depths pixel
+	// by pixel and prints the number of mismatches. Options are restored afterwards.
+	/// @brief 光栅与光线可见性一致性检查，全部一致时返回 true
+	bool verifyRaster(const std::vector<std::shared_ptr<Hittable>>& objects,
+		const MaterialTable& materials,
+		const ToonParams& toonParams);
+
 private:
 	int width;
 	int height;
 	Camera camera;
 	Light light;
+	RenderOptions options;
+	RenderStats stats;
+	/// @brief 本次渲染的像素范围（整帧或分块）
+	PixelRect region;
+
+	// 增量重渲染保留的上一帧
+	bool hasLastFrame = false;
+	/// @brief 上一帧后处理前的缓冲
+	GBuffer lastRaw;
+	/// @brief 上一帧输出颜色
+	std::vector<Vec3> lastOutput;
+	/// @brief 上一帧各对象的包围盒（无界对象为空盒）
+	std::vector<AABB> lastBounds;
+	/// @brief renderToSink 复用的帧缓冲
+	GBuffer sinkFrame;
+	std::vector<LocalLight> localLights;
+	/// @brief 本帧的特化着色内核（renderPPM 开始时按 ToonParams 选定）
+	ToonShader::Kernel shaderKernel;
+	/// @brief 全部局部光源的索引（未分块剔除时使用，每帧开始时重建）
+	std::vector<std::uint32_t> allLightIndices;
+
+	/// @brief 主光线分块候选表（CSR）：分块 t 的对象下标为 refs[offsets[t], offsets[t+1])，按下标升序
+	struct TileCandidates {
+		int tileSize = 1;
+		int tilesX = 0;
+		int tilesY = 0;
+		std::vector<std::uint32_t> offsets;
+		std::vector<std::uint32_t> refs;
+	};
+	/// @brief 各视图的分块候选表（prepareFrame 中建立，下标同 lodViews；为空表示不剔除）
+	std::vector<TileCandidates> viewCandidates;
+
+	/// @brief 每帧开始时的准备：渲染区域、LOD、着色内核、局部光源索引
+	/// @return 本帧追踪使用的对象列表（见 selectLods）
+	std::vector<std::shared_ptr<Hittable>> prepareFrame(const std::vector<std::shared_ptr<Hittable>>& objects,
+		const ToonParams& toonParams,
+		const PixelRect& frameRegion);
+	/// @brief 同上；LOD 按 lodViews 中需要最高细节的视图选择
+	std::vector<std::shared_ptr<Hittable>> prepareFrame(const std::vector<std::shared_ptr<Hittable>>& objects,
+		const ToonParams& toonParams,
+		const PixelRect& frameRegion,
+		const std::vector<Camera>& lodViews);
+
+	/// @brief 在 frameRegion 内完成主可见性与着色（不含后处理）；frame 可以只覆盖 frameRegion，按整帧坐标写入
+	void renderFrame(const std::vector<std::shared_ptr<Hittable>>& objects,
+		const MaterialTable& materials,
+		const ToonParams& toonParams,
+		const PixelRect& frameRegion,
+		GBuffer& frame);
+
+	/// @brief 记录各对象当前包围盒
+	void captureBounds(const std::vector<std::shared_ptr<Hittable>>& objects);
+
+	/// @brief 按选项组装融合描边滤镜
+	Postprocess::Pipeline outlinePipeline(bool enableDepthEdges, double depthEdgeThreshold) const;
+
+	/// @brief 实际描边线宽（像素）
+	double effectiveOutlineWidth() const;
+
+	/// @brief 整帧后处理：SSAO、描边检测、描边加粗
+	void postprocessFrame(GBuffer& frame, bool enableDepthEdges, double depthEdgeThreshold) const;
+
+	/// @brief 单个像素的追踪与着色结果
+	struct PixelSample {
+		bool hit = false;
+		Vec3 color;
+		double depth = 0.0;
+		Vec3 normal;
+		std::uint32_t objectId = GBuffer::kNoId;
+		MaterialId materialId = GBuffer::kNoId;
+		ToonShadeInfo info;
+	};
+
+	/// @brief 像素中心的主光线
+	Ray primaryRay(int x, int y) const;
+	/// @brief 指定相机下像素中心的主光线
+	Ray primaryRay(const Camera& view, int x, int y) const;
+
+	/// @brief 主光线的可见性结果（尚未着色）
+	struct PixelHit {
+		Ray ray;
+		HitRecord rec;
+		bool hit = false;
+		size_t object = 0;
+	};
+
+	// Hits queued for the batched toon kernel (one tile, or one wavefront chunk). Slots are
+	// filled independently by setShade, so threads can fill and flush disjoint ranges.
+	/// @brief 批量着色缓冲
+	struct ShadeBatch {
+		std::vector<ToonShadeInput> inputs;
+		std::vector<HitRecord*> records;
+		std::vector<std::uint32_t> objects;
+		std::vector<int> pixels;            // 帧缓冲下标
+		std::vector<Material> colored;      // 逐图元颜色的材质副本（inputs 指向这里）
+		std::vector<Vec3> colors;
+		std::vector<ToonShadeInfo> infos;
+
+		void resize(size_t n) {
+			inputs.resize(n);
+			records.resize(n);
+			objects.resize(n);
+			pixels.resize(n);
+			colored.resize(n);
+			colors.resize(n);
+			infos.resize(n);
+		}
+	};
+
+	/// @brief 最近击中：遍历全部对象
+	static bool traceClosest(const std::vector<std::shared_ptr<Hittable>>& objects, const Ray& r,
+		HitRecord& closestHit, size_t& hitObject);
+
+	/// @brief 最近击中：只遍历 candidates[0, count) 中的对象
+	static bool traceClosest(const std::vector<std::shared_ptr<Hittable>>& objects,
+		const std::uint32_t* candidates, size_t count, const Ray& r,
+		HitRecord& closestHit, size_t& hitObject);
+
+	/// @brief 投影各对象包围盒，分箱到 view 下的屏幕分块（并行）
+	TileCandidates binObjects(const std::vector<std::shared_ptr<Hittable>>& objects, const Camera& view) const;
+
+	/// @brief 像素 (x, y) 主光线的最近击中：有候选表时只测试所在分块的对象
+	/// @param view 视图下标（viewCandidates 的下标）
+	bool tracePrimary(const std::vector<std::shared_ptr<Hittable>>& objects, size_t view, int x, int y,
+		const Ray& r, HitRecord& closestHit, size_t& hitObject) const;
+
+	/// @brief 遮挡查询：任一对象在 (t_min, t_max) 内与射线相交即返回 true
+	static bool occludedAny(const std::vector<std::shared_ptr<Hittable>>& objects, const Ray& r, double t_min, double t_max);
+
+	/// @brief 将最近击中（或未击中）转换为着色后的像素结果（需要时发射阴影光线）
+	/// 'lightList' 为参与着色的局部光源索引
+	PixelSample shadeHit(const Ray& r, bool hitSomething, HitRecord& closestHit, size_t hitObject,
+		const std::vector<std::shared_ptr<Hittable>>& objects,
+		const MaterialTable& materials,
+		const ToonParams& toonParams,
+		const std::vector<std::uint32_t>& lightList) const;
+
+	/// @brief 击中点朝向光源时发射阴影光线；未开启阴影或背光时返回 false
+	bool shadowed(const std::vector<std::shared_ptr<Hittable>>& objects, const HitRecord& rec,
+		const ToonParams& toonParams) const;
+
+	/// @brief 填写批量着色的第 k 个样本（解析材质与逐图元颜色），结果与 shadeSurface 一致
+	void setShade(ShadeBatch& batch, size_t k, const Ray& r, HitRecord& rec, size_t hitObject, int pixel,
+		bool inShadow, const MaterialTable& materials) const;
+
+	/// @brief 对 [begin, end) 的样本调用一次着色内核，叠加局部光源后写入帧缓冲
+	void flushShade(ShadeBatch& batch, size_t begin, size_t end, const ToonParams& toonParams,
+		const std::vector<std::uint32_t>& lightList, GBuffer& frame) const;
+
+	/// @brief 已知击中与阴影结果时的着色
+	PixelSample shadeSurface(const Ray& r, HitRecord& closestHit, size_t hitObject,
+		const MaterialTable& materials,
+		const ToonParams& toonParams,
+		bool inShadow,
+		const std::vector<std::uint32_t>& lightList) const;
+
+	/// @brief 追踪像素中心的主光线并着色（局部光源逐像素按作用半径判断）
+	PixelSample tracePixel(const std::vector<std::shared_ptr<Hittable>>& objects,
+		const MaterialTable& materials,
+		const ToonParams& toonParams,
+		int x, int y) const;
+
+	/// @brief 分块着色：先用 resolve 求出块内每个像素的可见性，再剔除局部光源，最后整块批量着色
+	void shadeTiled(const std::vector<std::shared_ptr<Hittable>>& objects,
+		const MaterialTable& materials,
+		const ToonParams& toonParams,
+		GBuffer& frame,
+		const std::function<void(int x, int y, PixelHit& out)>& resolve);
+
+	/// @brief 着色一个分块（tileRect 内）：解析可见性、按块剔除局部光源、批量着色。
+	/// hits / tileLights / shade 为调用方提供的临时缓冲，不同线程各用一份即可并行处理不同分块。
+	/// @return 剔除后的光源数；块内无可见几何或没有局部光源时返回 -1
+	long long shadeTile(const std::vector<std::shared_ptr<Hittable>>& objects,
+		const MaterialTable& materials,
+		const ToonParams& toonParams,
+		GBuffer& frame,
+		const PixelRect& tileRect,
+		const std::function<void(int x, int y, PixelHit& out)>& resolve,
+		std::vector<PixelHit>& hits,
+		std::vector<std::uint32_t>& tileLights,
+		ShadeBatch& shade) const;
+
+	/// @brief 保留作用范围（球）与包围盒 [lo, hi] 相交的局部光源
+	void cullLights(const Vec3& lo, const Vec3& hi, std::vector<std::uint32_t>& out) const;
+
+	/// @brief 按选项选择可见性后端（光栅、稀疏、波前或逐像素），渲染 region 内的像素
+	void renderVisibility(const std::vector<std::shared_ptr<Hittable>>& objects,
+		const MaterialTable& materials,
+		const ToonParams& toonParams,
+		GBuffer& frame);
+
+	/// @brief 逐像素追踪整帧
+	void renderDense(const std::vector<std::shared_ptr<Hittable>>& objects,
+		const MaterialTable& materials,
+		const ToonParams& toonParams,
+		GBuffer& frame);
+
+	/// @brief 稀疏着色：先追踪网格角点，平坦单元由角点插值填充，只在色带边界单元内逐像素追踪
+	void renderSparse(const std::vector<std::shared_ptr<Hittable>>& objects,
+		const MaterialTable& materials,
+		const ToonParams& toonParams,
+		GBuffer& frame);
+
+	/// @brief 波前模式：分阶段处理整批光线
+	void renderWavefront(const std::vector<std::shared_ptr<Hittable>>& objects,
+		const MaterialTable& materials,
+		const ToonParams& toonParams,
+		GBuffer& frame);
+
+	/// @brief 光栅化主可见性（只处理 region 覆盖的分块），再按像素重建击中并着色
+	void renderRaster(const std::vector<std::shared_ptr<Hittable>>& objects,
+		const MaterialTable& materials,
+		const ToonParams& toonParams,
+		GBuffer& frame);
+
+	/// @brief 从已有的光栅结果读取 region 内的可见性并着色（raster 须覆盖 region）
+	void shadeRaster(const Rasterizer& raster,
+		const std::vector<std::shared_ptr<Hittable>>& objects,
+		const MaterialTable& materials,
+		const ToonParams& toonParams,
+		GBuffer& frame);
+
+	/// @brief 为场景中的 LodMesh 选择层级（取各视图中投影最大者）
+	/// @return 对象列表副本，其中 LodMesh 换成所选层级的 LodLevel（下标不变，网格本身不被修改）
+	std::vector<std::shared_ptr<Hittable>> selectLods(const std::vector<std::shared_ptr<Hittable>>& objects,
+		const std::vector<Camera>& views) const;
+
+	/// @brief 将像素结果写入帧缓冲
+	static void storeSample(GBuffer& frame, int i, const PixelSample& s);
 
-	void writePPM(const std::vector<Vec3>& colors, const std::string& path) const;
+	/// @brief 按扩展名写出图像（.ppm / .qoi / .png）
+	/// @return 是否写入成功
+	bool writeImage(const std::vector<Vec3>& colors, const std::string& path) const;
 };
 
 
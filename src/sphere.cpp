@@ -21,8 +21,48 @@ bool Sphere::hit(const Ray& r, double t_min, double t_max, HitRecord& out_rec) c
 	out_rec.point = r.at(out_rec.t);
 	Vec3 outward = (out_rec.point - center) / radius;
 	out_rec.set_face_normal(r, outward.normalized());
-	out_rec.material = &material;
+	out_rec.materialId = materialId;
+	out_rec.albedoRGB = HitRecord::kNoAlbedo;
 	return true;
 }
 
 
+
+bool Sphere::occluded(const Ray& r, double t_min, double t_max) const {
+	Vec3 oc = r.origin - center;
+	double a = r.direction.length_squared();
+	double half_b = Vec3::dot(oc, r.direction);
+	double c = oc.length_squared() - radius * radius;
+	double discriminant = half_b * half_b - a * c;
+	if (discriminant < 0.0) return false;
+	double sqrtd = std::sqrt(discriminant);
+	double root = (-half_b - sqrtd) / a;
+	if (root >= t_min && root <= t_max) return true;
+	root = (-half_b + sqrtd) / a;
+	return root >= t_min && root <= t_max;
+}
+
+
+
+void Sphere::hitStream(const RayStream& rays, size_t begin, size_t end, double t_min,
+	double* tMax, std::uint32_t* hitIndex, std::uint32_t id) const {
+	const double rr = radius * radius;
+	for (size_t i = begin; i < end; ++i) {
+		Vec3 dir(rays.dx[i], rays.dy[i], rays.dz[i]);
+		Vec3 oc = Vec3(rays.ox[i], rays.oy[i], rays.oz[i]) - center;
+		double a = dir.length_squared();
+		double half_b = Vec3::dot(oc, dir);
+		double c = oc.length_squared() - rr;
+		double discriminant = half_b * half_b - a * c;
+		if (discriminant < 0.0) continue;
+		double sqrtd = std::sqrt(discriminant);
+
+		double root = (-half_b - sqrtd) / a;
+		if (root < t_min || root > tMax[i]) {
+			root = (-half_b + sqrtd) / a;
+			if (root < t_min || root > tMax[i]) continue;
+		}
+		tMax[i] = root;
+		hitIndex[i] = id;
+	}
+}
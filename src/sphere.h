@@ -4,15 +4,25 @@
 
 class Sphere : public Hittable {
 public:
-	Sphere() : center(), radius(1.0), material() {}
-	Sphere(const Vec3& c, double r, const Material& m) : center(c), radius(r), material(m) {}
+	Sphere() : center(), radius(1.0), materialId(0) {}
+	Sphere(const Vec3& c, double r, MaterialId m) : center(c), radius(r), materialId(m) {}
 
 	bool hit(const Ray& r, double t_min, double t_max, HitRecord& out_rec) const override;
+	bool occluded(const Ray& r, double t_min, double t_max) const override;
+	bool boundingBox(AABB& out) const override {
+		Vec3 r(radius, radius, radius);
+		out = AABB(center - r, center + r);
+		return true;
+	}
+	void hitStream(const RayStream& rays, size_t begin, size_t end, double t_min,
+		double* tMax, std::uint32_t* hitIndex, std::uint32_t id) const override;
+
+	const Vec3& getCenter() const { return center; }
+	double getRadius() const { return radius; }
+	MaterialId getMaterialId() const { return materialId; }
 
 private:
 	Vec3 center;
 	double radius;
-	Material material;
+	MaterialId materialId;
 };
-
-
@@ -0,0 +1,308 @@
+#include "sphere_set.h"
+#include "morton.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+namespace {
+	/// @brief 叶子球数上限
+	const std::uint32_t kMaxLeafSize = 64;
+	/// @brief 遍历栈容量（中位数划分的树深度不超过 log2(球数) + 1）
+	const int kStackSize = 64;
+	/// @brief slab 区间放宽系数：吸收包围盒与球求交各自的舍入误差
+	const double kRobustScale = 1.0 + 6.0 * std::numeric_limits<double>::epsilon();
+
+	/// @brief 中位数划分下 n 个球的子树节点数（与 build 的划分一致，用于预先分配节点数组）
+	static size_t countNodes(std::uint32_t n, std::uint32_t leafSize) {
+		if (n <= leafSize) return 1;
+		return 1 + countNodes(n / 2, leafSize) + countNodes(n - n / 2, leafSize);
+	}
+
+	/// @brief 按 order 重排数组
+	template <typename T>
+	static void gather(std::vector<T>& values, const std::vector<std::uint32_t>& order, size_t stride) {
+		if (values.empty()) return;
+		std::vector<T> out(values.size());
+		for (size_t i = 0; i < order.size(); ++i) {
+			for (size_t k = 0; k < stride; ++k) out[i * stride + k] = values[size_t(order[i]) * stride + k];
+		}
+		values.swap(out);
+	}
+
+	/// @brief 按中心的 30 位 Morton 码排序后的下标
+	static std::vector<std::uint32_t> mortonOrder(const std::vector<float>& x, const std::vector<float>& y,
+		const std::vector<float>& z, const float* lo, const float* hi) {
+		double scale[3];
+		for (int a = 0; a < 3; ++a) scale[a] = hi[a] > lo[a] ? 1023.0 / (double(hi[a]) - lo[a]) : 0.0;
+		std::vector<std::uint64_t> keys(x.size());
+		for (size_t i = 0; i < x.size(); ++i) {
+			std::uint32_t code = (Morton::expandBits10(std::uint32_t((x[i] - lo[0]) * scale[0])) << 2)
+				| (Morton::expandBits10(std::uint32_t((y[i] - lo[1]) * scale[1])) << 1)
+				| Morton::expandBits10(std::uint32_t((z[i] - lo[2]) * scale[2]));
+			keys[i] = (std::uint64_t(code) << 32) | i;
+		}
+		std::sort(keys.begin(), keys.end());
+		std::vector<std::uint32_t> order(x.size());
+		for (size_t i = 0; i < x.size(); ++i) order[i] = std::uint32_t(keys[i]);
+		return order;
+	}
+
+	/// @brief 遍历栈元素
+	struct StackEntry {
+		std::uint32_t node;
+		double tNear;
+	};
+}
+
+SphereSet::SphereSet(PointCloudData&& points, MaterialId material, const SphereSetOptions& options)
+	: materialId(material) {
+	auto start = std::chrono::steady_clock::now();
+	const size_t n = points.size();
+	cx.swap(points.x);
+	cy.swap(points.y);
+	cz.swap(points.z);
+	uniformRadius = float(options.pointRadius);
+	if (points.radius.size() == n) {
+		radii.swap(points.radius);
+		// 文件半径全部相同时不保留半径数组
+		if (!radii.empty() && std::all_of(radii.begin(), radii.end(), [&](float r) { return r == radii[0]; })) {
+			uniformRadius = radii[0];
+			std::vector<float>().swap(radii);
+		}
+	}
+	if (points.rgb.size() == 3 * n) rgb.swap(points.rgb);
+	points = PointCloudData();
+	leafSize = std::uint32_t(std::max(1, std::min(int(kMaxLeafSize), options.leafSize)));
+
+	if (n > 0) {
+		float lo[3] = { cx[0], cy[0], cz[0] }, hi[3] = { cx[0], cy[0], cz[0] };
+		for (size_t i = 1; i < n; ++i) {
+			lo[0] = std::min(lo[0], cx[i]); hi[0] = std::max(hi[0], cx[i]);
+			lo[1] = std::min(lo[1], cy[i]); hi[1] = std::max(hi[1], cy[i]);
+			lo[2] = std::min(lo[2], cz[i]); hi[2] = std::max(hi[2], cz[i]);
+		}
+		// 先按中心的 Morton 码重排：中位数划分的每个子树在内存中基本连续，
+		// 构建时的 nth_element 不再随机访问整个数组
+		std::vector<std::uint32_t> order = mortonOrder(cx, cy, cz, lo, hi);
+		permute(order);
+		for (size_t i = 0; i < n; ++i) order[i] = std::uint32_t(i);
+		nodes.reserve(countNodes(std::uint32_t(n), leafSize));
+		buildStats.depth = build(order, 0, std::uint32_t(n), lo, hi);
+		permute(order);
+		const Node& root = nodes[0];
+		bounds = AABB(Vec3(root.lo[0], root.lo[1], root.lo[2]), Vec3(root.hi[0], root.hi[1], root.hi[2]));
+	}
+
+	buildStats.spheres = n;
+	buildStats.nodes = nodes.size();
+	buildStats.nodeBytes = nodes.size() * sizeof(Node);
+	buildStats.pointBytes = (cx.size() + cy.size() + cz.size() + radii.size()) * sizeof(float) + rgb.size();
+	buildStats.buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void SphereSet::permute(const std::vector<std::uint32_t>& order) {
+	gather(cx, order, 1);
+	gather(cy, order, 1);
+	gather(cz, order, 1);
+	gather(radii, order, 1);
+	gather(rgb, order, 3);
+}
+
+int SphereSet::build(std::vector<std::uint32_t>& order, std::uint32_t begin, std::uint32_t end,
+	const float* lo, const float* hi) {
+	const std::uint32_t self = std::uint32_t(nodes.size());
+	nodes.emplace_back();
+	const std::uint32_t count = end - begin;
+	if (count <= leafSize) {
+		Node leaf;
+		for (int a = 0; a < 3; ++a) {
+			leaf.lo[a] = std::numeric_limits<float>::infinity();
+			leaf.hi[a] = -std::numeric_limits<float>::infinity();
+		}
+		for (std::uint32_t i = begin; i < end; ++i) {
+			const std::uint32_t p = order[i];
+			const float c[3] = { cx[p], cy[p], cz[p] };
+			const float r = radiusOf(p);
+			for (int a = 0; a < 3; ++a) {
+				// c ± r 在 float 中各有半个 ulp 的舍入，向外再移一个 ulp 保证包住球
+				leaf.lo[a] = std::min(leaf.lo[a], std::nextafter(c[a] - r, -std::numeric_limits<float>::infinity()));
+				leaf.hi[a] = std::max(leaf.hi[a], std::nextafter(c[a] + r, std::numeric_limits<float>::infinity()));
+			}
+		}
+		leaf.index = begin;
+		leaf.count = count;
+		nodes[self] = leaf;
+		return 1;
+	}
+
+	// 质心范围最长轴上取中位数。范围由父节点传下（划分轴上截到中位数），不逐层重新扫描
+	int axis = 0;
+	if (hi[1] - lo[1] > hi[axis] - lo[axis]) axis = 1;
+	if (hi[2] - lo[2] > hi[axis] - lo[axis]) axis = 2;
+	const float* key = axis == 0 ? cx.data() : (axis == 1 ? cy.data() : cz.data());
+	const std::uint32_t mid = begin + count / 2;
+	std::nth_element(order.data() + begin, order.data() + mid, order.data() + end,
+		[key](std::uint32_t a, std::uint32_t b) { return key[a] < key[b]; });
+	const float split = key[order[mid]];
+
+	float childLo[3] = { lo[0], lo[1], lo[2] }, childHi[3] = { hi[0], hi[1], hi[2] };
+	childHi[axis] = split;
+	const int leftDepth = build(order, begin, mid, childLo, childHi);
+	childHi[axis] = hi[axis];
+	childLo[axis] = split;
+	const std::uint32_t right = std::uint32_t(nodes.size());
+	const int rightDepth = build(order, mid, end, childLo, childHi);
+
+	Node node;
+	const Node& l = nodes[self + 1];
+	const Node& r = nodes[right];
+	for (int a = 0; a < 3; ++a) {
+		node.lo[a] = std::min(l.lo[a], r.lo[a]);
+		node.hi[a] = std::max(l.hi[a], r.hi[a]);
+	}
+	node.index = right;
+	node.count = 0;
+	nodes[self] = node;
+	return 1 + std::max(leftDepth, rightDepth);
+}
+
+namespace {
+	/// @brief float 包围盒的 slab 测试（双精度计算），命中时返回进入距离
+	static bool slab(const float* lo, const float* hi, const double* o, const double* inv,
+		double t_min, double t_max, double& tNear) {
+		for (int a = 0; a < 3; ++a) {
+			double t0 = (double(lo[a]) - o[a]) * inv[a];
+			double t1 = (double(hi[a]) - o[a]) * inv[a];
+			if (inv[a] < 0.0) std::swap(t0, t1);
+			t_min = t0 > t_min ? t0 : t_min;   // NaN（起点在平面上且方向平行）时保持原值
+			t_max = t1 < t_max ? t1 : t_max;
+		}
+		tNear = t_min;
+		return t_min <= t_max * kRobustScale;
+	}
+}
+
+std::int64_t SphereSet::closest(const Ray& r, double t_min, double t_max, double& tHit) const {
+	if (nodes.empty()) return -1;
+	const double o[3] = { r.origin.x, r.origin.y, r.origin.z };
+	const double d[3] = { r.direction.x, r.direction.y, r.direction.z };
+	const double inv[3] = { 1.0 / d[0], 1.0 / d[1], 1.0 / d[2] };
+	const double a = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+	const double invA = 1.0 / a;
+	double tRoot;
+	if (!slab(nodes[0].lo, nodes[0].hi, o, inv, t_min, t_max, tRoot)) return -1;
+	StackEntry stack[kStackSize];
+	int sp = 0;
+	stack[sp++] = { 0, tRoot };
+	std::int64_t best = -1;
+
+	while (sp > 0) {
+		const StackEntry e = stack[--sp];
+		if (e.tNear > t_max * kRobustScale) continue;
+		const Node& node = nodes[e.node];
+		if (node.count > 0) {
+			// 与 Sphere::hit 相同的求根顺序：先近根，不在区间内再取远根
+			for (std::uint32_t i = node.index; i < node.index + node.count; ++i) {
+				const double ox = o[0] - cx[i], oy = o[1] - cy[i], oz = o[2] - cz[i];
+				const double rad = radiusOf(i);
+				const double halfB = ox * d[0] + oy * d[1] + oz * d[2];
+				const double c = ox * ox + oy * oy + oz * oz - rad * rad;
+				const double disc = halfB * halfB - a * c;
+				if (disc < 0.0) continue;
+				const double sqrtd = std::sqrt(disc);
+				double t = (-halfB - sqrtd) * invA;
+				if (t < t_min || t > t_max) {
+					t = (-halfB + sqrtd) * invA;
+					if (t < t_min || t > t_max) continue;
+				}
+				t_max = t;
+				best = i;
+			}
+			continue;
+		}
+		const std::uint32_t left = e.node + 1, right = node.index;
+		double t0, t1;
+		bool h0 = slab(nodes[left].lo, nodes[left].hi, o, inv, t_min, t_max, t0);
+		bool h1 = slab(nodes[right].lo, nodes[right].hi, o, inv, t_min, t_max, t1);
+		if (h0 && h1) {
+			// 远的先入栈
+			if (t0 <= t1) {
+				stack[sp++] = { right, t1 };
+				stack[sp++] = { left, t0 };
+			}
+			else {
+				stack[sp++] = { left, t0 };
+				stack[sp++] = { right, t1 };
+			}
+		}
+		else if (h0) stack[sp++] = { left, t0 };
+		else if (h1) stack[sp++] = { right, t1 };
+	}
+	tHit = t_max;
+	return best;
+}
+
+bool SphereSet::hit(const Ray& r, double t_min, double t_max, HitRecord& out_rec) const {
+	double t;
+	const std::int64_t best = closest(r, t_min, t_max, t);
+	if (best < 0) return false;
+	const std::uint32_t i = std::uint32_t(best);
+	out_rec.t = t;
+	out_rec.point = r.at(t);
+	Vec3 outward = (out_rec.point - Vec3(cx[i], cy[i], cz[i])) / double(radiusOf(i));
+	out_rec.set_face_normal(r, outward.normalized());
+	out_rec.materialId = materialId;
+	out_rec.albedoRGB = rgb.empty() ? HitRecord::kNoAlbedo
+		: (std::uint32_t(rgb[3 * size_t(i)]) << 16) | (std::uint32_t(rgb[3 * size_t(i) + 1]) << 8) | rgb[3 * size_t(i) + 2];
+	return true;
+}
+
+bool SphereSet::occluded(const Ray& r, double t_min, double t_max) const {
+	if (nodes.empty()) return false;
+	const double o[3] = { r.origin.x, r.origin.y, r.origin.z };
+	const double d[3] = { r.direction.x, r.direction.y, r.direction.z };
+	const double inv[3] = { 1.0 / d[0], 1.0 / d[1], 1.0 / d[2] };
+	const double a = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+	const double invA = 1.0 / a;
+	std::uint32_t stack[kStackSize];
+	int sp = 0;
+	double tNear;
+	if (!slab(nodes[0].lo, nodes[0].hi, o, inv, t_min, t_max, tNear)) return false;
+	stack[sp++] = 0;
+
+	while (sp > 0) {
+		const std::uint32_t index = stack[--sp];
+		const Node& node = nodes[index];
+		if (node.count > 0) {
+			for (std::uint32_t i = node.index; i < node.index + node.count; ++i) {
+				const double ox = o[0] - cx[i], oy = o[1] - cy[i], oz = o[2] - cz[i];
+				const double rad = radiusOf(i);
+				const double halfB = ox * d[0] + oy * d[1] + oz * d[2];
+				const double c = ox * ox + oy * oy + oz * oz - rad * rad;
+				const double disc = halfB * halfB - a * c;
+				if (disc < 0.0) continue;
+				const double sqrtd = std::sqrt(disc);
+				const double t0 = (-halfB - sqrtd) * invA;
+				if (t0 >= t_min && t0 <= t_max) return true;
+				const double t1 = (-halfB + sqrtd) * invA;
+				if (t1 >= t_min && t1 <= t_max) return true;
+			}
+			continue;
+		}
+		if (slab(nodes[index + 1].lo, nodes[index + 1].hi, o, inv, t_min, t_max, tNear)) stack[sp++] = index + 1;
+		if (slab(nodes[node.index].lo, nodes[node.index].hi, o, inv, t_min, t_max, tNear)) stack[sp++] = node.index;
+	}
+	return false;
+}
+
+void SphereSet::hitStream(const RayStream& rays, size_t begin, size_t end, double t_min,
+	double* tMax, std::uint32_t* hitIndex, std::uint32_t id) const {
+	for (size_t i = begin; i < end; ++i) {
+		double t;
+		if (closest(rays.ray(i), t_min, tMax[i], t) >= 0) {
+			tMax[i] = t;
+			hitIndex[i] = id;
+		}
+	}
+}
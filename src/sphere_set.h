@@ -0,0 +1,81 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "hittable.h"
+#include "mesh_loader.h"
+
+/// @brief 球集统计
+struct SphereSetStats {
+	size_t spheres = 0;       // 球数
+	size_t nodes = 0;         // BVH 节点数
+	size_t pointBytes = 0;    // 球数据字节数（中心、半径、颜色）
+	size_t nodeBytes = 0;     // 节点总字节数
+	int depth = 0;            // 树深度
+	double buildSeconds = 0.0; // 构建耗时（秒）
+};
+
+// Many spheres sharing one material, e.g. a point cloud. Centers, radii and colours live in
+// SoA arrays (float centers, a radius array only when radii differ, 3-byte colours only when
+// the cloud has them), reordered so every BVH leaf covers a contiguous range. The BVH is split
+// at the object median along the longest axis of the centroid range, which keeps it balanced
+// for the dense, evenly sized primitives of a point cloud; the points are put in Morton order
+// first so the partitioning works on nearby memory. Nodes store float boxes rounded outwards
+// (32 bytes each). A hit reports the sphere colour through HitRecord::albedoRGB.
+/// @brief 球集（点云）图元
+class SphereSet : public Hittable {
+public:
+	/// @brief 构造函数：接管点云数据并构建 BVH
+	/// @param points 点云（已变换到场景空间；数组被移走）
+	/// @param material 材质ID
+	/// @param options 选项（pointRadius 用于没有逐点半径的点云）
+	SphereSet(PointCloudData&& points, MaterialId material, const SphereSetOptions& options);
+
+	/// @brief 最近击中
+	bool hit(const Ray& r, double t_min, double t_max, HitRecord& out_rec) const override;
+	/// @brief 遮挡查询：任一球被击中即返回
+	bool occluded(const Ray& r, double t_min, double t_max) const override;
+	/// @brief 包围盒即根节点包围盒
+	bool boundingBox(AABB& out) const override {
+		out = bounds;
+		return !cx.empty();
+	}
+	/// @brief 批量最近击中：只求距离与是否击中，不计算法线
+	void hitStream(const RayStream& rays, size_t begin, size_t end, double t_min,
+		double* tMax, std::uint32_t* hitIndex, std::uint32_t id) const override;
+
+	/// @brief 球数
+	size_t size() const { return cx.size(); }
+	/// @brief 构建统计
+	const SphereSetStats& stats() const { return buildStats; }
+
+private:
+	/// @brief BVH 节点：count>0 为叶子（index 为首个球），否则左子节点紧随其后、index 为右子节点
+	struct Node {
+		float lo[3];
+		float hi[3];
+		std::uint32_t index = 0;
+		std::uint32_t count = 0;
+	};
+	static_assert(sizeof(Node) == 32, "SphereSet::Node must stay 32 bytes");
+
+	std::vector<float> cx, cy, cz;
+	std::vector<float> radii;           // 为空时所有球半径为 uniformRadius
+	float uniformRadius = 0.01f;
+	std::vector<std::uint8_t> rgb;      // 为空时使用材质反照率
+	std::vector<Node> nodes;
+	AABB bounds;
+	MaterialId materialId = 0;
+	std::uint32_t leafSize = 8;
+	SphereSetStats buildStats;
+
+	/// @brief 按 order 重排所有球数据（第 i 个球取原来的第 order[i] 个）
+	void permute(const std::vector<std::uint32_t>& order);
+	/// @brief 递归构建 order[begin, end) 的子树（先序存储），返回子树深度
+	/// lo/hi 为这些球中心的范围（可偏大）
+	int build(std::vector<std::uint32_t>& order, std::uint32_t begin, std::uint32_t end,
+		const float* lo, const float* hi);
+	/// @brief 第 i 个球的半径
+	float radiusOf(std::uint32_t i) const { return radii.empty() ? uniformRadius : radii[i]; }
+	/// @brief 最近交点：返回球下标（未击中为 -1），tHit 为交点距离
+	std::int64_t closest(const Ray& r, double t_min, double t_max, double& tHit) const;
+};
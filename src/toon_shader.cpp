@@ -19,142 +19,227 @@ namespace {
 	}
 }
 
-Vec3 ToonShader::shade(const HitRecord& hit,
-	const Vec3& viewDir,
-	const Light& light,
-	const ToonParams& params) {
-	// Silhouette test: when the view is nearly tangent to the surface, we paint pure black.
-	// This creates a crisp outline independent of lighting.
+ToonShader::Kernel::Kernel(const ToonParams& p, const Light& light)
+	: params(p), toLight((-light.direction).normalized()), lightColor(light.color) {
+	size_t numColors = params.rampColors.size();
+	if (numColors > 1) {
+		// 首尾扩展：颜色复制首尾项，位置补 0 和 1
+		rampColors.reserve(numColors + 2);
+		rampColors.push_back(params.rampColors.front());
+		rampColors.insert(rampColors.end(), params.rampColors.begin(), params.rampColors.end());
+		rampColors.push_back(params.rampColors.back());
+
+		rampPositions.reserve(numColors + 2);
+		rampPositions.push_back(0.0);
+		if (params.rampPositions.size() == numColors) {
+			rampPositions.insert(rampPositions.end(), params.rampPositions.begin(), params.rampPositions.end());
+		}
+		else {
+			// 位置表缺失或大小不匹配：均匀分布
+			for (size_t i = 0; i < numColors; ++i) rampPositions.push_back(double(i) / double(numColors - 1));
+		}
+		rampPositions.push_back(1.0);
+	}
+	else if (numColors == 0) {
+		params.rampColors.push_back(Vec3(1.0, 1.0, 1.0));
+	}
+
+	// 高光：phong 不超过 1，两个阈值都不小于 1 时不可能出现高光
+	const bool singleRamp = params.rampColors.size() == 1;
+	const bool rim = params.enableRim;
+	const bool rimThreshold = rim && params.rimThreshold > 0.0;
+	const bool specular = params.specularThreshold1 < 1.0 || params.specularThreshold2 < 1.0;
+
+	static const VariantFn kVariants[16] = {
+		&shadeVariant<false, false, false, false>, &shadeVariant<false, false, false, true>,
+		&shadeVariant<false, false, true, false>,  &shadeVariant<false, false, true, true>,
+		&shadeVariant<false, true, false, false>,  &shadeVariant<false, true, false, true>,
+		&shadeVariant<false, true, true, false>,   &shadeVariant<false, true, true, true>,
+		&shadeVariant<true, false, false, false>,  &shadeVariant<true, false, false, true>,
+		&shadeVariant<true, false, true, false>,   &shadeVariant<true, false, true, true>,
+		&shadeVariant<true, true, false, false>,   &shadeVariant<true, true, false, true>,
+		&shadeVariant<true, true, true, false>,    &shadeVariant<true, true, true, true>,
+	};
+	static const char* const kNames[16] = {
+		"ramp", "ramp+spec", "ramp", "ramp+spec",
+		"ramp+rim", "ramp+rim+spec", "ramp+rimT", "ramp+rimT+spec",
+		"flat", "flat+spec", "flat", "flat+spec",
+		"flat+rim", "flat+rim+spec", "flat+rimT", "flat+rimT+spec",
+	};
+	static const BatchFn kBatches[16] = {
+		&shadeBatch<false, false, false, false>, &shadeBatch<false, false, false, true>,
+		&shadeBatch<false, false, true, false>,  &shadeBatch<false, false, true, true>,
+		&shadeBatch<false, true, false, false>,  &shadeBatch<false, true, false, true>,
+		&shadeBatch<false, true, true, false>,   &shadeBatch<false, true, true, true>,
+		&shadeBatch<true, false, false, false>,  &shadeBatch<true, false, false, true>,
+		&shadeBatch<true, false, true, false>,   &shadeBatch<true, false, true, true>,
+		&shadeBatch<true, true, false, false>,   &shadeBatch<true, true, false, true>,
+		&shadeBatch<true, true, true, false>,    &shadeBatch<true, true, true, true>,
+	};
+	int index = (singleRamp ? 8 : 0) | (rim ? 4 : 0) | (rimThreshold ? 2 : 0) | (specular ? 1 : 0);
+	variant = kVariants[index];
+	batch = kBatches[index];
+	variantName = kNames[index];
+}
 
-	// 轮廓检测（Silhouette）：
-    // 通过 |dot(N, V)| 判断视线相对于表面的切向程度，
-    // 当视线几乎与表面切线平行时（值小）认为是轮廓，绘制为纯色（这里使用亮紫色作为示例）。
-    // 如果希望黑色轮廓，可改为 Vec3(0,0,0)。
+template <bool SingleRamp, bool Rim, bool RimThreshold, bool Specular>
+inline Vec3 ToonShader::Kernel::shadeVariant(const Kernel& k, const Vec3& N, const Material& material, const Vec3& viewDir,
+	bool inShadow, ToonShadeInfo* info) {
+	const ToonParams& params = k.params;
 
-	// 计算视线与法线的点积，判断是否为轮廓
-	// 当 |dot(N, V)| 接近于0时，视线与法线垂直，认为是轮廓
-	double nv = std::fabs(Vec3::dot(hit.normal, viewDir));
+	// 轮廓检测（Silhouette）：|dot(N, V)| 接近0时视线与表面相切，绘制为纯色
+	double nv = std::fabs(Vec3::dot(N, viewDir));
 	if (nv < params.silhouetteThreshold) {
+		if (info) { info->silhouette = true; info->rampSegment = 0; info->specularLevel = 0; info->shadowed = false; }
 		return Vec3(0.8, 0.55, 0.14);
 	}
 
-	// 光照方向与向量 Lighting vectors
-	Vec3 L = (-light.direction).normalized(); //从表面点指向光源的方向（入射光方向） direction from point to light
-	Vec3 N = hit.normal; //击中点法线 already oriented against the ray
-	Vec3 V = viewDir; //从点指向相机的单位向量
+	const Vec3& L = k.toLight; //从表面点指向光源的方向
+	// N：击中点法线 already oriented against the ray
+	const Vec3& V = viewDir; //从点指向相机的单位向量
 
-	// // 漫反射项（Lambert），然后量化到色带 Diffuse term (Lambert), quantized into bands for a toon ramp
-	// 漫反射项（Lambert），使用ndotl在rampColors中进行lerp插值
+	// 漫反射项（Lambert），使用ndotl在rampColors中进行lerp插值；投射阴影按背光处理
 	double ndotl = std::max(0.0, std::min(1.0, Vec3::dot(N, L)));
-	// int bandIdx = quantize_band(ndotl, params.diffuseBands); // 化得到色带索引
-	// 根据 rampColors 和 rampPositions 进行lerp插值
-	Vec3 bandColor = Vec3(1.0, 1.0, 1.0);
-	size_t numColors = params.rampColors.size();
-	
-	if (numColors == 1) {
+	if (inShadow) ndotl = 0.0;
+
+	Vec3 bandColor;
+	int rampSegment = 0;
+	if (SingleRamp) {
 		// 只有一个颜色：使用这个颜色 * ndotl
 		bandColor = params.rampColors[0] * ndotl;
-	} else {
-		// 创建局部副本，在首尾添加元素
-		std::vector<Vec3> rampColors = params.rampColors;
-		std::vector<double> rampPositions = params.rampPositions;
-		rampColors.insert(rampColors.begin(), rampColors[0]); // 首部：第一个颜色
-		rampColors.push_back(rampColors[rampColors.size() - 1]); // 尾部：最后一个颜色（注意此时size已经+1）
-		// rampColors.insert(rampColors.begin(), Vec3(0.0, 0.0, 0.0));
-		// rampColors.push_back(Vec3(1.0, 1.0, 1.0));
-		
-		rampPositions.insert(rampPositions.begin(), 0.0); // 首部：0
-		rampPositions.push_back(1.0); // 尾部：1
-		
-		// 现在rampColors和rampPositions的大小都是 numColors + 2
-		size_t extendedSize = rampColors.size();
-		
-		// 找到ndotl在哪个区间内（现在ndotl总是在[0,1]范围内，而rampPositions也是[0, ..., 1]）
-		int idx0 = 0;
-		int idx1 = extendedSize - 1;
-		
+	}
+	else {
+		// 找到ndotl所在区间（扩展后的位置表为 [0, ..., 1]）
+		const size_t extendedSize = k.rampColors.size();
+		size_t idx0 = 0;
+		size_t idx1 = extendedSize - 1;
 		for (size_t i = 0; i < extendedSize - 1; i++) {
-			if (ndotl >= rampPositions[i] && ndotl <= rampPositions[i + 1]) {
+			if (ndotl >= k.rampPositions[i] && ndotl <= k.rampPositions[i + 1]) {
 				idx0 = i;
 				idx1 = i + 1;
 				break;
 			}
 		}
-		
-		// 计算插值参数t
 		double t = 0.0;
 		if (idx0 != idx1) {
-			double pos0 = rampPositions[idx0];
-			double pos1 = rampPositions[idx1];
-			if (pos1 > pos0) {
-				t = (ndotl - pos0) / (pos1 - pos0);
-			}
+			double pos0 = k.rampPositions[idx0];
+			double pos1 = k.rampPositions[idx1];
+			if (pos1 > pos0) t = (ndotl - pos0) / (pos1 - pos0);
 		}
-		
-		// 进行lerp插值
-		bandColor = lerp(rampColors[idx0], rampColors[idx1], t);
+		bandColor = lerp(k.rampColors[idx0], k.rampColors[idx1], t);
+		rampSegment = int(idx0);
 	}
+	// 不进行混色，直接放到最后相加
+	Vec3 baseDiffuse = Vec3::hadamard(bandColor, k.lightColor);
 
-	// Base toon diffuse: rampColor modulated by material albedo and light color
-	// 基础漫反射：色带颜色 * 材质漫反射系数 * 光颜色（按分量相乘）
-	// Vec3 baseDiffuse = Vec3::hadamard(Vec3::hadamard(bandColor, hit.material->albedo), light.color);		//直接混色再乘光照
-	// Vec3 baseDiffuse = Vec3::hadamard(Vec3::hadamard(bandColor, light.color), hit.material->albedo);		//先乘光照后混色
-	Vec3 baseDiffuse = Vec3::hadamard(bandColor, light.color);		//不进行混色，直接放到最后相加
-
-
-	// Hard-edge specular from Phong term: compute, then threshold into bands.
-	// 高光项（Phong），计算后量化到色带 
-	Vec3 R = Vec3::reflect(-L, N); //反射向量 reflect incoming light about the normal
-	double rdotv = std::max(0.0, Vec3::dot(R, V)); // R·V ，视线与反射光的夹角余弦
-	double phong = std::pow(rdotv, std::max(1.0, hit.material->shininess));
-
-	//根据阈值决定高光色带（硬边）：phong > t1 -> 强高光；phong > t2 -> 次高光；否则无高光
+	// 硬边高光：phong > t1 -> 强高光；phong > t2 -> 次高光
 	Vec3 specular(0, 0, 0);
-	if (phong > params.specularThreshold1) {
-		specular = Vec3::hadamard(params.specColorA, hit.material->specularColor);
-	}
-	else if (phong > params.specularThreshold2) {
-		specular = Vec3::hadamard(params.specColorB, hit.material->specularColor);
+	int specularLevel = 0;
+	if (Specular) {
+		Vec3 R = Vec3::reflect(-L, N);
+		double rdotv = std::max(0.0, Vec3::dot(R, V));
+		double phong = inShadow ? 0.0 : std::pow(rdotv, std::max(1.0, material.shininess));
+		if (phong > params.specularThreshold1) {
+			specular = Vec3::hadamard(params.specColorA, material.specularColor);
+			specularLevel = 2;
+		}
+		else if (phong > params.specularThreshold2) {
+			specular = Vec3::hadamard(params.specColorB, material.specularColor);
+			specularLevel = 1;
+		}
 	}
-	// else 0
-
-
 
+	// 边缘光（Fresnel 风格）
+	Vec3 rimTerm(0.0, 0.0, 0.0);
+	if (Rim) {
+		double ndotv = std::clamp(Vec3::dot(N, V), -1.0, 1.0);
+		double rim = 1.0 - std::fabs(ndotv);
+		if (RimThreshold) {
+			rim = std::max(0.0, rim - params.rimThreshold) / std::max(1e-6, 1.0 - params.rimThreshold);
+		}
+		rim = std::pow(rim, params.rimPower);
+		rimTerm = params.rimColor * (rim * params.rimIntensity);
+	}
 
-	// === 3.5 新增：Rim Light / 边缘光 ===
-    Vec3 rimTerm(0.0, 0.0, 0.0);
-    if (params.enableRim) {
-        // 经典 Fresnel 风格边缘光：视线越贴边缘，值越大
-        double ndotv = std::clamp(Vec3::dot(N, V), -1.0, 1.0);
-        double rim   = 1.0 - std::fabs(ndotv);   // 中心 0，边缘 1
+	// 最终颜色 = 环境光 + 基础漫反射 + 高光项 + 边缘光
+	Vec3 ambient = material.albedo;
+	Vec3 color = ambient + baseDiffuse + specular + rimTerm;
+	color = color * params.outputBrightness;
 
-        // 可选：减去一个阈值，让更靠边才开始出现边缘光
-        if (params.rimThreshold > 0.0) {
-            rim = std::max(0.0, rim - params.rimThreshold) /
-                  std::max(1e-6, 1.0 - params.rimThreshold);
-        }
+	if (info) {
+		info->silhouette = false;
+		info->rampSegment = rampSegment;
+		info->specularLevel = specularLevel;
+		info->shadowed = inShadow;
+	}
 
-        // “硬度”：类似 pow(·, n)，n 越大越贴边；这就是你们的 Toon 控制
-        rim = std::pow(rim, params.rimPower);
+	return Vec3::clamp01(color);
+}
 
-        // 强度与颜色
-        rimTerm = params.rimColor * (rim * params.rimIntensity);
-    }
+template <bool SingleRamp, bool Rim, bool RimThreshold, bool Specular>
+void ToonShader::Kernel::shadeBatch(const Kernel& k, const ToonShadeInput* in, size_t count, Vec3* out, ToonShadeInfo* info) {
+	// info 是否为空在循环外判断一次，循环体只剩内联的特化着色代码
+	if (info) {
+		for (size_t i = 0; i < count; ++i) {
+			out[i] = shadeVariant<SingleRamp, Rim, RimThreshold, Specular>(k, in[i].normal, *in[i].material, in[i].viewDir,
+				in[i].inShadow, info + i);
+		}
+	}
+	else {
+		for (size_t i = 0; i < count; ++i) {
+			out[i] = shadeVariant<SingleRamp, Rim, RimThreshold, Specular>(k, in[i].normal, *in[i].material, in[i].viewDir,
+				in[i].inShadow, nullptr);
+		}
+	}
+}
 
+Vec3 ToonShader::shade(const HitRecord& hit,
+	const Vec3& viewDir,
+	const Light& light,
+	const ToonParams& params,
+	bool inShadow,
+	ToonShadeInfo* info) {
+	return Kernel(params, light).shade(hit, viewDir, inShadow, info);
+}
 
 
 
-	// Small ambient to prevent full black in unlit regions (can be tuned or removed)
-	// 小环境光（防止未被照亮区域全黑）
-	Vec3 ambient = hit.material->albedo;
+Vec3 ToonShader::shadeLocalLights(const HitRecord& hit,
+	const std::vector<LocalLight>& lights,
+	const std::uint32_t* indices,
+	size_t count,
+	const ToonParams& params) {
+	const double kDegToRad = 3.14159265358979323846 / 180.0;
+	const int bands = std::max(1, params.localLightBands);
+	Vec3 sum(0, 0, 0);
+	for (size_t k = 0; k < count; ++k) {
+		const LocalLight& light = lights[indices[k]];
+		Vec3 toLight = light.position - hit.point;
+		double dist2 = toLight.length_squared();
+		if (dist2 >= light.range * light.range) continue;
+		double dist = std::sqrt(dist2);
+		Vec3 L = dist > 0.0 ? toLight / dist : hit.normal;
+
+		double ndotl = Vec3::dot(hit.normal, L);
+		if (ndotl <= 0.0) continue;
+
+		// 平滑距离衰减：在 range 处降为0
+		double x = dist / light.range;
+		double falloff = (1.0 - x * x) * (1.0 - x * x);
+
+		double cone = 1.0;
+		if (light.type == LocalLightType::Spot) {
+			double cosOuter = std::cos(light.outerConeDegrees * kDegToRad);
+			double cosInner = std::cos(light.innerConeDegrees * kDegToRad);
+			double cd = Vec3::dot(-L, light.direction.normalized());
+			if (cd <= cosOuter) continue;
+			cone = std::min(1.0, (cd - cosOuter) / std::max(1e-6, cosInner - cosOuter));
+		}
 
-	// Final color = ambient + toon diffuse + toon specular
-	// 最终颜色 = 小环境光 + 基础漫反射 + 高光项
-	Vec3 color = ambient + baseDiffuse + specular + rimTerm;
-	// 应用输出亮度控制
-	color = color * params.outputBrightness;
-	
-	return Vec3::clamp01(color);
+		// 硬边量化
+		double level = std::round(std::min(1.0, ndotl * falloff * cone) * bands) / bands;
+		if (level <= 0.0) continue;
+		sum += Vec3::hadamard(hit.material->albedo, light.color) * (light.intensity * level);
+	}
+	return sum * params.outputBrightness;
 }
-
-
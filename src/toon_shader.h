@@ -1,5 +1,6 @@
 #pragma once
 #include <vector>
+#include <cstdint>
 #include "vec3.h"
 #include "hittable.h"
 #include "material.h"
@@ -12,6 +13,30 @@ struct Light {
 	Vec3 color = Vec3(1.0, 1.0, 1.0);
 };
 
+/// @brief 局部光源类型
+enum class LocalLightType {
+	Point,  // 点光源
+	Spot    // 聚光灯
+};
+
+/// @brief 局部光源（点光/聚光），作用范围有限，用于点缀照明
+struct LocalLight {
+	LocalLightType type = LocalLightType::Point;
+	/// @brief 光源位置
+	Vec3 position = Vec3(0, 0, 0);
+	/// @brief 聚光灯朝向（从光源指向场景，单位向量）
+	Vec3 direction = Vec3(0, -1, 0);
+	/// @brief 光线颜色
+	Vec3 color = Vec3(1.0, 1.0, 1.0);
+	/// @brief 强度
+	double intensity = 1.0;
+	/// @brief 作用半径：超过此距离贡献为0（用于分块剔除）
+	double range = 2.0;
+	/// @brief 聚光灯内/外锥角（度），内锥内全亮，外锥外为0
+	double innerConeDegrees = 20.0;
+	double outerConeDegrees = 30.0;
+};
+
 /// @brief 卡通渲染参数结构体
 struct ToonParams {
 	int diffuseBands = 3; // 漫反射分段数量  quantize diffuse into N bands
@@ -47,16 +72,98 @@ struct ToonParams {
     double rimPower      = 2.0;                  // 指数：越大越“贴边”才亮
     double rimThreshold  = 0.0;
 
+	// Cast shadows 投射阴影：向光源方向发射遮挡查询光线，被遮挡的点落入最暗色带且无高光
+	bool enableShadows = false;           // 是否开启硬边卡通阴影
+	double shadowBias = 1e-4;             // 阴影光线起点沿法线的偏移，避免自遮挡
+
+	// Local lights 局部光源：每个光源的贡献量化为硬边色带
+	int localLightBands = 2;              // 局部光源的量化色带数
+
+};
+
+/// @brief 着色结果所在的卡通色带信息（用于判断相邻像素是否处于同一平坦区域）
+struct ToonShadeInfo {
+	bool silhouette = false;  // 是否为轮廓像素
+	int rampSegment = 0;      // ndotl 所在的色带区间下标
+	int specularLevel = 0;    // 高光级别：0 无，1 次级，2 强
+	bool shadowed = false;    // 是否处于投射阴影中
+};
+
+/// @brief 批量着色的一个样本（材质已解析，含逐图元颜色）
+struct ToonShadeInput {
+	Vec3 normal;                        // 击中点法线（已朝向光线一侧）
+	Vec3 viewDir;                       // 从击中点指向相机的单位向量
+	const Material* material = nullptr;
+	bool inShadow = false;              // 调用方的阴影查询结果
 };
 
 namespace ToonShader {
+	/// @brief 按帧特化的着色内核
+	/// 单色 ramp、边缘光、边缘光阈值、高光这些开关整帧不变：构造时判断一次并选出对应的模板实例，
+	/// 逐像素调用不再对它们分支。扩展后的 ramp 表和归一化光照方向也在构造时准备好。
+	class Kernel {
+	public:
+		Kernel() = default;
+		Kernel(const ToonParams& params, const Light& light);
+
+		/// @brief 与 ToonShader::shade 结果一致
+		Vec3 shade(const HitRecord& hit, const Vec3& viewDir, bool inShadow = false, ToonShadeInfo* info = nullptr) const {
+			return variant(*this, hit.normal, *hit.material, viewDir, inShadow, info);
+		}
+
+		// Shades a whole batch (a tile or a wavefront chunk) with one indirect call: the selected
+		// instance loops over the inputs with the per-sample code inlined, so the per-pixel
+		// dispatch disappears and the loop body is specialized for the frame's switches.
+		/// @brief 批量着色：out[i]（与 info[i]，可为空）与逐个调用 shade 的结果一致
+		void shade(const ToonShadeInput* in, size_t count, Vec3* out, ToonShadeInfo* info = nullptr) const {
+			batch(*this, in, count, out, info);
+		}
+
+		/// @brief 选中的实例名（如 "ramp+rim+spec"），用于日志
+		const char* name() const { return variantName; }
+
+	private:
+		using VariantFn = Vec3 (*)(const Kernel&, const Vec3&, const Material&, const Vec3&, bool, ToonShadeInfo*);
+		using BatchFn = void (*)(const Kernel&, const ToonShadeInput*, size_t, Vec3*, ToonShadeInfo*);
+
+		template <bool SingleRamp, bool Rim, bool RimThreshold, bool Specular>
+		static Vec3 shadeVariant(const Kernel& k, const Vec3& N, const Material& material, const Vec3& viewDir,
+			bool inShadow, ToonShadeInfo* info);
+		template <bool SingleRamp, bool Rim, bool RimThreshold, bool Specular>
+		static void shadeBatch(const Kernel& k, const ToonShadeInput* in, size_t count, Vec3* out, ToonShadeInfo* info);
+
+		ToonParams params;
+		Vec3 toLight;                        // 归一化的指向光源方向
+		Vec3 lightColor;
+		std::vector<Vec3> rampColors;        // 首尾各扩展一项
+		std::vector<double> rampPositions;   // 首尾为 0 和 1
+		VariantFn variant = nullptr;
+		BatchFn batch = nullptr;
+		const char* variantName = "";
+	};
+
 	// Computes a toon-shaded color. Uses:
 	//  - Diffuse quantization into bands (color ramp).
 	//  - Hard-edge specular: thresholds applied to Phong term.
 	//  - Silhouette: if |dot(N,V)| < threshold -> black.
+	//  - Shadow: if 'inShadow', the point takes the darkest ramp band and no specular.
+	// If 'info' is given, it receives the band classification of the result.
+	// Builds a Kernel per call; renderers should build one Kernel per frame instead.
 	Vec3 shade(const HitRecord& hit,
 		const Vec3& viewDir,      // normalized direction from point to camera
 		const Light& light,
+		const ToonParams& params,
+		bool inShadow = false,    // result of the caller's shadow-ray occlusion query
+		ToonShadeInfo* info = nullptr);
+
+	// Toon contribution of local point/spot lights: N·L times a smooth range falloff (and the spot
+	// cone), quantized into params.localLightBands hard bands and tinted by the material albedo.
+	// Only the lights listed in 'indices' are evaluated (the caller's per-tile culled list).
+	// The result is already scaled by params.outputBrightness; the caller adds it to shade() and clamps.
+	Vec3 shadeLocalLights(const HitRecord& hit,
+		const std::vector<LocalLight>& lights,
+		const std::uint32_t* indices,
+		size_t count,
 		const ToonParams& params);
 }
 
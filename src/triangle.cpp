@@ -1,8 +1,10 @@
 #include "triangle.h"
+#include <cmath>
+#include <utility>
 
 
-Triangle::Triangle(const Vec3& a, const Vec3& b, const Vec3& c, const Material& m)
-	: v0(a), v1(b), v2(c), material(m) {
+Triangle::Triangle(const Vec3& a, const Vec3& b, const Vec3& c, MaterialId m)
+	: v0(a), v1(b), v2(c), materialId(m) {
 	Vec3 e1 = v1 - v0;
 	Vec3 e2 = v2 - v0;
 
@@ -10,32 +12,55 @@ Triangle::Triangle(const Vec3& a, const Vec3& b, const Vec3& c, const Material&
 	face_normal = Vec3::cross(e1, e2).normalized();
 }
 
-bool Triangle::hit(const Ray& r, double t_min, double t_max, HitRecord& out_rec) const {
-	// Moller-Trumbore
-	const double EPS = 1e-8;
-	Vec3 e1 = v1 - v0;
-	Vec3 e2 = v2 - v0;
-	Vec3 pvec = Vec3::cross(r.direction, e2);
-	double det = Vec3::dot(e1, pvec);
-	if (std::fabs(det) < EPS) return false;
-	double invDet = 1.0 / det;
-
-	Vec3 tvec = r.origin - v0;
-	double u = Vec3::dot(tvec, pvec) * invDet;
-	if (u < 0.0 || u > 1.0) return false;
-
-	Vec3 qvec = Vec3::cross(tvec, e1);
-	double v = Vec3::dot(r.direction, qvec) * invDet;
-	if (v < 0.0 || u + v > 1.0) return false;
-
-	double t = Vec3::dot(e2, qvec) * invDet;
-	if (t < t_min || t > t_max) return false;
+TriangleRay::TriangleRay(const Vec3& origin, const Vec3& direction) {
+	const double ad[3] = { std::fabs(direction.x), std::fabs(direction.y), std::fabs(direction.z) };
+	kz = ad[0] >= ad[1] ? (ad[0] >= ad[2] ? 0 : 2) : (ad[1] >= ad[2] ? 1 : 2);
+	kx = (kz + 1) % 3;
+	ky = (kx + 1) % 3;
+	// 保持投影后的绕序（与面朝向无关，双面求交）
+	if (direction[kz] < 0.0) std::swap(kx, ky);
+	sz = 1.0 / direction[kz];
+	sx = direction[kx] * sz;
+	sy = direction[ky] * sz;
+	ox = origin[kx];
+	oy = origin[ky];
+	oz = origin[kz];
+}
 
+void Triangle::fillHit(const Ray& r, double t, HitRecord& out_rec) const {
 	out_rec.t = t;
 	out_rec.point = r.at(t);
 	out_rec.set_face_normal(r, face_normal);
-	out_rec.material = &material;
+	out_rec.materialId = materialId;
+	out_rec.albedoRGB = HitRecord::kNoAlbedo;
+}
+
+bool Triangle::hit(const Ray& r, double t_min, double t_max, HitRecord& out_rec) const {
+	return hitPrepared(r, TriangleRay(r), t_min, t_max, out_rec);
+}
+
+bool Triangle::hitPrepared(const Ray& r, const TriangleRay& tray, double t_min, double t_max, HitRecord& out_rec) const {
+	double t;
+	if (!intersect(tray, t_min, t_max, t)) return false;
+	fillHit(r, t, out_rec);
 	return true;
 }
 
+bool Triangle::occluded(const Ray& r, double t_min, double t_max) const {
+	double t;
+	return intersect(TriangleRay(r), t_min, t_max, t);
+}
 
+void Triangle::hitStream(const RayStream& rays, size_t begin, size_t end, double t_min,
+	double* tMax, std::uint32_t* hitIndex, std::uint32_t id) const {
+	// 与 hit 相同的水密测试；光线流已为整批光线构建 TriangleRay 时直接复用
+	const bool shared = rays.hasTriangleRays();
+	for (size_t i = begin; i < end; ++i) {
+		const TriangleRay ray = shared ? rays.triangleRays[i]
+			: TriangleRay(Vec3(rays.ox[i], rays.oy[i], rays.oz[i]), Vec3(rays.dx[i], rays.dy[i], rays.dz[i]));
+		double t;
+		if (!intersect(ray, t_min, tMax[i], t)) continue;
+		tMax[i] = t;
+		hitIndex[i] = id;
+	}
+}
@@ -1,6 +1,8 @@
 #pragma once
+#include <vector>
 #include "hittable.h"
 #include "material.h"
+#include "triangle_ray.h"
 
 class Triangle : public Hittable {
 public:
@@ -8,8 +10,8 @@ public:
 	/// @param a 三角形的第一个顶点
 	/// @param b 三角形的第二个顶点
 	/// @param c 三角形的第三个顶点
-	/// @param m 三角形的材质
-	Triangle(const Vec3& a, const Vec3& b, const Vec3& c, const Material& m);
+	/// @param m 三角形的材质ID（材质表下标）
+	Triangle(const Vec3& a, const Vec3& b, const Vec3& c, MaterialId m);
 
 	/// @brief 判断光线是否击中三角形
 	/// @param r 射线
@@ -18,6 +20,38 @@ public:
 	/// @param out_rec 击中记录
 	bool hit(const Ray& r, double t_min, double t_max, HitRecord& out_rec) const override;
 
+	/// @brief 遮挡查询：只计算 t，不填写击中记录
+	bool occluded(const Ray& r, double t_min, double t_max) const override;
+
+	/// @brief 击中判断：复用调用方为该光线构建的 TriangleRay
+	bool hitPrepared(const Ray& r, const TriangleRay& tray, double t_min, double t_max, HitRecord& out_rec) const override;
+	/// @brief 遮挡查询：复用调用方为该光线构建的 TriangleRay
+	bool occludedPrepared(const Ray& r, const TriangleRay& tray, double t_min, double t_max) const override {
+		(void)r;
+		double t;
+		return intersect(tray, t_min, t_max, t);
+	}
+
+	/// @brief 水密求交：只求距离，不填写击中记录
+	/// @param ray 逐光线预计算（同一光线测试多个三角形时只构建一次）
+	/// @param t 输出击中距离（区间 [t_min, t_max] 内）
+	inline bool intersect(const TriangleRay& ray, double t_min, double t_max, double& t) const;
+	/// @brief 按击中距离 t 填写击中记录
+	void fillHit(const Ray& r, double t, HitRecord& out_rec) const;
+
+	bool boundingBox(AABB& out) const override {
+		out = AABB();
+		out.expand(v0); out.expand(v1); out.expand(v2);
+		return true;
+	}
+	void hitStream(const RayStream& rays, size_t begin, size_t end, double t_min,
+		double* tMax, std::uint32_t* hitIndex, std::uint32_t id) const override;
+
+	/// @brief 第 i 个顶点（0..2）
+	const Vec3& vertex(int i) const { return i == 0 ? v0 : (i == 1 ? v1 : v2); }
+	/// @brief 材质ID
+	MaterialId getMaterialId() const { return materialId; }
+
 private:
 
 	/// @brief 三角形的三个顶点
@@ -26,8 +60,35 @@ private:
 	/// @brief 三角形的面法线（恒定）
 	Vec3 face_normal;
 
-	/// @brief 三角形的材质
-	Material material;
+	/// @brief 三角形的材质ID
+	MaterialId materialId;
 };
 
+inline bool Triangle::intersect(const TriangleRay& ray, double t_min, double t_max, double& t) const {
+	// 顶点平移到光线起点并剪切到光线坐标系
+	const double az = v0[ray.kz] - ray.oz;
+	const double bz = v1[ray.kz] - ray.oz;
+	const double cz = v2[ray.kz] - ray.oz;
+	const double ax = (v0[ray.kx] - ray.ox) - ray.sx * az;
+	const double ay = (v0[ray.ky] - ray.oy) - ray.sy * az;
+	const double bx = (v1[ray.kx] - ray.ox) - ray.sx * bz;
+	const double by = (v1[ray.ky] - ray.oy) - ray.sy * bz;
+	const double cx = (v2[ray.kx] - ray.ox) - ray.sx * cz;
+	const double cy = (v2[ray.ky] - ray.oy) - ray.sy * cz;
+
+	// 二维边函数；为零表示光线恰好穿过边或顶点，两侧三角形都接受
+	const double u = cx * by - cy * bx;
+	const double v = ax * cy - ay * cx;
+	const double w = bx * ay - by * ax;
+	if ((u < 0.0 || v < 0.0 || w < 0.0) && (u > 0.0 || v > 0.0 || w > 0.0)) return false;
+
+	// 只有光线与三角形平面平行（或三角形退化）时 det 才为零，不设 EPS 阈值
+	const double det = u + v + w;
+	if (det == 0.0) return false;
 
+	// 先以 det 缩放的距离做区间检查，未通过的不做除法
+	const double T = (u * az + v * bz + w * cz) * ray.sz;
+	if (det > 0.0 ? (T < t_min * det || T > t_max * det) : (T > t_min * det || T < t_max * det)) return false;
+	t = T / det;
+	return t >= t_min && t <= t_max;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "ray.h"
+
+// Per-ray setup for the watertight ray/triangle test (Woop, Benthin, Wald 2013). The axis where
+// the direction is largest becomes z, and a shear maps the ray onto the +z axis, so every vertex
+// projects to 2D once, independently of the triangle it belongs to. Two triangles sharing an
+// edge then evaluate that edge from bit-identical coordinates with opposite signs, which leaves
+// no cracks; built once per ray and reused for every triangle the ray is tested against.
+/// @brief 三角形求交的逐光线预计算（轴置换 + 剪切）
+struct TriangleRay {
+	int kx = 0, ky = 1, kz = 2;   // 轴置换：kz 为方向分量绝对值最大的轴
+	double sx = 0.0, sy = 0.0;    // 剪切系数 d[kx]/d[kz]、d[ky]/d[kz]
+	double sz = 1.0;              // 1/d[kz]
+	double ox = 0.0, oy = 0.0, oz = 0.0; // 置换后的光线起点
+
+	TriangleRay() = default;
+	/// @brief 由光线起点与方向构建
+	TriangleRay(const Vec3& origin, const Vec3& direction);
+	/// @brief 由光线构建
+	explicit TriangleRay(const Ray& r) : TriangleRay(r.origin, r.direction) {}
+};
@@ -18,6 +18,9 @@ struct Vec3 {
 	Vec3& operator*=(double s) { x *= s; y *= s; z *= s; return *this; }
 	Vec3& operator/=(double s) { x /= s; y /= s; z /= s; return *this; }
 
+	/// @brief 按轴下标（0 = x, 1 = y, 2 = z）取分量
+	double operator[](int axis) const { return this->*kAxes[axis]; }
+
 	static Vec3 hadamard(const Vec3& a, const Vec3& b) { return Vec3(a.x * b.x, a.y * b.y, a.z * b.z); }
 
 	double length() const { return std::sqrt(x * x + y * y + z * z); }
@@ -49,6 +52,9 @@ struct Vec3 {
 			std::max(0.0, std::min(1.0, c.z))
 		);
 	}
+
+private:
+	static constexpr double Vec3::* kAxes[3] = { &Vec3::x, &Vec3::y, &Vec3::z };
 };
 
 inline Vec3 operator*(double s, const Vec3& v) { return v * s; }
@@ -0,0 +1,109 @@
+#include "video_sink.h"
+#include "image_writer.h"
+#include <iostream>
+#include <algorithm>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+namespace {
+	// JFIF (full-range BT.601) RGB -> YCbCr in 16.16 fixed point; loops are branch-free so the
+	// compiler can vectorize them.
+	/// @brief 亮度平面
+	static void lumaPlane(const std::uint8_t* rgb, std::uint8_t* y, size_t pixels) {
+		for (size_t i = 0; i < pixels; ++i) {
+			int r = rgb[3 * i], g = rgb[3 * i + 1], b = rgb[3 * i + 2];
+			y[i] = std::uint8_t((19595 * r + 38470 * g + 7471 * b + 32768) >> 16);
+		}
+	}
+
+	/// @brief 色度平面（2x2 平均后转换，奇数尺寸时边缘重复最后一行/列）
+	static void chromaPlanes(const std::uint8_t* rgb, int w, int h, std::uint8_t* cb, std::uint8_t* cr) {
+		const int cw = (w + 1) / 2, ch = (h + 1) / 2;
+		for (int cy = 0; cy < ch; ++cy) {
+			const std::uint8_t* row0 = rgb + size_t(2 * cy) * w * 3;
+			const std::uint8_t* row1 = rgb + size_t(std::min(h - 1, 2 * cy + 1)) * w * 3;
+			for (int cx = 0; cx < cw; ++cx) {
+				const int x0 = 2 * cx * 3, x1 = std::min(w - 1, 2 * cx + 1) * 3;
+				int r = row0[x0] + row0[x1] + row1[x0] + row1[x1];
+				int g = row0[x0 + 1] + row0[x1 + 1] + row1[x0 + 1] + row1[x1 + 1];
+				int b = row0[x0 + 2] + row0[x1 + 2] + row1[x0 + 2] + row1[x1 + 2];
+				// 四像素之和，权重再除以4（>>18）
+				cb[size_t(cy) * cw + cx] = std::uint8_t((-11059 * r - 21709 * g + 32768 * b + (128 << 18) + (1 << 17)) >> 18);
+				cr[size_t(cy) * cw + cx] = std::uint8_t((32768 * r - 27439 * g - 5329 * b + (128 << 18) + (1 << 17)) >> 18);
+			}
+		}
+	}
+}
+
+bool VideoSink::open(const std::string& path, VideoFormat fmt, int w, int h, int fpsNum, int fpsDen) {
+	close();
+	if (w <= 0 || h <= 0) return false;
+	if (path == "-") {
+		file = stdout;
+		ownsFile = false;
+#ifdef _WIN32
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+	}
+	else {
+		file = std::fopen(path.c_str(), "wb");
+		ownsFile = true;
+		if (!file) {
+			std::cerr << "Failed to open video output: " << path << "\n";
+			return false;
+		}
+	}
+
+	format = fmt;
+	width = w;
+	height = h;
+	frames = 0;
+	const size_t pixels = size_t(w) * h;
+	rgb.assign(pixels * 3, 0);
+	if (format == VideoFormat::Y4M) {
+		planes.assign(pixels + 2 * size_t((w + 1) / 2) * ((h + 1) / 2), 0);
+		std::fprintf(file, "YUV4MPEG2 W%d H%d F%d:%d Ip A1:1 C420jpeg\n", w, h, fpsNum, fpsDen);
+	}
+	else {
+		planes.clear();
+	}
+	return std::ferror(file) == 0;
+}
+
+bool VideoSink::writeFrame(const std::vector<Vec3>& colors) {
+	if (!file) return false;
+	const size_t pixels = size_t(width) * height;
+	if (colors.size() != pixels) {
+		std::cerr << "VideoSink: frame has " << colors.size() << " pixels, expected " << pixels << "\n";
+		return false;
+	}
+
+	ImageWriter::toRGB8(colors.data(), pixels, rgb.data());
+	if (format == VideoFormat::RawRGB) {
+		bool ok = std::fwrite(rgb.data(), 1, rgb.size(), file) == rgb.size();
+		if (ok) ++frames;
+		return ok;
+	}
+
+	std::uint8_t* y = planes.data();
+	std::uint8_t* cb = y + pixels;
+	std::uint8_t* cr = cb + size_t((width + 1) / 2) * ((height + 1) / 2);
+	lumaPlane(rgb.data(), y, pixels);
+	chromaPlanes(rgb.data(), width, height, cb, cr);
+
+	static const char kFrameHeader[] = "FRAME\n";
+	bool ok = std::fwrite(kFrameHeader, 1, sizeof(kFrameHeader) - 1, file) == sizeof(kFrameHeader) - 1
+		&& std::fwrite(planes.data(), 1, planes.size(), file) == planes.size();
+	if (ok) ++frames;
+	return ok;
+}
+
+void VideoSink::close() {
+	if (!file) return;
+	std::fflush(file);
+	if (ownsFile) std::fclose(file);
+	file = nullptr;
+	ownsFile = false;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "vec3.h"
+
+/// @brief 视频流格式
+enum class VideoFormat {
+	Y4M,     // YUV4MPEG2，4:2:0 全范围（C420jpeg），可直接接入 ffmpeg/x264 等编码器
+	RawRGB   // 无头部的 RGB24 帧序列（编码器端需指定尺寸与像素格式）
+};
+
+// Streams rendered frames to stdout ("-"), a file or a named pipe instead of one PPM per frame.
+// Colors are quantized exactly like the PPM writer (ImageWriter::toRGB8). All conversion happens in buffers owned
+// by the sink that are sized once in open(), so writing a frame allocates nothing.
+/// @brief 视频帧输出
+class VideoSink {
+public:
+	VideoSink() = default;
+	~VideoSink() { close(); }
+	VideoSink(const VideoSink&) = delete;
+	VideoSink& operator=(const VideoSink&) = delete;
+
+	/// @brief 打开输出并写入流头部
+	/// @param path 输出路径，"-" 表示标准输出
+	/// @param format 流格式
+	/// @param w 帧宽
+	/// @param h 帧高
+	/// @param fpsNum 帧率分子
+	/// @param fpsDen 帧率分母
+	/// @return 是否成功
+	bool open(const std::string& path, VideoFormat format, int w, int h, int fpsNum = 24, int fpsDen = 1);
+
+	/// @brief 写入一帧（尺寸必须与 open 时一致）
+	bool writeFrame(const std::vector<Vec3>& colors);
+
+	/// @brief 刷新并关闭（标准输出只刷新不关闭）
+	void close();
+
+	bool isOpen() const { return file != nullptr; }
+	long long framesWritten() const { return frames; }
+
+private:
+	std::FILE* file = nullptr;
+	bool ownsFile = false;
+	VideoFormat format = VideoFormat::Y4M;
+	int width = 0;
+	int height = 0;
+	long long frames = 0;
+	/// @brief 8位 RGB 中间结果（每帧复用）
+	std::vector<std::uint8_t> rgb;
+	/// @brief 一帧的输出字节（Y4M 为 Y/U/V 平面）
+	std::vector<std::uint8_t> planes;
+};